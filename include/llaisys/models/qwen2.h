@@ -9,6 +9,9 @@ __C {
         size_t nlayer, hs, nh, nkvh, dh, di, maxseq, voc;
         float epsilon, theta;
         int64_t end_token;
+        // 激活、残差流与 KV-Cache 的 dtype，0（LLAISYS_DTYPE_INVALID）表示与 dtype 相同。
+        // 如 dtype = BF16、act_dtype = F32：权重保持 bf16，前向全程以 f32 计算
+        llaisysDataType_t act_dtype;
     };
 
     struct LlaisysQwen2Weights {
@@ -40,5 +43,292 @@ __C {
     __export int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken);
 
     __export void llaisysQwen2ModelReset(struct LlaisysQwen2Model * model);
+
+    struct LlaisysQwen2LoadStats {
+        size_t files;
+        size_t mapped;       // 直接以文件映射为存储的张量数（CPU 上 dtype 一致时）
+        size_t converted;    // 转换 dtype 或拷贝到设备的张量数
+        size_t mapped_bytes;
+        size_t copied_bytes;
+        // 各阶段耗时（毫秒）：映射并解析头部、并行转换 / 预取、放入模型
+        double read_ms;
+        double convert_ms;
+        double place_ms;
+        double total_ms;
+    };
+
+    // 加载进度：stage 为 "read" / "convert" / "place"。convert 阶段在工作线程上调用，调用之间互斥
+    typedef void (*llaisysQwen2LoadProgress)(const char *stage, size_t done, size_t total, void *user_data);
+
+    struct LlaisysQwen2LoadOptions {
+        size_t nthreads;   // 并行转换的线程数，0 为硬件线程数
+        int readahead;     // 非 0 时映射后提示内核预读整个文件
+        int prefault;      // 非 0 时直接映射的权重也在加载时并行读入页面
+        llaisysQwen2LoadProgress progress; // 可为空
+        void *user_data;
+    };
+
+    // 从目录中的 *.safetensors 文件加载权重（HuggingFace 命名）：文件被映射到内存，
+    // CPU 上 dtype 一致的权重直接使用映射，不分配也不拷贝。没有 lm_head.weight 时与 embed_tokens 共享。
+    // 之前通过 llaisysQwen2ModelWeights 取得的张量句柄随之指向新的权重。
+    // stats 可为空。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelLoadSafetensors(struct LlaisysQwen2Model * model, const char *dir, struct LlaisysQwen2LoadStats *stats);
+
+    // 同上，options 指定线程数、预读与进度回调；为空时与 llaisysQwen2ModelLoadSafetensors 相同
+    __export int llaisysQwen2ModelLoadSafetensorsWithOptions(struct LlaisysQwen2Model * model, const char *dir,
+                                                             const struct LlaisysQwen2LoadOptions *options,
+                                                             struct LlaisysQwen2LoadStats *stats);
+
+    // .llaisys 文件：llaisys-convert 离线生成，张量按 64 字节对齐、已是模型 dtype，并嵌入模型配置。
+    // 读取文件中的配置（用于 llaisysQwen2ModelCreate）。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ReadLlaisysMeta(const char *path, struct LlaisysQwen2Meta *meta);
+
+    // 加载 .llaisys 文件：CPU 上所有权重直接映射，不做任何转换。配置须与模型一致。
+    // options 可为空，其中只有 readahead 起作用。句柄随之指向新的权重，stats 可为空。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelLoadLlaisys(struct LlaisysQwen2Model * model, const char *path,
+                                              const struct LlaisysQwen2LoadOptions *options,
+                                              struct LlaisysQwen2LoadStats *stats);
+
+    // 把当前权重（须在 CPU 上）写成 .llaisys 文件。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelSaveLlaisys(struct LlaisysQwen2Model * model, const char *path);
+
+    // 多进程共享只读权重：image_path 处的 .llaisys 映像（建议放在 /dev/shm）由第一个进程从 source
+    // （HuggingFace 目录或 .llaisys 文件）生成，之后的进程直接映射，N 个进程约占 1 份权重内存。
+    // 引用计数为映像锁文件上的共享锁，模型销毁时释放，最后一个使用者删除映像。
+    // created 非空时写入本进程是否生成了映像。仅 POSIX 平台。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelAttachSharedWeights(struct LlaisysQwen2Model * model, const char *image_path,
+                                                      const char *source,
+                                                      const struct LlaisysQwen2LoadOptions *options,
+                                                      struct LlaisysQwen2LoadStats *stats, int *created);
+
+    struct LlaisysQwen2LayerStreamStats {
+        size_t prefetched; // 后台预取的层数
+        size_t released;   // 释放页面的层数
+        size_t stalls;     // 前向等待预取完成的次数
+        double stall_ms;
+    };
+
+    // 逐层流式执行：权重留在映射的文件中，前向到第 l 层时后台线程预取之后 lookahead 层，
+    // 算完的层释放页面（drop_finished 非 0 时立即丢弃，否则只标记为优先回收）。
+    // 适用于内存放不下全部权重的情况；加载时应关闭 readahead 与 prefault。
+    // 按当前权重的地址设置；重新加载或折叠权重会关闭流式执行，之后需要再次调用。lookahead 为 0 时关闭。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelSetLayerStreaming(struct LlaisysQwen2Model * model, size_t lookahead, int drop_finished);
+
+    // 未开启逐层流式执行时返回 -1
+    __export int llaisysQwen2ModelLayerStreamStats(struct LlaisysQwen2Model * model, struct LlaisysQwen2LayerStreamStats *stats);
+
+    // 加载后的权重优化：把 RMSNorm 权重折叠进其后的 q/k/v 与 gate/up 权重，并把 q/k/v 合并为一个投影，
+    // 之后每层的 RMSNorm 只做归一化。结果与未优化时至多差一次权重舍入。
+    // 被折叠的权重改为模型自有的内存（不再映射文件），weights 中的句柄随之更新；
+    // 之后不能再加载权重。已折叠时直接返回 0，失败返回 -1
+    __export int llaisysQwen2ModelFoldNormWeights(struct LlaisysQwen2Model * model);
+
+    // 多轮对话：传入完整的 token 序列（历史 + 新一轮），与上次已缓存 token 的公共前缀直接复用，
+    // KV-Cache 截断到第一个不同的位置，只预填充其后的 token。返回下一个 token，失败返回 -1；
+    // reused 非空时写入复用的 token 数
+    __export int64_t llaisysQwen2ModelInferReuse(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken, size_t * reused);
+
+    // 开关录制执行计划的回放（默认开启）；关闭后每步逐个调用算子
+    __export void llaisysQwen2ModelSetGraphCapture(struct LlaisysQwen2Model * model, int enable);
+
+    // 序列：独立的 KV-Cache 与位置，与模型共享权重，用于多序列批量解码
+    struct LlaisysQwen2Sequence;
+
+    __export struct LlaisysQwen2Sequence *llaisysQwen2SequenceCreate(struct LlaisysQwen2Model * model);
+
+    __export void llaisysQwen2SequenceDestroy(struct LlaisysQwen2Sequence * seq);
+
+    __export void llaisysQwen2SequenceReset(struct LlaisysQwen2Sequence * seq);
+
+    // 在指定序列上推理一步（预填充或解码），返回下一个 token，失败返回 -1
+    __export int64_t llaisysQwen2SequenceInfer(struct LlaisysQwen2Model * model, struct LlaisysQwen2Sequence * seq, int64_t * token_ids, size_t ntoken);
+
+    // 批量解码：nseq 条互不相同的序列各输入一个 token，next_tokens 写入各自的下一个 token。
+    // nseq 不超过模型的 max_chunk。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelInferBatch(struct LlaisysQwen2Model * model, struct LlaisysQwen2Sequence * *seqs, int64_t * token_ids, size_t nseq, int64_t * next_tokens);
+
+    // 会话：一段对话独立的 KV-Cache 与位置，与同一模型的其他会话共享权重，
+    // 额外内存只有其 KV-Cache（按实际长度增长）。不同线程可同时使用不同会话，前向串行执行
+    struct LlaisysQwen2Session;
+
+    __export struct LlaisysQwen2Session *llaisysQwen2SessionCreate(struct LlaisysQwen2Model * model);
+
+    __export void llaisysQwen2SessionDestroy(struct LlaisysQwen2Session * session);
+
+    // 在会话末尾追加 token（新一轮的 prompt 或上一步生成的 token），返回下一个 token，失败返回 -1
+    __export int64_t llaisysQwen2SessionInfer(struct LlaisysQwen2Session * session, int64_t * token_ids, size_t ntoken);
+
+    __export void llaisysQwen2SessionReset(struct LlaisysQwen2Session * session);
+
+    // 会话中已缓存的 token 数
+    __export size_t llaisysQwen2SessionLength(struct LlaisysQwen2Session * session);
+
+    // 会话 KV-Cache 当前占用的字节数（被驱逐时为 0）
+    __export size_t llaisysQwen2SessionKVBytes(struct LlaisysQwen2Session * session);
+
+    // 会话的 KV 内存预算：超出时按 LRU 驱逐空闲会话，下次使用时自动恢复
+    typedef enum {
+        LLAISYS_KV_EVICT_DROP = 0,  // 丢弃 KV，下次使用时重新预填充
+        LLAISYS_KV_EVICT_SPILL = 1, // 把 KV 写入本地文件，下次使用时读回
+    } llaisysKVEvictionPolicy_t;
+
+    struct LlaisysQwen2KVStats {
+        size_t budget_bytes;      // 0 为不限制
+        size_t used_bytes;        // 驻留会话的 KV 占用
+        size_t peak_bytes;
+        size_t sessions;
+        size_t resident_sessions;
+        size_t hits;              // 使用会话时其 KV 仍在内存中
+        size_t misses;            // 使用会话时其 KV 已被驱逐
+        size_t evictions;
+        size_t spilled_bytes;     // 累计写入文件的字节数
+        size_t reprefill_tokens;  // 因丢弃而重新预填充的 token 数
+    };
+
+    // budget_bytes 为 0 时不限制；spill_dir 为 SPILL 策略的文件目录（为空时使用当前目录）。
+    // 成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelSetKVBudget(struct LlaisysQwen2Model * model, size_t budget_bytes, llaisysKVEvictionPolicy_t policy, const char *spill_dir);
+
+    __export void llaisysQwen2ModelGetKVStats(struct LlaisysQwen2Model * model, struct LlaisysQwen2KVStats * stats);
+
+    // 调度器：多请求的迭代级连续批处理（continuous batching）
+    struct LlaisysQwen2Scheduler;
+
+    struct LlaisysQwen2TokenEvent {
+        int64_t request_id;
+        int64_t token; // 取消时为 -1
+        int finished;  // 该请求的最后一个事件
+    };
+
+    // max_batch: 同时运行的请求数上限；token_budget: 每步处理的 token 数上限
+    __export struct LlaisysQwen2Scheduler *llaisysQwen2SchedulerCreate(struct LlaisysQwen2Model * model, size_t max_batch, size_t token_budget);
+
+    __export void llaisysQwen2SchedulerDestroy(struct LlaisysQwen2Scheduler * scheduler);
+
+    // 提交请求，返回请求 id，失败返回 -1
+    __export int64_t llaisysQwen2SchedulerSubmit(struct LlaisysQwen2Scheduler * scheduler, int64_t * token_ids, size_t ntoken, size_t max_new_tokens);
+
+    __export int llaisysQwen2SchedulerCancel(struct LlaisysQwen2Scheduler * scheduler, int64_t request_id);
+
+    // 执行一次迭代，返回本步产生的 token 数，失败返回 -1
+    __export int64_t llaisysQwen2SchedulerStep(struct LlaisysQwen2Scheduler * scheduler);
+
+    // 取出至多 capacity 个已产生的 token 事件，返回实际数量
+    __export size_t llaisysQwen2SchedulerPoll(struct LlaisysQwen2Scheduler * scheduler, struct LlaisysQwen2TokenEvent * events, size_t capacity);
+
+    // 是否还有等待或运行中的请求
+    __export int llaisysQwen2SchedulerHasWork(struct LlaisysQwen2Scheduler * scheduler);
+
+    // 投机解码：小的草稿模型每轮提出 num_draft 个 token，目标模型一次前向验证。
+    // temperature <= 0 为贪心（输出与目标模型贪心解码一致），否则在 top_k 个候选中采样，
+    // 用拒绝采样保持目标模型的输出分布。两个模型必须共享词表
+    struct LlaisysQwen2Speculator;
+
+    struct LlaisysQwen2SpeculativeStats {
+        size_t rounds;   // 验证轮数
+        size_t drafted;  // 草稿 token 总数
+        size_t accepted; // 被接受的草稿 token 数
+        size_t emitted;  // 各轮输出的 token 总数
+    };
+
+    __export struct LlaisysQwen2Speculator *llaisysQwen2SpeculatorCreate(struct LlaisysQwen2Model * target, struct LlaisysQwen2Model * draft, size_t num_draft, float temperature, size_t top_k, uint64_t seed);
+
+    __export void llaisysQwen2SpeculatorDestroy(struct LlaisysQwen2Speculator * speculator);
+
+    // 预填充 prompt 并清空统计，返回第一个生成的 token，失败返回 -1
+    __export int64_t llaisysQwen2SpeculatorStart(struct LlaisysQwen2Speculator * speculator, int64_t * token_ids, size_t ntoken);
+
+    // 执行一轮草稿 + 验证，out_tokens 至少容纳 num_draft + 1 个 token。
+    // 返回本轮输出的 token 数，到达 maxseq 时返回 0，失败返回 -1
+    __export int64_t llaisysQwen2SpeculatorStep(struct LlaisysQwen2Speculator * speculator, int64_t * out_tokens);
+
+    __export void llaisysQwen2SpeculatorGetStats(struct LlaisysQwen2Speculator * speculator, struct LlaisysQwen2SpeculativeStats * stats);
+
+    // 提交开启 prompt lookup 投机解码的请求：用末尾 ngram 个 token 在 prompt 与已生成 token 中
+    // 匹配，每步附带至多 num_draft 个草稿 token 一起验证（num_draft 为 0 等同于 Submit）。
+    // 返回请求 id，失败返回 -1
+    __export int64_t llaisysQwen2SchedulerSubmitWithLookup(struct LlaisysQwen2Scheduler * scheduler, int64_t * token_ids, size_t ntoken, size_t max_new_tokens, size_t ngram, size_t num_draft);
+
+    // 调度器中所有请求累计的 prompt lookup 统计
+    __export void llaisysQwen2SchedulerGetLookupStats(struct LlaisysQwen2Scheduler * scheduler, struct LlaisysQwen2SpeculativeStats * stats);
+
+    // 原生解码循环：在默认序列上预填充 prompt 并逐 token 解码，整个循环不离开 C++
+    struct LlaisysQwen2GenerateParams {
+        size_t max_new_tokens;
+        float temperature;  // <= 0 为贪心
+        size_t top_k;       // 1 为贪心，0 为不限
+        float top_p;        // 1 为不截断
+        uint64_t seed;
+        const int64_t *stop_tokens; // 除 end_token 外的停止 token（会输出）
+        size_t nstop_tokens;
+        // 停止序列首尾相接存放，第 i 个的长度为 stop_sequence_lens[i]；匹配到的序列不输出
+        const int64_t *stop_sequences;
+        const size_t *stop_sequence_lens;
+        size_t nstop_sequences;
+        int reuse_kv; // 非 0 时复用与上次已缓存 token 的公共前缀（见 llaisysQwen2ModelInferReuse）
+    };
+
+    typedef enum {
+        LLAISYS_STOP_MAX_TOKENS = 0,
+        LLAISYS_STOP_TOKEN = 1,    // end_token 或 stop_tokens
+        LLAISYS_STOP_SEQUENCE = 2,
+        LLAISYS_STOP_MAXSEQ = 3,
+        LLAISYS_STOP_CALLBACK = 4, // 回调返回非 0
+    } llaisysQwen2StopReason_t;
+
+    struct LlaisysQwen2GenerateResult {
+        size_t ntoken; // 输出的 token 数
+        size_t reused; // 复用的 KV-Cache 长度
+        llaisysQwen2StopReason_t stop_reason;
+    };
+
+    // 每输出一个 token 调用一次（在调用 Generate 的线程上），返回非 0 时停止生成
+    typedef int (*llaisysQwen2TokenCallback)(int64_t token, void *user_data);
+
+    // 有界 token 队列：Generate 写入，其他线程取出。Generate 结束（包括失败）时关闭队列，
+    // 每次生成使用一个新的队列。队列满时 Generate 阻塞到有空位
+    struct LlaisysQwen2TokenRing;
+
+    __export struct LlaisysQwen2TokenRing *llaisysQwen2TokenRingCreate(size_t capacity);
+
+    __export void llaisysQwen2TokenRingDestroy(struct LlaisysQwen2TokenRing * ring);
+
+    // 取出至多 capacity 个 token，返回实际数量；wait 非 0 时阻塞到至少有一个 token 或队列已关闭
+    __export size_t llaisysQwen2TokenRingPop(struct LlaisysQwen2TokenRing * ring, int64_t * tokens, size_t capacity, int wait);
+
+    // 队列已关闭且取空时返回 1
+    __export int llaisysQwen2TokenRingFinished(struct LlaisysQwen2TokenRing * ring);
+
+    // 生成的 token 依次交给 callback 与 ring（均可为空）。
+    // params 为空时使用默认值（贪心、128 个 token、复用前缀）。成功返回 0，失败返回 -1
+    __export int llaisysQwen2ModelGenerate(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken, const struct LlaisysQwen2GenerateParams *params, llaisysQwen2TokenCallback callback, void *user_data, struct LlaisysQwen2TokenRing *ring, struct LlaisysQwen2GenerateResult *result);
+
+    // 异步引擎：调度器运行在引擎自己的工作线程上，提交、取消与取出 token 都不等待前向。
+    // 有 token 可取时 llaisysQwen2EngineFd 返回的 fd 可读（Linux 上为 eventfd，其他 POSIX 系统为管道），
+    // 可交给 epoll / asyncio 监听；取空后重新变为不可读
+    struct LlaisysQwen2Engine;
+
+    __export struct LlaisysQwen2Engine *llaisysQwen2EngineCreate(struct LlaisysQwen2Model * model, size_t max_batch, size_t token_budget);
+
+    // 等待工作线程完成当前一步后退出，未结束的请求被丢弃
+    __export void llaisysQwen2EngineDestroy(struct LlaisysQwen2Engine * engine);
+
+    // 提交请求（num_draft > 0 时开启 prompt lookup），立即返回请求 id，失败返回 -1
+    __export int64_t llaisysQwen2EngineSubmit(struct LlaisysQwen2Engine * engine, int64_t * token_ids, size_t ntoken, size_t max_new_tokens, size_t ngram, size_t num_draft);
+
+    // 请求未结束时返回 1，随后产生一个 token 为 -1 的结束事件
+    __export int llaisysQwen2EngineCancel(struct LlaisysQwen2Engine * engine, int64_t request_id);
+
+    // 取出至多 capacity 个事件，不阻塞，返回实际数量
+    __export size_t llaisysQwen2EnginePoll(struct LlaisysQwen2Engine * engine, struct LlaisysQwen2TokenEvent * events, size_t capacity);
+
+    // 阻塞到有事件可取或超时（timeout_ms < 0 为不超时），有事件时返回 1
+    __export int llaisysQwen2EngineWait(struct LlaisysQwen2Engine * engine, int timeout_ms);
+
+    // 通知 fd，平台不支持时返回 -1
+    __export int llaisysQwen2EngineFd(struct LlaisysQwen2Engine * engine);
+
+    // 已提交且尚未结束的请求数
+    __export size_t llaisysQwen2EngineNumActive(struct LlaisysQwen2Engine * engine);
 }
 #endif // LLAISYS_MODELS_QWEN2_H
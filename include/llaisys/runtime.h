@@ -42,6 +42,45 @@ __C {
 
     // Llaisys API for switching device context
     __export void llaisysSetContextRuntime(llaisysDeviceType_t, int);
+
+    // Memory Allocators
+    typedef enum {
+        LLAISYS_ALLOCATOR_NAIVE = 0,
+        LLAISYS_ALLOCATOR_CACHING = 1,
+    } llaisysAllocatorType_t;
+
+    struct LlaisysMemoryStats {
+        size_t allocated_bytes;      // bytes currently handed out to storages
+        size_t peak_allocated_bytes; // high-water mark of allocated_bytes
+        size_t reserved_bytes;       // bytes currently held from the device
+        size_t cached_bytes;         // reserved bytes that are free for reuse
+        size_t num_allocs;
+        size_t num_frees;
+        size_t num_cache_hits;
+        size_t num_device_mallocs;
+        size_t num_device_frees;
+    };
+
+    // Llaisys API for selecting the allocator of a device runtime in the current context.
+    // max_cached_bytes caps the free memory a caching allocator keeps, 0 for the default.
+    __export void llaisysSetContextAllocator(llaisysDeviceType_t, int, llaisysAllocatorType_t, size_t max_cached_bytes);
+
+    // Llaisys API for querying allocator statistics of a device runtime in the current context
+    __export void llaisysGetContextMemoryStats(llaisysDeviceType_t, int, struct LlaisysMemoryStats *);
+
+    // Llaisys API for returning all cached memory of a device runtime to the device
+    __export void llaisysTrimContextAllocator(llaisysDeviceType_t, int);
+
+    // CPU Memory Policy
+    typedef enum {
+        LLAISYS_HUGE_PAGES_NONE = 0,        // 64-byte aligned heap memory only
+        LLAISYS_HUGE_PAGES_TRANSPARENT = 1, // madvise(MADV_HUGEPAGE) on large blocks (default)
+        LLAISYS_HUGE_PAGES_EXPLICIT = 2,    // MAP_HUGETLB on large blocks, transparent if the pool is empty
+    } llaisysHugePageMode_t;
+
+    // Llaisys API for choosing how the CPU runtime backs blocks of at least
+    // huge_page_min_bytes (0 for 2 MiB). Affects subsequent allocations only.
+    __export void llaisysSetCpuMemoryPolicy(llaisysHugePageMode_t, size_t huge_page_min_bytes);
 }
 
 #endif // LLAISYS_RUNTIME_H
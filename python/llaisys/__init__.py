@@ -2,6 +2,8 @@ from .runtime import RuntimeAPI
 from .libllaisys import DeviceType
 from .libllaisys import DataType
 from .libllaisys import MemcpyKind
+from .libllaisys import AllocatorType
+from .libllaisys import HugePageMode
 from .libllaisys import llaisysStream_t as Stream
 from .tensor import Tensor
 from .ops import Ops
@@ -13,6 +15,8 @@ __all__ = [
     "DeviceType",
     "DataType",
     "MemcpyKind",
+    "AllocatorType",
+    "HugePageMode",
     "Stream",
     "Tensor",
     "Ops",
@@ -4,11 +4,13 @@ import ctypes
 from pathlib import Path
 
 from .runtime import load_runtime
-from .runtime import LlaisysRuntimeAPI
+from .runtime import LlaisysRuntimeAPI, LlaisysMemoryStats
 from .llaisys_types import llaisysDeviceType_t, DeviceType
 from .llaisys_types import llaisysDataType_t, DataType
 from .llaisys_types import llaisysMemcpyKind_t, MemcpyKind
 from .llaisys_types import llaisysStream_t
+from .llaisys_types import llaisysAllocatorType_t, AllocatorType
+from .llaisys_types import llaisysHugePageMode_t, HugePageMode
 from .tensor import llaisysTensor_t
 from .tensor import load_tensor
 from .ops import load_ops
@@ -65,4 +67,9 @@ __all__ = [
     "llaisysMemcpyKind_t",
     "MemcpyKind",
     "llaisysStream_t",
+    "LlaisysMemoryStats",
+    "llaisysAllocatorType_t",
+    "AllocatorType",
+    "llaisysHugePageMode_t",
+    "HugePageMode",
 ]
@@ -52,6 +52,25 @@ llaisysMemcpyKind_t = ctypes.c_int
 # Stream type (opaque pointer)
 llaisysStream_t = ctypes.c_void_p
 
+
+# Memory Allocator enum
+class AllocatorType(IntEnum):
+    NAIVE = 0
+    CACHING = 1
+
+
+llaisysAllocatorType_t = ctypes.c_int
+
+
+# Huge Page Mode enum
+class HugePageMode(IntEnum):
+    NONE = 0
+    TRANSPARENT = 1
+    EXPLICIT = 2
+
+
+llaisysHugePageMode_t = ctypes.c_int
+
 __all__ = [
     "llaisysDeviceType_t",
     "DeviceType",
@@ -60,4 +79,8 @@ __all__ = [
     "llaisysMemcpyKind_t",
     "MemcpyKind",
     "llaisysStream_t",
+    "llaisysAllocatorType_t",
+    "AllocatorType",
+    "llaisysHugePageMode_t",
+    "HugePageMode",
 ]
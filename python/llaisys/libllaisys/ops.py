@@ -1,5 +1,5 @@
 from .tensor import llaisysTensor_t
-from ctypes import c_float
+from ctypes import c_float, c_size_t, POINTER
 
 def load_ops(lib):
     lib.llaisysAdd.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
@@ -14,6 +14,16 @@ def load_ops(lib):
     lib.llaisysLinear.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysLinear.restype = None
 
+    lib.llaisysLmHeadTopK.argtypes = [
+        llaisysTensor_t,  # topk_idx
+        llaisysTensor_t,  # topk_val
+        llaisysTensor_t,  # hidden
+        llaisysTensor_t,  # norm_w
+        llaisysTensor_t,  # weight
+        c_float    # eps
+    ]
+    lib.llaisysLmHeadTopK.restype = None
+
     lib.llaisysRearrange.argtypes = [llaisysTensor_t, llaisysTensor_t]
     lib.llaisysRearrange.restype = None
 
@@ -32,5 +42,16 @@ def load_ops(lib):
     ]
     lib.llaisysSelfAttention.restype = None
 
+    lib.llaisysSelfAttentionVarlen.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        POINTER(llaisysTensor_t),  # k, one per sequence
+        POINTER(llaisysTensor_t),  # v, one per sequence
+        POINTER(c_size_t),  # q_lens
+        c_size_t,  # nseq
+        c_float    # scale
+    ]
+    lib.llaisysSelfAttentionVarlen.restype = None
+
     lib.llaisysSwiGLU.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysSwiGLU.restype = None
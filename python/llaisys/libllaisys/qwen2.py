@@ -1,10 +1,16 @@
+from enum import IntEnum
 from ctypes import (
     Structure,
     POINTER,
     c_int64,
     c_float,
+    c_double,
     c_size_t,
     c_int,
+    c_uint64,
+    c_char_p,
+    c_void_p,
+    CFUNCTYPE,
 )
 from . import LIB_LLAISYS, llaisysTensor_t, llaisysDataType_t, llaisysDeviceType_t
 
@@ -23,6 +29,7 @@ class LlaisysQwen2Meta(Structure):
         ("epsilon", c_float),
         ("theta", c_float),
         ("end_token", c_int64),
+        ("act_dtype", llaisysDataType_t),
     ]
 
 
@@ -50,6 +57,140 @@ class LlaisysQwen2Model(Structure):
     pass
 
 
+class LlaisysQwen2LoadStats(Structure):
+    _fields_ = [
+        ("files", c_size_t),
+        ("mapped", c_size_t),
+        ("converted", c_size_t),
+        ("mapped_bytes", c_size_t),
+        ("copied_bytes", c_size_t),
+        ("read_ms", c_double),
+        ("convert_ms", c_double),
+        ("place_ms", c_double),
+        ("total_ms", c_double),
+    ]
+
+
+# (stage, done, total, user_data)，convert 阶段在加载线程上调用
+llaisysQwen2LoadProgress = CFUNCTYPE(None, c_char_p, c_size_t, c_size_t, c_void_p)
+
+
+class LlaisysQwen2LoadOptions(Structure):
+    _fields_ = [
+        ("nthreads", c_size_t),
+        ("readahead", c_int),
+        ("prefault", c_int),
+        ("progress", llaisysQwen2LoadProgress),
+        ("user_data", c_void_p),
+    ]
+
+
+class LlaisysQwen2LayerStreamStats(Structure):
+    _fields_ = [
+        ("prefetched", c_size_t),
+        ("released", c_size_t),
+        ("stalls", c_size_t),
+        ("stall_ms", c_double),
+    ]
+
+
+class LlaisysQwen2Sequence(Structure):
+    pass
+
+
+class LlaisysQwen2Session(Structure):
+    pass
+
+
+class KVEvictionPolicy(IntEnum):
+    DROP = 0
+    SPILL = 1
+
+
+class LlaisysQwen2KVStats(Structure):
+    _fields_ = [
+        ("budget_bytes", c_size_t),
+        ("used_bytes", c_size_t),
+        ("peak_bytes", c_size_t),
+        ("sessions", c_size_t),
+        ("resident_sessions", c_size_t),
+        ("hits", c_size_t),
+        ("misses", c_size_t),
+        ("evictions", c_size_t),
+        ("spilled_bytes", c_size_t),
+        ("reprefill_tokens", c_size_t),
+    ]
+
+
+class LlaisysQwen2Scheduler(Structure):
+    pass
+
+
+class LlaisysQwen2TokenEvent(Structure):
+    _fields_ = [
+        ("request_id", c_int64),
+        ("token", c_int64),
+        ("finished", c_int),
+    ]
+
+
+class LlaisysQwen2Speculator(Structure):
+    pass
+
+
+class LlaisysQwen2SpeculativeStats(Structure):
+    _fields_ = [
+        ("rounds", c_size_t),
+        ("drafted", c_size_t),
+        ("accepted", c_size_t),
+        ("emitted", c_size_t),
+    ]
+
+
+class LlaisysQwen2GenerateParams(Structure):
+    _fields_ = [
+        ("max_new_tokens", c_size_t),
+        ("temperature", c_float),
+        ("top_k", c_size_t),
+        ("top_p", c_float),
+        ("seed", c_uint64),
+        ("stop_tokens", POINTER(c_int64)),
+        ("nstop_tokens", c_size_t),
+        ("stop_sequences", POINTER(c_int64)),
+        ("stop_sequence_lens", POINTER(c_size_t)),
+        ("nstop_sequences", c_size_t),
+        ("reuse_kv", c_int),
+    ]
+
+
+class StopReason(IntEnum):
+    MAX_TOKENS = 0
+    STOP_TOKEN = 1
+    STOP_SEQUENCE = 2
+    MAXSEQ = 3
+    CALLBACK = 4
+
+
+class LlaisysQwen2GenerateResult(Structure):
+    _fields_ = [
+        ("ntoken", c_size_t),
+        ("reused", c_size_t),
+        ("stop_reason", c_int),
+    ]
+
+
+# 返回非 0 时停止生成
+llaisysQwen2TokenCallback = CFUNCTYPE(c_int, c_int64, c_void_p)
+
+
+class LlaisysQwen2TokenRing(Structure):
+    pass
+
+
+class LlaisysQwen2Engine(Structure):
+    pass
+
+
 def load_qwen2(lib):
     """加载 Qwen2 相关函数签名"""
     # 函数声明
@@ -70,9 +211,256 @@ def load_qwen2(lib):
     lib.llaisysQwen2ModelInfer.argtypes = [POINTER(LlaisysQwen2Model), POINTER(c_int64), c_size_t]
     lib.llaisysQwen2ModelInfer.restype = c_int64
 
+    lib.llaisysQwen2ModelLoadSafetensors.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        c_char_p,
+        POINTER(LlaisysQwen2LoadStats),
+    ]
+    lib.llaisysQwen2ModelLoadSafetensors.restype = c_int
+
+    lib.llaisysQwen2ModelLoadSafetensorsWithOptions.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        c_char_p,
+        POINTER(LlaisysQwen2LoadOptions),
+        POINTER(LlaisysQwen2LoadStats),
+    ]
+    lib.llaisysQwen2ModelLoadSafetensorsWithOptions.restype = c_int
+
+    lib.llaisysQwen2ReadLlaisysMeta.argtypes = [c_char_p, POINTER(LlaisysQwen2Meta)]
+    lib.llaisysQwen2ReadLlaisysMeta.restype = c_int
+
+    lib.llaisysQwen2ModelLoadLlaisys.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        c_char_p,
+        POINTER(LlaisysQwen2LoadOptions),
+        POINTER(LlaisysQwen2LoadStats),
+    ]
+    lib.llaisysQwen2ModelLoadLlaisys.restype = c_int
+
+    lib.llaisysQwen2ModelSaveLlaisys.argtypes = [POINTER(LlaisysQwen2Model), c_char_p]
+    lib.llaisysQwen2ModelSaveLlaisys.restype = c_int
+
+    lib.llaisysQwen2ModelAttachSharedWeights.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        c_char_p,
+        c_char_p,
+        POINTER(LlaisysQwen2LoadOptions),
+        POINTER(LlaisysQwen2LoadStats),
+        POINTER(c_int),
+    ]
+    lib.llaisysQwen2ModelAttachSharedWeights.restype = c_int
+
+    lib.llaisysQwen2ModelSetLayerStreaming.argtypes = [POINTER(LlaisysQwen2Model), c_size_t, c_int]
+    lib.llaisysQwen2ModelSetLayerStreaming.restype = c_int
+
+    lib.llaisysQwen2ModelLayerStreamStats.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        POINTER(LlaisysQwen2LayerStreamStats),
+    ]
+    lib.llaisysQwen2ModelLayerStreamStats.restype = c_int
+
+    lib.llaisysQwen2ModelFoldNormWeights.argtypes = [POINTER(LlaisysQwen2Model)]
+    lib.llaisysQwen2ModelFoldNormWeights.restype = c_int
+
     lib.llaisysQwen2ModelReset.argtypes = [POINTER(LlaisysQwen2Model)]
     lib.llaisysQwen2ModelReset.restype = None
 
+    lib.llaisysQwen2ModelInferReuse.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        POINTER(c_int64),
+        c_size_t,
+        POINTER(c_size_t),
+    ]
+    lib.llaisysQwen2ModelInferReuse.restype = c_int64
+
+    lib.llaisysQwen2ModelSetGraphCapture.argtypes = [POINTER(LlaisysQwen2Model), c_int]
+    lib.llaisysQwen2ModelSetGraphCapture.restype = None
+
+    lib.llaisysQwen2SequenceCreate.argtypes = [POINTER(LlaisysQwen2Model)]
+    lib.llaisysQwen2SequenceCreate.restype = POINTER(LlaisysQwen2Sequence)
+
+    lib.llaisysQwen2SequenceDestroy.argtypes = [POINTER(LlaisysQwen2Sequence)]
+    lib.llaisysQwen2SequenceDestroy.restype = None
+
+    lib.llaisysQwen2SequenceReset.argtypes = [POINTER(LlaisysQwen2Sequence)]
+    lib.llaisysQwen2SequenceReset.restype = None
+
+    lib.llaisysQwen2SequenceInfer.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        POINTER(LlaisysQwen2Sequence),
+        POINTER(c_int64),
+        c_size_t,
+    ]
+    lib.llaisysQwen2SequenceInfer.restype = c_int64
+
+    lib.llaisysQwen2ModelInferBatch.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        POINTER(POINTER(LlaisysQwen2Sequence)),
+        POINTER(c_int64),
+        c_size_t,
+        POINTER(c_int64),
+    ]
+    lib.llaisysQwen2ModelInferBatch.restype = c_int
+
+    lib.llaisysQwen2SessionCreate.argtypes = [POINTER(LlaisysQwen2Model)]
+    lib.llaisysQwen2SessionCreate.restype = POINTER(LlaisysQwen2Session)
+
+    lib.llaisysQwen2SessionDestroy.argtypes = [POINTER(LlaisysQwen2Session)]
+    lib.llaisysQwen2SessionDestroy.restype = None
+
+    lib.llaisysQwen2SessionInfer.argtypes = [POINTER(LlaisysQwen2Session), POINTER(c_int64), c_size_t]
+    lib.llaisysQwen2SessionInfer.restype = c_int64
+
+    lib.llaisysQwen2SessionReset.argtypes = [POINTER(LlaisysQwen2Session)]
+    lib.llaisysQwen2SessionReset.restype = None
+
+    lib.llaisysQwen2SessionLength.argtypes = [POINTER(LlaisysQwen2Session)]
+    lib.llaisysQwen2SessionLength.restype = c_size_t
+
+    lib.llaisysQwen2SessionKVBytes.argtypes = [POINTER(LlaisysQwen2Session)]
+    lib.llaisysQwen2SessionKVBytes.restype = c_size_t
+
+    lib.llaisysQwen2ModelSetKVBudget.argtypes = [POINTER(LlaisysQwen2Model), c_size_t, c_int, c_char_p]
+    lib.llaisysQwen2ModelSetKVBudget.restype = c_int
+
+    lib.llaisysQwen2ModelGetKVStats.argtypes = [POINTER(LlaisysQwen2Model), POINTER(LlaisysQwen2KVStats)]
+    lib.llaisysQwen2ModelGetKVStats.restype = None
+
+    lib.llaisysQwen2SchedulerCreate.argtypes = [POINTER(LlaisysQwen2Model), c_size_t, c_size_t]
+    lib.llaisysQwen2SchedulerCreate.restype = POINTER(LlaisysQwen2Scheduler)
+
+    lib.llaisysQwen2SchedulerDestroy.argtypes = [POINTER(LlaisysQwen2Scheduler)]
+    lib.llaisysQwen2SchedulerDestroy.restype = None
+
+    lib.llaisysQwen2SchedulerSubmit.argtypes = [
+        POINTER(LlaisysQwen2Scheduler),
+        POINTER(c_int64),
+        c_size_t,
+        c_size_t,
+    ]
+    lib.llaisysQwen2SchedulerSubmit.restype = c_int64
+
+    lib.llaisysQwen2SchedulerCancel.argtypes = [POINTER(LlaisysQwen2Scheduler), c_int64]
+    lib.llaisysQwen2SchedulerCancel.restype = c_int
+
+    lib.llaisysQwen2SchedulerStep.argtypes = [POINTER(LlaisysQwen2Scheduler)]
+    lib.llaisysQwen2SchedulerStep.restype = c_int64
+
+    lib.llaisysQwen2SchedulerPoll.argtypes = [
+        POINTER(LlaisysQwen2Scheduler),
+        POINTER(LlaisysQwen2TokenEvent),
+        c_size_t,
+    ]
+    lib.llaisysQwen2SchedulerPoll.restype = c_size_t
+
+    lib.llaisysQwen2SchedulerHasWork.argtypes = [POINTER(LlaisysQwen2Scheduler)]
+    lib.llaisysQwen2SchedulerHasWork.restype = c_int
+
+    lib.llaisysQwen2SpeculatorCreate.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        POINTER(LlaisysQwen2Model),
+        c_size_t,
+        c_float,
+        c_size_t,
+        c_uint64,
+    ]
+    lib.llaisysQwen2SpeculatorCreate.restype = POINTER(LlaisysQwen2Speculator)
+
+    lib.llaisysQwen2SpeculatorDestroy.argtypes = [POINTER(LlaisysQwen2Speculator)]
+    lib.llaisysQwen2SpeculatorDestroy.restype = None
+
+    lib.llaisysQwen2SpeculatorStart.argtypes = [POINTER(LlaisysQwen2Speculator), POINTER(c_int64), c_size_t]
+    lib.llaisysQwen2SpeculatorStart.restype = c_int64
+
+    lib.llaisysQwen2SpeculatorStep.argtypes = [POINTER(LlaisysQwen2Speculator), POINTER(c_int64)]
+    lib.llaisysQwen2SpeculatorStep.restype = c_int64
+
+    lib.llaisysQwen2SpeculatorGetStats.argtypes = [
+        POINTER(LlaisysQwen2Speculator),
+        POINTER(LlaisysQwen2SpeculativeStats),
+    ]
+    lib.llaisysQwen2SpeculatorGetStats.restype = None
+
+    lib.llaisysQwen2SchedulerSubmitWithLookup.argtypes = [
+        POINTER(LlaisysQwen2Scheduler),
+        POINTER(c_int64),
+        c_size_t,
+        c_size_t,
+        c_size_t,
+        c_size_t,
+    ]
+    lib.llaisysQwen2SchedulerSubmitWithLookup.restype = c_int64
+
+    lib.llaisysQwen2SchedulerGetLookupStats.argtypes = [
+        POINTER(LlaisysQwen2Scheduler),
+        POINTER(LlaisysQwen2SpeculativeStats),
+    ]
+    lib.llaisysQwen2SchedulerGetLookupStats.restype = None
+
+    lib.llaisysQwen2TokenRingCreate.argtypes = [c_size_t]
+    lib.llaisysQwen2TokenRingCreate.restype = POINTER(LlaisysQwen2TokenRing)
+
+    lib.llaisysQwen2TokenRingDestroy.argtypes = [POINTER(LlaisysQwen2TokenRing)]
+    lib.llaisysQwen2TokenRingDestroy.restype = None
+
+    lib.llaisysQwen2TokenRingPop.argtypes = [
+        POINTER(LlaisysQwen2TokenRing),
+        POINTER(c_int64),
+        c_size_t,
+        c_int,
+    ]
+    lib.llaisysQwen2TokenRingPop.restype = c_size_t
+
+    lib.llaisysQwen2TokenRingFinished.argtypes = [POINTER(LlaisysQwen2TokenRing)]
+    lib.llaisysQwen2TokenRingFinished.restype = c_int
+
+    lib.llaisysQwen2ModelGenerate.argtypes = [
+        POINTER(LlaisysQwen2Model),
+        POINTER(c_int64),
+        c_size_t,
+        POINTER(LlaisysQwen2GenerateParams),
+        llaisysQwen2TokenCallback,
+        c_void_p,
+        POINTER(LlaisysQwen2TokenRing),
+        POINTER(LlaisysQwen2GenerateResult),
+    ]
+    lib.llaisysQwen2ModelGenerate.restype = c_int
+
+    lib.llaisysQwen2EngineCreate.argtypes = [POINTER(LlaisysQwen2Model), c_size_t, c_size_t]
+    lib.llaisysQwen2EngineCreate.restype = POINTER(LlaisysQwen2Engine)
+
+    lib.llaisysQwen2EngineDestroy.argtypes = [POINTER(LlaisysQwen2Engine)]
+    lib.llaisysQwen2EngineDestroy.restype = None
+
+    lib.llaisysQwen2EngineSubmit.argtypes = [
+        POINTER(LlaisysQwen2Engine),
+        POINTER(c_int64),
+        c_size_t,
+        c_size_t,
+        c_size_t,
+        c_size_t,
+    ]
+    lib.llaisysQwen2EngineSubmit.restype = c_int64
+
+    lib.llaisysQwen2EngineCancel.argtypes = [POINTER(LlaisysQwen2Engine), c_int64]
+    lib.llaisysQwen2EngineCancel.restype = c_int
+
+    lib.llaisysQwen2EnginePoll.argtypes = [
+        POINTER(LlaisysQwen2Engine),
+        POINTER(LlaisysQwen2TokenEvent),
+        c_size_t,
+    ]
+    lib.llaisysQwen2EnginePoll.restype = c_size_t
+
+    lib.llaisysQwen2EngineWait.argtypes = [POINTER(LlaisysQwen2Engine), c_int]
+    lib.llaisysQwen2EngineWait.restype = c_int
+
+    lib.llaisysQwen2EngineFd.argtypes = [POINTER(LlaisysQwen2Engine)]
+    lib.llaisysQwen2EngineFd.restype = c_int
+
+    lib.llaisysQwen2EngineNumActive.argtypes = [POINTER(LlaisysQwen2Engine)]
+    lib.llaisysQwen2EngineNumActive.restype = c_size_t
+
 
 # 在模块加载时初始化
 load_qwen2(LIB_LLAISYS)
@@ -38,6 +38,20 @@ class LlaisysRuntimeAPI(Structure):
     ]
 
 
+class LlaisysMemoryStats(Structure):
+    _fields_ = [
+        ("allocated_bytes", c_size_t),
+        ("peak_allocated_bytes", c_size_t),
+        ("reserved_bytes", c_size_t),
+        ("cached_bytes", c_size_t),
+        ("num_allocs", c_size_t),
+        ("num_frees", c_size_t),
+        ("num_cache_hits", c_size_t),
+        ("num_device_mallocs", c_size_t),
+        ("num_device_frees", c_size_t),
+    ]
+
+
 # Load shared library
 def load_runtime(lib):
     # Declare API function prototypes
@@ -46,3 +60,24 @@ def load_runtime(lib):
 
     lib.llaisysSetContextRuntime.argtypes = [llaisysDeviceType_t, c_int]
     lib.llaisysSetContextRuntime.restype = None
+
+    lib.llaisysSetContextAllocator.argtypes = [
+        llaisysDeviceType_t,
+        c_int,
+        llaisysAllocatorType_t,
+        c_size_t,
+    ]
+    lib.llaisysSetContextAllocator.restype = None
+
+    lib.llaisysGetContextMemoryStats.argtypes = [
+        llaisysDeviceType_t,
+        c_int,
+        ctypes.POINTER(LlaisysMemoryStats),
+    ]
+    lib.llaisysGetContextMemoryStats.restype = None
+
+    lib.llaisysTrimContextAllocator.argtypes = [llaisysDeviceType_t, c_int]
+    lib.llaisysTrimContextAllocator.restype = None
+
+    lib.llaisysSetCpuMemoryPolicy.argtypes = [llaisysHugePageMode_t, c_size_t]
+    lib.llaisysSetCpuMemoryPolicy.restype = None
@@ -1 +1 @@
-from .qwen2 import Qwen2
+from .qwen2 import Qwen2, Qwen2Engine, Qwen2Scheduler, Qwen2Session
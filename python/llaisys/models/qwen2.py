@@ -1,48 +1,78 @@
-from typing import Sequence
+from typing import Callable, Optional, Sequence
 from ..libllaisys import LIB_LLAISYS, DataType, DeviceType
 from ..libllaisys.qwen2 import (
     LlaisysQwen2Meta,
     LlaisysQwen2Weights,
     LlaisysQwen2Model,
+    LlaisysQwen2Sequence,
+    LlaisysQwen2TokenEvent,
+    LlaisysQwen2SpeculativeStats,
+    LlaisysQwen2KVStats,
+    LlaisysQwen2LoadStats,
+    LlaisysQwen2LoadOptions,
+    LlaisysQwen2LayerStreamStats,
+    llaisysQwen2LoadProgress,
+    KVEvictionPolicy,
+    LlaisysQwen2GenerateParams,
+    LlaisysQwen2GenerateResult,
+    StopReason,
+    llaisysQwen2TokenCallback,
 )
 from ..tensor import Tensor
 
 from pathlib import Path
-import safetensors
 import json
-from ctypes import c_int, c_int64, POINTER, cast
+from ctypes import c_int, c_int64, c_size_t, POINTER, byref, cast
 
 
 class Qwen2:
-    def __init__(self, model_path, device: DeviceType = DeviceType.CPU):
+    def __init__(
+        self,
+        model_path,
+        device: DeviceType = DeviceType.CPU,
+        load_threads: int = 0,
+        on_load_progress: Optional[Callable[[str, int, int], None]] = None,
+        stream_layers: int = 0,
+        shared_weights: Optional[str] = None,
+        activation_dtype: Optional[DataType] = None,
+        fold_norm_weights: bool = False,
+    ):
         model_path = Path(model_path)
         
-        # 1. 加载配置
-        with open(model_path / "config.json", "r") as f:
-            hf_config = json.load(f)
-        
-        # 2. 创建元数据
+        # model_path 为 .llaisys 文件时配置嵌入在文件中，权重直接映射（见 llaisys-convert）
+        is_llaisys = model_path.is_file() and model_path.suffix == ".llaisys"
+
+        # 1. 加载配置 / 2. 创建元数据
         meta = LlaisysQwen2Meta()
-        meta.dtype = DataType.BF16
-        meta.nlayer = hf_config["num_hidden_layers"]
-        meta.hs = hf_config["hidden_size"]
-        meta.nh = hf_config["num_attention_heads"]
-        meta.nkvh = hf_config.get("num_key_value_heads", meta.nh)
-        meta.dh = meta.hs // meta.nh
-        meta.di = hf_config["intermediate_size"]
-        # 限制最大序列长度，避免 KV-Cache 内存过大
-        # 原始 max_position_embeddings 可能是 131072，这会导致内存爆炸
-        raw_maxseq = hf_config.get("max_position_embeddings", 2048)
-        meta.maxseq = min(raw_maxseq, 4096)  # 限制为 4096
-        meta.voc = hf_config["vocab_size"]
-        meta.epsilon = hf_config.get("rms_norm_eps", 1e-6)
-        meta.theta = hf_config.get("rope_theta", 10000.0)
-        meta.end_token = hf_config.get("eos_token_id", 151643)
+        if is_llaisys:
+            if LIB_LLAISYS.llaisysQwen2ReadLlaisysMeta(str(model_path).encode(), byref(meta)) != 0:
+                raise RuntimeError(f"Failed to read {model_path}")
+        else:
+            with open(model_path / "config.json", "r") as f:
+                hf_config = json.load(f)
+
+            meta.dtype = DataType.BF16
+            meta.nlayer = hf_config["num_hidden_layers"]
+            meta.hs = hf_config["hidden_size"]
+            meta.nh = hf_config["num_attention_heads"]
+            meta.nkvh = hf_config.get("num_key_value_heads", meta.nh)
+            meta.dh = meta.hs // meta.nh
+            meta.di = hf_config["intermediate_size"]
+            # 限制最大序列长度，避免 KV-Cache 内存过大
+            # 原始 max_position_embeddings 可能是 131072，这会导致内存爆炸
+            raw_maxseq = hf_config.get("max_position_embeddings", 2048)
+            meta.maxseq = min(raw_maxseq, 4096)  # 限制为 4096
+            meta.voc = hf_config["vocab_size"]
+            meta.epsilon = hf_config.get("rms_norm_eps", 1e-6)
+            meta.theta = hf_config.get("rope_theta", 10000.0)
+            meta.end_token = hf_config.get("eos_token_id", 151643)
+        # activation_dtype 为 DataType.F32 时权重保持 bf16，激活、残差流与 KV-Cache 使用 f32
+        if activation_dtype is not None:
+            meta.act_dtype = DataType(activation_dtype)
         
         print(f"Model config: nlayer={meta.nlayer}, hs={meta.hs}, nh={meta.nh}, nkvh={meta.nkvh}, dh={meta.dh}, di={meta.di}, voc={meta.voc}")
         
         # 3. 创建模型
-        from ctypes import byref
         self._model = LIB_LLAISYS.llaisysQwen2ModelCreate(
             byref(meta),  # 传递指针
             DeviceType(device),
@@ -73,107 +103,102 @@ class Qwen2:
         if not self._weights.in_embed or not self._weights.out_embed or not self._weights.out_norm_w:
             raise RuntimeError("One or more weight tensors are NULL!")
         
-        # 5. 加载权重
+        # 5. 加载权重：原生加载器映射 safetensors 文件并预读，dtype 转换由 load_threads 个线程并行完成
+        #    （0 为硬件线程数）；on_load_progress(stage, done, total) 报告各阶段进度。
+        #    stream_layers > 0 时逐层流式执行：不预读整个文件，前向时提前 stream_layers 层预取权重。
+        #    shared_weights 为映像路径（如 /dev/shm/qwen2.llaisys）时与其他进程共享同一份只读权重
         print("Loading weights...", flush=True)
-        self._load_weights(model_path)
-        print("Model loaded successfully!", flush=True)
+        options = LlaisysQwen2LoadOptions()
+        options.nthreads = load_threads
+        options.readahead = 0 if stream_layers > 0 else 1
+        options.prefault = 0 if stream_layers > 0 else 1
+        progress = None
+        if on_load_progress is not None:
+            progress = llaisysQwen2LoadProgress(
+                lambda stage, done, total, _: on_load_progress(stage.decode(), done, total)
+            )
+            options.progress = progress
+        stats = LlaisysQwen2LoadStats()
+        if shared_weights is not None:
+            created = c_int(0)
+            rc = LIB_LLAISYS.llaisysQwen2ModelAttachSharedWeights(
+                self._model, str(shared_weights).encode(), str(model_path).encode(),
+                byref(options), byref(stats), byref(created)
+            )
+            self.created_shared_weights = bool(created.value)
+        elif is_llaisys:
+            rc = LIB_LLAISYS.llaisysQwen2ModelLoadLlaisys(
+                self._model, str(model_path).encode(), byref(options), byref(stats)
+            )
+        else:
+            rc = LIB_LLAISYS.llaisysQwen2ModelLoadSafetensorsWithOptions(
+                self._model, str(model_path).encode(), byref(options), byref(stats)
+            )
+        if rc != 0:
+            raise RuntimeError(f"Failed to load weights from {model_path}")
+        self.load_stats = stats
+        print(
+            f"Model loaded successfully! files={stats.files}, mapped={stats.mapped}, "
+            f"converted={stats.converted}, read={stats.read_ms:.0f}ms, "
+            f"convert={stats.convert_ms:.0f}ms, place={stats.place_ms:.0f}ms, "
+            f"total={stats.total_ms:.0f}ms",
+            flush=True,
+        )
+        # 6. 可选的权重优化：RMSNorm 权重折叠进投影，q/k/v 合并（须在设置流式执行之前）
+        if fold_norm_weights:
+            self.fold_norm_weights()
+        if stream_layers > 0:
+            self.set_layer_streaming(stream_layers)
+
+    def set_layer_streaming(self, lookahead: int, drop_finished: bool = False):
+        """逐层流式执行映射的权重，lookahead 为 0 时关闭；重新加载或折叠权重会关闭流式执行，之后需要再次设置"""
+        if LIB_LLAISYS.llaisysQwen2ModelSetLayerStreaming(self._model, lookahead, int(drop_finished)) != 0:
+            raise RuntimeError("Failed to set layer streaming")
+
+    def fold_norm_weights(self):
+        """把 RMSNorm 权重折叠进 q/k/v 与 gate/up，并合并 q/k/v 投影；之后不能再加载权重"""
+        if LIB_LLAISYS.llaisysQwen2ModelFoldNormWeights(self._model) != 0:
+            raise RuntimeError("Failed to fold norm weights")
+
+    @property
+    def layer_stream_stats(self) -> Optional[LlaisysQwen2LayerStreamStats]:
+        stats = LlaisysQwen2LayerStreamStats()
+        if LIB_LLAISYS.llaisysQwen2ModelLayerStreamStats(self._model, byref(stats)) != 0:
+            return None
+        return stats
     
     def __del__(self):
         if hasattr(self, "_model") and self._model:
             LIB_LLAISYS.llaisysQwen2ModelDestroy(self._model)
             self._model = None
     
-    def _load_weights(self, model_path):
-        """从 safetensors 文件加载权重"""
-        import torch
-        
-        # 收集所有权重名称，检查是否有 tied embeddings
-        all_weight_names = set()
-        for file in sorted(model_path.glob("*.safetensors")):
-            with safetensors.safe_open(str(file), framework="pt", device="cpu") as f:
-                all_weight_names.update(f.keys())
-        
-        # 检查是否需要复制 embed_tokens 到 lm_head（tied embeddings）
-        has_lm_head = "lm_head.weight" in all_weight_names
-        
-        for file in sorted(model_path.glob("*.safetensors")):
-            # 使用 PyTorch 框架读取，因为 NumPy 不支持 bfloat16
-            with safetensors.safe_open(str(file), framework="pt", device="cpu") as f:
-                for name in f.keys():
-                    tensor_data = f.get_tensor(name)
-                    self._load_single_weight(name, tensor_data, has_lm_head)
-    
-    def _load_single_weight(self, name: str, data, has_lm_head: bool = True):
-        """将单个权重加载到对应的张量"""
-        import ctypes
-        
-        # PyTorch 张量需要先确保是连续的，然后获取数据指针
-        if not data.is_contiguous():
-            data = data.contiguous()
-        
-        # 获取 PyTorch 张量的数据指针
-        data_ptr = ctypes.c_void_p(data.data_ptr())
-        
-        def safe_tensor_load(tensor_ptr, data_ptr, tensor_name):
-            """安全地调用 tensorLoad，带有详细的错误信息"""
-            if not tensor_ptr:
-                raise RuntimeError(f"Tensor pointer for '{tensor_name}' is NULL!")
-            print(f"    tensorLoad({tensor_name}={hex(tensor_ptr)}, data_ptr={hex(data_ptr.value)})", flush=True)
-            LIB_LLAISYS.tensorLoad(tensor_ptr, data_ptr)
-        
-        # 根据名称匹配到对应的张量
-        if name == "model.embed_tokens.weight":
-            print(f"  Loading {name}: shape={list(data.shape)}, dtype={data.dtype}", flush=True)
-            safe_tensor_load(self._weights.in_embed, data_ptr, "in_embed")
-            # 如果没有单独的 lm_head，则复制 embed_tokens 到 lm_head (tied embeddings)
-            if not has_lm_head:
-                print(f"  Copying embed_tokens to lm_head (tied embeddings)", flush=True)
-                safe_tensor_load(self._weights.out_embed, data_ptr, "out_embed")
-        elif name == "lm_head.weight":
-            print(f"  Loading {name}: shape={list(data.shape)}, dtype={data.dtype}", flush=True)
-            safe_tensor_load(self._weights.out_embed, data_ptr, "out_embed")
-        elif name == "model.norm.weight":
-            print(f"  Loading {name}: shape={list(data.shape)}, dtype={data.dtype}", flush=True)
-            safe_tensor_load(self._weights.out_norm_w, data_ptr, "out_norm_w")
-        else:
-            # 解析层权重
-            self._load_layer_weight(name, data, data_ptr)
-    
-    def _load_layer_weight(self, name: str, data, data_ptr):
-        """加载层权重"""
-        import re
-        
-        # 匹配模式: model.layers.{layer_idx}.{component}.{param}
-        match = re.match(r"model\.layers\.(\d+)\.(.+)", name)
-        if not match:
-            print(f"Warning: Unknown weight name: {name}")
-            return
-        
-        layer_idx = int(match.group(1))
-        component_name = match.group(2)
-        
-        weight_mapping = {
-            "input_layernorm.weight": ("attn_norm_w", layer_idx),
-            "self_attn.q_proj.weight": ("attn_q_w", layer_idx),
-            "self_attn.q_proj.bias": ("attn_q_b", layer_idx),
-            "self_attn.k_proj.weight": ("attn_k_w", layer_idx),
-            "self_attn.k_proj.bias": ("attn_k_b", layer_idx),
-            "self_attn.v_proj.weight": ("attn_v_w", layer_idx),
-            "self_attn.v_proj.bias": ("attn_v_b", layer_idx),
-            "self_attn.o_proj.weight": ("attn_o_w", layer_idx),
-            "post_attention_layernorm.weight": ("mlp_norm_w", layer_idx),
-            "mlp.gate_proj.weight": ("mlp_gate_w", layer_idx),
-            "mlp.up_proj.weight": ("mlp_up_w", layer_idx),
-            "mlp.down_proj.weight": ("mlp_down_w", layer_idx),
-        }
-        
-        if component_name in weight_mapping:
-            attr_name, idx = weight_mapping[component_name]
-            tensor = getattr(self._weights, attr_name)[idx]
-            LIB_LLAISYS.tensorLoad(tensor, data_ptr)
-        else:
-            print(f"Warning: Unknown component: {component_name}")
-    
+    def save(self, path):
+        """把当前权重写成 .llaisys 文件，之后可直接用 Qwen2(path) 映射加载"""
+        if LIB_LLAISYS.llaisysQwen2ModelSaveLlaisys(self._model, str(path).encode()) != 0:
+            raise RuntimeError(f"Failed to save {path}")
+
+    def set_graph_capture(self, enable: bool):
+        """开关执行计划回放；关闭后每步逐个调用算子（用于对比验证）"""
+        LIB_LLAISYS.llaisysQwen2ModelSetGraphCapture(self._model, int(enable))
+
+    def set_kv_budget(
+        self,
+        budget_bytes: int,
+        policy: KVEvictionPolicy = KVEvictionPolicy.DROP,
+        spill_dir: str = None,
+    ):
+        """设置所有会话共享的 KV 内存预算（0 为不限制），超出时按 LRU 驱逐空闲会话"""
+        if LIB_LLAISYS.llaisysQwen2ModelSetKVBudget(
+            self._model, budget_bytes, KVEvictionPolicy(policy),
+            spill_dir.encode() if spill_dir else None,
+        ) != 0:
+            raise RuntimeError("Failed to set KV budget")
+
+    def kv_stats(self):
+        stats = LlaisysQwen2KVStats()
+        LIB_LLAISYS.llaisysQwen2ModelGetKVStats(self._model, byref(stats))
+        return {name: getattr(stats, name) for name, _ in LlaisysQwen2KVStats._fields_}
+
     def generate(
         self,
         inputs: Sequence[int],
@@ -181,39 +206,371 @@ class Qwen2:
         top_k: int = 1,
         top_p: float = 0.8,
         temperature: float = 0.8,
+        reuse_kv: bool = True,
+        stop_tokens: Sequence[int] = (),
+        stop_sequences: Sequence[Sequence[int]] = (),
+        seed: int = 0,
+        on_token: Optional[Callable[[int], bool]] = None,
     ):
-        """生成文本序列"""
+        """生成文本序列，整个解码循环在 C++ 中运行（调用期间释放 GIL）。
+        top_k 为 1 或 temperature <= 0 时为贪心，否则按 top_k / top_p / temperature 采样。
+        生成到 end_token 或 stop_tokens 中的 token（会输出）、以 stop_sequences 中的序列结尾
+        （不输出）或 max_new_tokens 为止。on_token 每输出一个 token 调用一次，返回 False 时停止。
+        reuse_kv 为真时 inputs 与上一次调用已处理的 token 的公共前缀复用 KV-Cache，
+        多轮对话中传入完整历史也只预填充新的一轮；复用的 token 数记录在 last_reused_tokens，
+        停止原因记录在 last_stop_reason"""
         if max_new_tokens is None:
             max_new_tokens = 128
         
-        # 重置模型状态
-        LIB_LLAISYS.llaisysQwen2ModelReset(self._model)
-        
-        # 转换输入为 ctypes 数组
         tokens = list(inputs)
-        
-        # 第一次推理（处理整个 prompt）
         token_array = (c_int64 * len(tokens))(*tokens)
-        next_token = LIB_LLAISYS.llaisysQwen2ModelInfer(self._model, token_array, len(tokens))
         
-        if next_token < 0:
-            raise RuntimeError("Inference failed")
+        params = LlaisysQwen2GenerateParams()
+        params.max_new_tokens = max_new_tokens
+        params.temperature = temperature
+        params.top_k = top_k
+        params.top_p = top_p
+        params.seed = seed
+        stop_token_array = (c_int64 * len(stop_tokens))(*stop_tokens)
+        params.stop_tokens = stop_token_array
+        params.nstop_tokens = len(stop_tokens)
+        # 停止序列首尾相接传入
+        flat = [t for s in stop_sequences for t in s]
+        stop_seq_array = (c_int64 * len(flat))(*flat)
+        stop_len_array = (c_size_t * len(stop_sequences))(*[len(s) for s in stop_sequences])
+        params.stop_sequences = stop_seq_array
+        params.stop_sequence_lens = stop_len_array
+        params.nstop_sequences = len(stop_sequences)
+        params.reuse_kv = int(reuse_kv)
         
-        tokens.append(next_token)
+        if on_token is not None:
+            callback = llaisysQwen2TokenCallback(lambda token, _: int(on_token(token) is False))
+        else:
+            callback = llaisysQwen2TokenCallback()
+        
+        # 队列容量不小于 max_new_tokens，生成过程中不会阻塞，结束后一次取出
+        ring = LIB_LLAISYS.llaisysQwen2TokenRingCreate(max_new_tokens)
+        if not ring:
+            raise RuntimeError("Failed to create token ring")
+        try:
+            result = LlaisysQwen2GenerateResult()
+            if LIB_LLAISYS.llaisysQwen2ModelGenerate(
+                self._model, token_array, len(tokens), byref(params), callback, None, ring, byref(result)
+            ) != 0:
+                raise RuntimeError("Inference failed")
+            out = (c_int64 * max_new_tokens)()
+            n = LIB_LLAISYS.llaisysQwen2TokenRingPop(ring, out, max_new_tokens, 0)
+        finally:
+            LIB_LLAISYS.llaisysQwen2TokenRingDestroy(ring)
         
-        # 自回归生成
-        for _ in range(max_new_tokens - 1):
-            # 只输入最后一个 token（使用 KV-Cache）
-            token_array = (c_int64 * 1)(tokens[-1])
-            next_token = LIB_LLAISYS.llaisysQwen2ModelInfer(self._model, token_array, 1)
-            
+        self.last_reused_tokens = result.reused
+        self.last_stop_reason = StopReason(result.stop_reason)
+        return tokens + out[:n]
+
+    def generate_batch(
+        self,
+        inputs: Sequence[Sequence[int]],
+        max_new_tokens: int = None,
+    ):
+        """多条序列贪心生成：各自预填充后，每步一次前向为所有未结束的序列解码"""
+        if max_new_tokens is None:
+            max_new_tokens = 128
+
+        outputs = [list(x) for x in inputs]
+        seqs = [LIB_LLAISYS.llaisysQwen2SequenceCreate(self._model) for _ in outputs]
+        try:
+            active = []
+            for i, (seq, tokens) in enumerate(zip(seqs, outputs)):
+                token_array = (c_int64 * len(tokens))(*tokens)
+                next_token = LIB_LLAISYS.llaisysQwen2SequenceInfer(
+                    self._model, seq, token_array, len(tokens)
+                )
+                if next_token < 0:
+                    raise RuntimeError("Inference failed")
+                tokens.append(next_token)
+                if next_token != self._meta.end_token:
+                    active.append(i)
+
+            for _ in range(max_new_tokens - 1):
+                if not active:
+                    break
+                n = len(active)
+                seq_array = (POINTER(LlaisysQwen2Sequence) * n)(*[seqs[i] for i in active])
+                token_array = (c_int64 * n)(*[outputs[i][-1] for i in active])
+                next_array = (c_int64 * n)()
+                if LIB_LLAISYS.llaisysQwen2ModelInferBatch(
+                    self._model, seq_array, token_array, n, next_array
+                ) != 0:
+                    raise RuntimeError("Inference failed")
+                for i, next_token in zip(active, next_array):
+                    outputs[i].append(next_token)
+                active = [i for i in active if outputs[i][-1] != self._meta.end_token]
+        finally:
+            for seq in seqs:
+                LIB_LLAISYS.llaisysQwen2SequenceDestroy(seq)
+
+        return outputs
+
+    def generate_speculative(
+        self,
+        inputs: Sequence[int],
+        draft: "Qwen2",
+        max_new_tokens: int = None,
+        num_draft: int = 4,
+        top_k: int = 1,
+        temperature: float = 0.0,
+        seed: int = 0,
+    ):
+        """投机解码：draft 每轮提出 num_draft 个 token，本模型一次前向验证。
+        temperature <= 0 时为贪心，结果与 generate 相同。
+        返回 (tokens, stats)，stats 含 rounds / drafted / accepted / acceptance_rate"""
+        if max_new_tokens is None:
+            max_new_tokens = 128
+
+        spec = LIB_LLAISYS.llaisysQwen2SpeculatorCreate(
+            self._model, draft._model, num_draft, temperature, top_k, seed
+        )
+        if not spec:
+            raise RuntimeError("Failed to create speculator")
+        try:
+            tokens = list(inputs)
+            token_array = (c_int64 * len(tokens))(*tokens)
+            next_token = LIB_LLAISYS.llaisysQwen2SpeculatorStart(spec, token_array, len(tokens))
             if next_token < 0:
                 raise RuntimeError("Inference failed")
-            
-            tokens.append(next_token)
-            
-            # 检查是否到达结束 token
-            if next_token == self._meta.end_token:
+            generated = [next_token]
+
+            out = (c_int64 * (num_draft + 1))()
+            while len(generated) < max_new_tokens and generated[-1] != self._meta.end_token:
+                n = LIB_LLAISYS.llaisysQwen2SpeculatorStep(spec, out)
+                if n < 0:
+                    raise RuntimeError("Inference failed")
+                if n == 0:
+                    break
+                generated.extend(out[:n])
+            # 截断到第一个结束 token 或 max_new_tokens
+            if self._meta.end_token in generated:
+                generated = generated[: generated.index(self._meta.end_token) + 1]
+            generated = generated[:max_new_tokens]
+
+            stats = LlaisysQwen2SpeculativeStats()
+            LIB_LLAISYS.llaisysQwen2SpeculatorGetStats(spec, byref(stats))
+        finally:
+            LIB_LLAISYS.llaisysQwen2SpeculatorDestroy(spec)
+
+        return tokens + generated, {
+            "rounds": stats.rounds,
+            "drafted": stats.drafted,
+            "accepted": stats.accepted,
+            "acceptance_rate": stats.accepted / stats.drafted if stats.drafted else 0.0,
+        }
+
+
+class Qwen2Session:
+    """会话：独立的 KV-Cache 与位置，与创建它的模型共享权重。
+    每轮只需传入新的 token，之前的对话保留在 KV-Cache 中"""
+
+    def __init__(self, model: Qwen2):
+        self._model = model  # 保持模型存活
+        self._session = LIB_LLAISYS.llaisysQwen2SessionCreate(model._model)
+        if not self._session:
+            raise RuntimeError("Failed to create session")
+        self._pending = []  # 上一轮最后生成、尚未写入 KV-Cache 的 token
+
+    def __del__(self):
+        if hasattr(self, "_session") and self._session:
+            LIB_LLAISYS.llaisysQwen2SessionDestroy(self._session)
+            self._session = None
+
+    def __len__(self):
+        return LIB_LLAISYS.llaisysQwen2SessionLength(self._session)
+
+    @property
+    def kv_bytes(self) -> int:
+        """KV-Cache 当前占用的字节数，被驱逐时为 0"""
+        return LIB_LLAISYS.llaisysQwen2SessionKVBytes(self._session)
+
+    def reset(self):
+        LIB_LLAISYS.llaisysQwen2SessionReset(self._session)
+        self._pending = []
+
+    def infer(self, inputs: Sequence[int]) -> int:
+        tokens = list(inputs)
+        token_array = (c_int64 * len(tokens))(*tokens)
+        next_token = LIB_LLAISYS.llaisysQwen2SessionInfer(self._session, token_array, len(tokens))
+        if next_token < 0:
+            raise RuntimeError("Inference failed")
+        return next_token
+
+    def generate(self, inputs: Sequence[int], max_new_tokens: int = 128):
+        """在会话末尾追加 inputs 并贪心生成，返回生成的 token。
+        最后生成的 token 在下一轮与新的 inputs 一起写入 KV-Cache"""
+        generated = [self.infer(self._pending + list(inputs))]
+        while len(generated) < max_new_tokens and generated[-1] != self._model._meta.end_token:
+            generated.append(self.infer(generated[-1:]))
+        self._pending = generated[-1:]
+        return generated
+
+
+class Qwen2Scheduler:
+    """连续批处理调度器：submit 提交请求，step 推进一次迭代，poll 取出产生的 token"""
+
+    def __init__(self, model: Qwen2, max_batch: int = 8, token_budget: int = 256):
+        self._model = model  # 保持模型存活
+        self._scheduler = LIB_LLAISYS.llaisysQwen2SchedulerCreate(
+            model._model, max_batch, token_budget
+        )
+
+    def __del__(self):
+        if hasattr(self, "_scheduler") and self._scheduler:
+            LIB_LLAISYS.llaisysQwen2SchedulerDestroy(self._scheduler)
+            self._scheduler = None
+
+    def submit(
+        self,
+        inputs: Sequence[int],
+        max_new_tokens: int = 128,
+        lookup_draft: int = 0,
+        lookup_ngram: int = 3,
+    ) -> int:
+        """lookup_draft > 0 时为该请求开启 prompt lookup 投机解码，每步至多附带 lookup_draft 个草稿"""
+        tokens = list(inputs)
+        token_array = (c_int64 * len(tokens))(*tokens)
+        request_id = LIB_LLAISYS.llaisysQwen2SchedulerSubmitWithLookup(
+            self._scheduler, token_array, len(tokens), max_new_tokens, lookup_ngram, lookup_draft
+        )
+        if request_id < 0:
+            raise RuntimeError("Submit failed")
+        return request_id
+
+    def cancel(self, request_id: int) -> bool:
+        return bool(LIB_LLAISYS.llaisysQwen2SchedulerCancel(self._scheduler, request_id))
+
+    def step(self) -> int:
+        produced = LIB_LLAISYS.llaisysQwen2SchedulerStep(self._scheduler)
+        if produced < 0:
+            raise RuntimeError("Inference failed")
+        return produced
+
+    def poll(self, capacity: int = 256):
+        """返回 [(request_id, token, finished), ...]"""
+        events = (LlaisysQwen2TokenEvent * capacity)()
+        n = LIB_LLAISYS.llaisysQwen2SchedulerPoll(self._scheduler, events, capacity)
+        return [(e.request_id, e.token, bool(e.finished)) for e in events[:n]]
+
+    def has_work(self) -> bool:
+        return bool(LIB_LLAISYS.llaisysQwen2SchedulerHasWork(self._scheduler))
+
+    def lookup_stats(self):
+        """prompt lookup 的累计统计：rounds / drafted / accepted / acceptance_rate"""
+        stats = LlaisysQwen2SpeculativeStats()
+        LIB_LLAISYS.llaisysQwen2SchedulerGetLookupStats(self._scheduler, byref(stats))
+        return {
+            "rounds": stats.rounds,
+            "drafted": stats.drafted,
+            "accepted": stats.accepted,
+            "acceptance_rate": stats.accepted / stats.drafted if stats.drafted else 0.0,
+        }
+
+    def run(self, requests: Sequence[Sequence[int]], max_new_tokens: int = 128, lookup_draft: int = 0):
+        """提交一组请求并运行到全部结束，返回各请求的 prompt + 生成结果"""
+        ids = [self.submit(r, max_new_tokens, lookup_draft) for r in requests]
+        outputs = {i: list(r) for i, r in zip(ids, requests)}
+        while True:
+            busy = self.has_work()
+            if busy:
+                self.step()
+            events = self.poll()
+            for request_id, token, _ in events:
+                if token >= 0:
+                    outputs[request_id].append(token)
+            if not busy and not events:
                 break
-        
-        return tokens
+        return [outputs[i] for i in ids]
+
+
+class Qwen2Engine:
+    """异步引擎：调度器运行在引擎自己的工作线程上，submit / cancel / poll 立即返回。
+    有 token 可取时 fileno() 可读，可交给 selectors / asyncio 监听，或用 poll_async 在事件循环中等待"""
+
+    def __init__(self, model: Qwen2, max_batch: int = 8, token_budget: int = 256):
+        self._model = model  # 保持模型存活
+        self._engine = LIB_LLAISYS.llaisysQwen2EngineCreate(model._model, max_batch, token_budget)
+        if not self._engine:
+            raise RuntimeError("Failed to create engine")
+
+    def __del__(self):
+        if hasattr(self, "_engine") and self._engine:
+            LIB_LLAISYS.llaisysQwen2EngineDestroy(self._engine)
+            self._engine = None
+
+    def submit(
+        self,
+        inputs: Sequence[int],
+        max_new_tokens: int = 128,
+        lookup_draft: int = 0,
+        lookup_ngram: int = 3,
+    ) -> int:
+        tokens = list(inputs)
+        token_array = (c_int64 * len(tokens))(*tokens)
+        request_id = LIB_LLAISYS.llaisysQwen2EngineSubmit(
+            self._engine, token_array, len(tokens), max_new_tokens, lookup_ngram, lookup_draft
+        )
+        if request_id < 0:
+            raise RuntimeError("Submit failed")
+        return request_id
+
+    def cancel(self, request_id: int) -> bool:
+        return bool(LIB_LLAISYS.llaisysQwen2EngineCancel(self._engine, request_id))
+
+    def poll(self, capacity: int = 256):
+        """不阻塞地取出事件，返回 [(request_id, token, finished), ...]"""
+        events = (LlaisysQwen2TokenEvent * capacity)()
+        n = LIB_LLAISYS.llaisysQwen2EnginePoll(self._engine, events, capacity)
+        return [(e.request_id, e.token, bool(e.finished)) for e in events[:n]]
+
+    def wait(self, timeout: float = None) -> bool:
+        """阻塞到有事件可取（调用期间释放 GIL），timeout 为秒，None 为不超时"""
+        timeout_ms = -1 if timeout is None else int(timeout * 1000)
+        return bool(LIB_LLAISYS.llaisysQwen2EngineWait(self._engine, timeout_ms))
+
+    def fileno(self) -> int:
+        """通知 fd，平台不支持时为 -1"""
+        return LIB_LLAISYS.llaisysQwen2EngineFd(self._engine)
+
+    def num_active(self) -> int:
+        return LIB_LLAISYS.llaisysQwen2EngineNumActive(self._engine)
+
+    async def poll_async(self, capacity: int = 256):
+        """在 asyncio 事件循环中等待并取出至少一个事件，等待期间不占用事件循环"""
+        import asyncio
+
+        loop = asyncio.get_running_loop()
+        fd = self.fileno()
+        while True:
+            events = self.poll(capacity)
+            if events:
+                return events
+            if fd < 0:
+                await loop.run_in_executor(None, self.wait, 0.1)
+                continue
+            ready = loop.create_future()
+            loop.add_reader(fd, lambda: ready.done() or ready.set_result(None))
+            try:
+                await ready
+            finally:
+                loop.remove_reader(fd)
+
+    def run(self, requests: Sequence[Sequence[int]], max_new_tokens: int = 128, lookup_draft: int = 0):
+        """提交一组请求并等待全部结束，返回各请求的 prompt + 生成结果"""
+        ids = [self.submit(r, max_new_tokens, lookup_draft) for r in requests]
+        outputs = {i: list(r) for i, r in zip(ids, requests)}
+        pending = set(ids)
+        while pending:
+            self.wait()
+            for request_id, token, finished in self.poll():
+                if token >= 0:
+                    outputs[request_id].append(token)
+                if finished:
+                    pending.discard(request_id)
+        return [outputs[i] for i in ids]
@@ -1,6 +1,7 @@
-from .libllaisys import LIB_LLAISYS
+from .libllaisys import LIB_LLAISYS, llaisysTensor_t
 from .tensor import Tensor
-from ctypes import c_float, c_int
+from ctypes import c_float, c_int, c_size_t
+from typing import Sequence
 
 
 class Ops:
@@ -24,6 +25,24 @@ class Ops:
             out.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), bias.lib_tensor()
         )
 
+    @staticmethod
+    def lm_head_topk(
+        topk_idx: Tensor,
+        topk_val: Tensor,
+        hidden: Tensor,
+        norm_w: Tensor,
+        weight: Tensor,
+        eps: float,
+    ):
+        LIB_LLAISYS.llaisysLmHeadTopK(
+            topk_idx.lib_tensor(),
+            topk_val.lib_tensor(),
+            hidden.lib_tensor(),
+            norm_w.lib_tensor(),
+            weight.lib_tensor(),
+            c_float(eps),
+        )
+
     @staticmethod
     def rearrange(out: Tensor, inp: Tensor):
         LIB_LLAISYS.llaisysRearrange(out.lib_tensor(), inp.lib_tensor())
@@ -50,6 +69,21 @@ class Ops:
             c_float(scale),
         )
 
+    @staticmethod
+    def self_attention_varlen(
+        attn_val: Tensor, q: Tensor, k: Sequence[Tensor], v: Sequence[Tensor], q_lens: Sequence[int], scale: float
+    ):
+        nseq = len(q_lens)
+        LIB_LLAISYS.llaisysSelfAttentionVarlen(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            (llaisysTensor_t * nseq)(*[t.lib_tensor() for t in k]),
+            (llaisysTensor_t * nseq)(*[t.lib_tensor() for t in v]),
+            (c_size_t * nseq)(*q_lens),
+            c_size_t(nseq),
+            c_float(scale),
+        )
+
     @staticmethod
     def swiglu(out: Tensor, gate: Tensor, up: Tensor):
         LIB_LLAISYS.llaisysSwiGLU(out.lib_tensor(), gate.lib_tensor(), up.lib_tensor())
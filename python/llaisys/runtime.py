@@ -1,10 +1,11 @@
 from . import libllaisys
 from .libllaisys import LIB_LLAISYS
-from ctypes import c_void_p
+from ctypes import c_void_p, byref
 
 
 class RuntimeAPI:
     def __init__(self, device_type: libllaisys.DeviceType):
+        self._device_type = device_type
         self._api = LIB_LLAISYS.llaisysGetRuntimeAPI(
             libllaisys.llaisysDeviceType_t(device_type)
         )
@@ -66,3 +67,38 @@ class RuntimeAPI:
         self._api.contents.memcpy_async(
             dst, src, size, libllaisys.llaisysMemcpyKind_t(kind), stream
         )
+
+    def set_allocator(
+        self,
+        device_id: int,
+        kind: libllaisys.AllocatorType,
+        max_cached_bytes: int = 0,
+    ) -> None:
+        LIB_LLAISYS.llaisysSetContextAllocator(
+            libllaisys.llaisysDeviceType_t(self._device_type),
+            device_id,
+            libllaisys.llaisysAllocatorType_t(kind),
+            max_cached_bytes,
+        )
+
+    def memory_stats(self, device_id: int) -> dict:
+        stats = libllaisys.LlaisysMemoryStats()
+        LIB_LLAISYS.llaisysGetContextMemoryStats(
+            libllaisys.llaisysDeviceType_t(self._device_type),
+            device_id,
+            byref(stats),
+        )
+        return {name: getattr(stats, name) for name, _ in stats._fields_}
+
+    def trim_allocator(self, device_id: int) -> None:
+        LIB_LLAISYS.llaisysTrimContextAllocator(
+            libllaisys.llaisysDeviceType_t(self._device_type), device_id
+        )
+
+    @staticmethod
+    def set_cpu_memory_policy(
+        mode: libllaisys.HugePageMode, huge_page_min_bytes: int = 0
+    ) -> None:
+        LIB_LLAISYS.llaisysSetCpuMemoryPolicy(
+            libllaisys.llaisysHugePageMode_t(mode), huge_page_min_bytes
+        )
@@ -14,6 +14,9 @@ public:
     virtual ~MemoryAllocator() = default;
     virtual std::byte *allocate(size_t size) = 0;
     virtual void release(std::byte *memory) = 0;
+    // Return cached memory to the device. No-op for allocators without a cache.
+    virtual void trim() {}
+    virtual LlaisysMemoryStats stats() const = 0;
 };
 
 } // namespace llaisys::core
@@ -0,0 +1,260 @@
+#include "caching_allocator.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+
+namespace llaisys::core::allocators {
+
+namespace {
+// Four classes per power of two starting at 512 bytes: 512, 640, 768, 896, 1024, 1280, ...
+constexpr size_t MIN_CLASS_SIZE = 512;
+constexpr int CLASSES_PER_DOUBLING = 4;
+
+size_t roundUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+} // namespace
+
+size_t CachingAllocator::classSize(int size_class) {
+    size_t base = MIN_CLASS_SIZE << (size_class / CLASSES_PER_DOUBLING);
+    return base + base / CLASSES_PER_DOUBLING * (size_class % CLASSES_PER_DOUBLING);
+}
+
+int CachingAllocator::sizeClass(size_t size) {
+    int c = 0;
+    while (classSize(c) < size) {
+        c++;
+    }
+    return c;
+}
+
+CachingAllocator::CachingAllocator(const LlaisysRuntimeAPI *runtime_api, size_t max_cached_bytes)
+    : MemoryAllocator(runtime_api), _max_cached_bytes(max_cached_bytes), _owner(std::this_thread::get_id()) {
+    _small_bins.resize(sizeClass(SMALL_LIMIT) + 1);
+}
+
+CachingAllocator::~CachingAllocator() {
+    drainRemoteFrees();
+    trim();
+    // The runtime is only destroyed after all of its storages are freed, so
+    // trim() has returned every segment; only block metadata is left.
+    for (auto &entry : _blocks) {
+        delete entry.second;
+    }
+}
+
+std::byte *CachingAllocator::allocate(size_t size) {
+    if (_has_remote_frees.load(std::memory_order_acquire)) {
+        drainRemoteFrees();
+    }
+    size = std::max<size_t>(size, 1);
+    std::byte *ptr = size <= SMALL_LIMIT ? allocateSmall(size) : allocateLarge(size);
+    _stats.num_allocs++;
+    return ptr;
+}
+
+void CachingAllocator::onAllocated(Block *block) {
+    block->is_free = false;
+    _stats.allocated_bytes += block->size;
+    _stats.cached_bytes -= std::min(_stats.cached_bytes, block->size);
+    _stats.peak_allocated_bytes = std::max(_stats.peak_allocated_bytes, _stats.allocated_bytes);
+}
+
+std::byte *CachingAllocator::allocateSmall(size_t size) {
+    int c = sizeClass(size);
+    auto &bin = _small_bins[c];
+    if (!bin.empty()) {
+        Block *b = bin.back();
+        bin.pop_back();
+        _stats.num_cache_hits++;
+        onAllocated(b);
+        return b->ptr;
+    }
+
+    size_t bytes = classSize(c);
+    auto ptr = static_cast<std::byte *>(_api->malloc_device(bytes));
+    ASSERT(ptr != nullptr, "CachingAllocator: device allocation failed");
+    _stats.num_device_mallocs++;
+    _stats.reserved_bytes += bytes;
+    _stats.cached_bytes += bytes;
+
+    Block *b = new Block{ptr, bytes, c, true, nullptr, nullptr};
+    _blocks[ptr] = b;
+    onAllocated(b);
+    return ptr;
+}
+
+std::byte *CachingAllocator::allocateLarge(size_t size) {
+    size = roundUp(size, LARGE_ROUND);
+
+    Block key{nullptr, size, -1, true, nullptr, nullptr};
+    Block *b = nullptr;
+    auto it = _large_free.lower_bound(&key);
+    if (it != _large_free.end()) {
+        b = *it;
+        _large_free.erase(it);
+        _stats.num_cache_hits++;
+    } else {
+        size_t bytes = roundUp(size, SEGMENT_ROUND);
+        auto ptr = static_cast<std::byte *>(_api->malloc_device(bytes));
+        if (ptr == nullptr) {
+            // Give cached segments back to the device and retry once.
+            trim();
+            ptr = static_cast<std::byte *>(_api->malloc_device(bytes));
+        }
+        ASSERT(ptr != nullptr, "CachingAllocator: device allocation failed");
+        _stats.num_device_mallocs++;
+        _stats.reserved_bytes += bytes;
+        _stats.cached_bytes += bytes;
+        b = new Block{ptr, bytes, -1, true, nullptr, nullptr};
+        _blocks[ptr] = b;
+    }
+
+    if (b->size - size >= MIN_SPLIT) {
+        Block *rest = new Block{b->ptr + size, b->size - size, -1, true, b, b->next};
+        if (b->next) {
+            b->next->prev = rest;
+        }
+        b->next = rest;
+        b->size = size;
+        _blocks[rest->ptr] = rest;
+        _large_free.insert(rest);
+    }
+    onAllocated(b);
+    return b->ptr;
+}
+
+void CachingAllocator::release(std::byte *memory) {
+    if (memory == nullptr) {
+        return;
+    }
+    if (std::this_thread::get_id() != _owner) {
+        std::lock_guard<std::mutex> lock(_remote_mutex);
+        _remote_frees.push_back(memory);
+        _has_remote_frees.store(true, std::memory_order_release);
+        return;
+    }
+    if (_has_remote_frees.load(std::memory_order_acquire)) {
+        drainRemoteFrees();
+    }
+    releaseLocal(memory);
+    enforceCap();
+}
+
+void CachingAllocator::drainRemoteFrees() {
+    std::vector<std::byte *> pending;
+    {
+        std::lock_guard<std::mutex> lock(_remote_mutex);
+        pending.swap(_remote_frees);
+        _has_remote_frees.store(false, std::memory_order_release);
+    }
+    for (auto ptr : pending) {
+        releaseLocal(ptr);
+    }
+    if (!pending.empty()) {
+        enforceCap();
+    }
+}
+
+void CachingAllocator::releaseLocal(std::byte *memory) {
+    auto it = _blocks.find(memory);
+    ASSERT(it != _blocks.end(), "CachingAllocator: releasing unknown pointer");
+    Block *b = it->second;
+    ASSERT(!b->is_free, "CachingAllocator: double free");
+
+    b->is_free = true;
+    _stats.num_frees++;
+    _stats.allocated_bytes -= b->size;
+    _stats.cached_bytes += b->size;
+
+    if (b->size_class >= 0) {
+        _small_bins[b->size_class].push_back(b);
+        return;
+    }
+
+    // Coalesce with free neighbours of the same segment.
+    if (b->prev && b->prev->is_free) {
+        Block *p = b->prev;
+        _large_free.erase(p);
+        _blocks.erase(b->ptr);
+        p->size += b->size;
+        p->next = b->next;
+        if (b->next) {
+            b->next->prev = p;
+        }
+        delete b;
+        b = p;
+    }
+    if (b->next && b->next->is_free) {
+        Block *n = b->next;
+        _large_free.erase(n);
+        _blocks.erase(n->ptr);
+        b->size += n->size;
+        b->next = n->next;
+        if (n->next) {
+            n->next->prev = b;
+        }
+        delete n;
+    }
+    _large_free.insert(b);
+}
+
+void CachingAllocator::freeSegment(Block *block) {
+    _api->free_device(block->ptr);
+    _stats.num_device_frees++;
+    _stats.reserved_bytes -= block->size;
+    _stats.cached_bytes -= block->size;
+    _blocks.erase(block->ptr);
+    delete block;
+}
+
+void CachingAllocator::enforceCap() {
+    if (_stats.cached_bytes <= _max_cached_bytes) {
+        return;
+    }
+    // Largest whole free segments first, then small bins from the largest class down.
+    std::vector<Block *> segments;
+    for (Block *b : _large_free) {
+        if (b->prev == nullptr && b->next == nullptr) {
+            segments.push_back(b);
+        }
+    }
+    for (auto it = segments.rbegin(); it != segments.rend() && _stats.cached_bytes > _max_cached_bytes; ++it) {
+        _large_free.erase(*it);
+        freeSegment(*it);
+    }
+    for (auto bin = _small_bins.rbegin(); bin != _small_bins.rend() && _stats.cached_bytes > _max_cached_bytes; ++bin) {
+        while (!bin->empty() && _stats.cached_bytes > _max_cached_bytes) {
+            freeSegment(bin->back());
+            bin->pop_back();
+        }
+    }
+}
+
+void CachingAllocator::trim() {
+    if (std::this_thread::get_id() == _owner) {
+        drainRemoteFrees();
+    }
+    for (auto &bin : _small_bins) {
+        for (Block *b : bin) {
+            freeSegment(b);
+        }
+        bin.clear();
+    }
+    for (auto it = _large_free.begin(); it != _large_free.end();) {
+        Block *b = *it;
+        if (b->prev == nullptr && b->next == nullptr) {
+            it = _large_free.erase(it);
+            freeSegment(b);
+        } else {
+            ++it;
+        }
+    }
+}
+
+LlaisysMemoryStats CachingAllocator::stats() const {
+    return _stats;
+}
+
+} // namespace llaisys::core::allocators
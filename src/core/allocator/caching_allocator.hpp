@@ -0,0 +1,79 @@
+#pragma once
+
+#include "allocator.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::core::allocators {
+// Caching allocator with size-class bins for small requests and split/coalesce
+// segments for large ones. Freed memory is kept for reuse instead of being
+// returned to the device, up to max_cached_bytes.
+//
+// A runtime (and thus its allocator) belongs to one thread's context, so
+// allocation always happens on the owner thread. The owner takes no locks;
+// storages released on other threads are queued and reclaimed by the owner.
+class CachingAllocator : public MemoryAllocator {
+public:
+    static constexpr size_t DEFAULT_MAX_CACHED_BYTES = size_t(1) << 30;
+    // Requests up to this size are served from size-class bins.
+    static constexpr size_t SMALL_LIMIT = size_t(1) << 20;
+    // Large blocks are rounded to this granularity.
+    static constexpr size_t LARGE_ROUND = size_t(4) << 10;
+    // Large segments are allocated from the device in multiples of this size.
+    static constexpr size_t SEGMENT_ROUND = size_t(2) << 20;
+    // A free large block is only split if the remainder is at least this big.
+    static constexpr size_t MIN_SPLIT = size_t(1) << 20;
+
+    CachingAllocator(const LlaisysRuntimeAPI *runtime_api, size_t max_cached_bytes = DEFAULT_MAX_CACHED_BYTES);
+    ~CachingAllocator();
+
+    std::byte *allocate(size_t size) override;
+    void release(std::byte *memory) override;
+    void trim() override;
+    LlaisysMemoryStats stats() const override;
+
+private:
+    struct Block {
+        std::byte *ptr;
+        size_t size;
+        int size_class; // -1 for large blocks
+        bool is_free;
+        Block *prev; // neighbours inside the same large segment
+        Block *next;
+    };
+    struct BySize {
+        bool operator()(const Block *a, const Block *b) const {
+            return a->size != b->size ? a->size < b->size : a->ptr < b->ptr;
+        }
+    };
+
+    size_t _max_cached_bytes;
+    std::thread::id _owner;
+
+    std::unordered_map<std::byte *, Block *> _blocks;
+    std::vector<std::vector<Block *>> _small_bins;
+    std::set<Block *, BySize> _large_free;
+
+    std::mutex _remote_mutex;
+    std::vector<std::byte *> _remote_frees;
+    std::atomic<bool> _has_remote_frees{false};
+
+    LlaisysMemoryStats _stats{};
+
+    static int sizeClass(size_t size);
+    static size_t classSize(int size_class);
+
+    std::byte *allocateSmall(size_t size);
+    std::byte *allocateLarge(size_t size);
+    void releaseLocal(std::byte *memory);
+    void drainRemoteFrees();
+    void freeSegment(Block *block);
+    void enforceCap();
+    void onAllocated(Block *block);
+};
+} // namespace llaisys::core::allocators
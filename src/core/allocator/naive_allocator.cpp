@@ -7,10 +7,22 @@ NaiveAllocator::NaiveAllocator(const LlaisysRuntimeAPI *runtime_api) : MemoryAll
 }
 
 std::byte *NaiveAllocator::allocate(size_t size) {
+    _num_allocs++;
     return static_cast<std::byte *>(_api->malloc_device(size));
 }
 
 void NaiveAllocator::release(std::byte *memory) {
+    _num_frees++;
     _api->free_device(memory);
 }
-} // namespace llaisys::core::allocators
\ No newline at end of file
+
+LlaisysMemoryStats NaiveAllocator::stats() const {
+    // Sizes are not tracked, every request goes straight to the device.
+    LlaisysMemoryStats s{};
+    s.num_allocs = _num_allocs;
+    s.num_frees = _num_frees;
+    s.num_device_mallocs = s.num_allocs;
+    s.num_device_frees = s.num_frees;
+    return s;
+}
+} // namespace llaisys::core::allocators
@@ -2,12 +2,19 @@
 
 #include "allocator.hpp"
 
+#include <atomic>
+
 namespace llaisys::core::allocators {
 class NaiveAllocator : public MemoryAllocator {
+private:
+    std::atomic<size_t> _num_allocs{0};
+    std::atomic<size_t> _num_frees{0};
+
 public:
     NaiveAllocator(const LlaisysRuntimeAPI *runtime_api);
     ~NaiveAllocator() = default;
     std::byte *allocate(size_t size) override;
     void release(std::byte *memory) override;
+    LlaisysMemoryStats stats() const override;
 };
-} // namespace llaisys::core::allocators
\ No newline at end of file
+} // namespace llaisys::core::allocators
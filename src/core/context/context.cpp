@@ -32,15 +32,16 @@ Context::Context() {
 }
 
 Context::~Context() {
-    // Destroy current runtime first.
-    delete _current_runtime;
+    // Destroy current runtime first. Runtimes that still own storages are
+    // destroyed when the last of them is freed.
+    _current_runtime->_retire();
 
     for (auto &runtime_entry : _runtime_map) {
         std::vector<Runtime *> runtimes = runtime_entry.second;
         for (auto runtime : runtimes) {
             if (runtime != nullptr && runtime != _current_runtime) {
                 runtime->_activate();
-                delete runtime;
+                runtime->_retire();
             }
         }
         runtimes.clear();
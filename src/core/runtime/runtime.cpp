@@ -1,6 +1,7 @@
 #include "runtime.hpp"
 
 #include "../../device/runtime_api.hpp"
+#include "../allocator/caching_allocator.hpp"
 #include "../allocator/naive_allocator.hpp"
 
 namespace llaisys::core {
@@ -8,7 +9,7 @@ Runtime::Runtime(llaisysDeviceType_t device_type, int device_id)
     : _device_type(device_type), _device_id(device_id), _is_active(false) {
     _api = llaisys::device::getRuntimeAPI(_device_type);
     _stream = _api->create_stream();
-    _allocator = new allocators::NaiveAllocator(_api);
+    _allocator = new allocators::CachingAllocator(_api);
 }
 
 Runtime::~Runtime() {
@@ -17,6 +18,10 @@ Runtime::~Runtime() {
     }
     delete _allocator;
     _allocator = nullptr;
+    for (auto allocator : _retired_allocators) {
+        delete allocator;
+    }
+    _retired_allocators.clear();
     _api->destroy_stream(_stream);
     _api = nullptr;
 }
@@ -30,6 +35,14 @@ void Runtime::_deactivate() {
     _is_active = false;
 }
 
+void Runtime::_retire() {
+    _is_active = true;
+    _retired = true;
+    if (_live_storages == 0 && !_destroying.exchange(true)) {
+        delete this;
+    }
+}
+
 bool Runtime::isActive() const {
     return _is_active;
 }
@@ -47,18 +60,60 @@ const LlaisysRuntimeAPI *Runtime::api() const {
 }
 
 storage_t Runtime::allocateDeviceStorage(size_t size) {
-    return std::shared_ptr<Storage>(new Storage(_allocator->allocate(size), size, *this, false));
+    _live_storages++;
+    return std::shared_ptr<Storage>(new Storage(_allocator->allocate(size), size, *this, _allocator, false));
 }
 
 storage_t Runtime::allocateHostStorage(size_t size) {
-    return std::shared_ptr<Storage>(new Storage((std::byte *)_api->malloc_host(size), size, *this, true));
+    _live_storages++;
+    return std::shared_ptr<Storage>(new Storage((std::byte *)_api->malloc_host(size), size, *this, nullptr, true));
+}
+
+storage_t Runtime::wrapExternalStorage(std::byte *memory, size_t size, std::shared_ptr<void> owner) {
+    CHECK_ARGUMENT(owner != nullptr, "external storage needs an owner");
+    _live_storages++;
+    return std::shared_ptr<Storage>(new Storage(memory, size, *this, nullptr, false, std::move(owner)));
 }
 
 void Runtime::freeStorage(Storage *storage) {
-    if (storage->isHost()) {
+    if (storage->isExternal()) {
+        storage->_owner.reset();
+    } else if (storage->isHost()) {
         _api->free_host(storage->memory());
     } else {
-        _allocator->release(storage->memory());
+        storage->_allocator->release(storage->memory());
+    }
+    if (_live_storages.fetch_sub(1) == 1 && _retired && !_destroying.exchange(true)) {
+        delete this;
+    }
+}
+
+void Runtime::setAllocator(llaisysAllocatorType_t type, size_t max_cached_bytes) {
+    MemoryAllocator *allocator = nullptr;
+    switch (type) {
+    case LLAISYS_ALLOCATOR_NAIVE:
+        allocator = new allocators::NaiveAllocator(_api);
+        break;
+    case LLAISYS_ALLOCATOR_CACHING:
+        allocator = new allocators::CachingAllocator(
+            _api, max_cached_bytes == 0 ? allocators::CachingAllocator::DEFAULT_MAX_CACHED_BYTES : max_cached_bytes);
+        break;
+    default:
+        CHECK_ARGUMENT(false, "unknown allocator type");
+    }
+    _allocator->trim();
+    _retired_allocators.push_back(_allocator);
+    _allocator = allocator;
+}
+
+LlaisysMemoryStats Runtime::memoryStats() const {
+    return _allocator->stats();
+}
+
+void Runtime::trimAllocator() {
+    _allocator->trim();
+    for (auto allocator : _retired_allocators) {
+        allocator->trim();
     }
 }
 
@@ -4,6 +4,9 @@
 #include "../../device/runtime_api.hpp"
 #include "../allocator/allocator.hpp"
 
+#include <atomic>
+#include <vector>
+
 namespace llaisys::core {
 class Runtime {
 private:
@@ -11,9 +14,19 @@ private:
     int _device_id;
     const LlaisysRuntimeAPI *_api;
     MemoryAllocator *_allocator;
+    // Replaced allocators are kept alive for storages they still own.
+    std::vector<MemoryAllocator *> _retired_allocators;
     bool _is_active;
+    // Storages may outlive the thread (and thus the context) that created them,
+    // e.g. a KV cache grown on a worker thread and freed by the main thread.
+    // A retired runtime is destroyed when its last storage is freed.
+    std::atomic<size_t> _live_storages{0};
+    std::atomic<bool> _retired{false};
+    std::atomic<bool> _destroying{false};
     void _activate();
     void _deactivate();
+    // Called by the owning context instead of delete.
+    void _retire();
     llaisysStream_t _stream;
     Runtime(llaisysDeviceType_t device_type, int device_id);
 
@@ -37,10 +50,16 @@ public:
     const LlaisysRuntimeAPI *api() const;
 
     storage_t allocateDeviceStorage(size_t size);
-    ;
     storage_t allocateHostStorage(size_t size);
+    // Wrap memory that is already accessible by the device (e.g. a file mapped on a CPU
+    // runtime). Nothing is allocated or copied; owner is released when the storage is freed.
+    storage_t wrapExternalStorage(std::byte *memory, size_t size, std::shared_ptr<void> owner);
     void freeStorage(Storage *storage);
 
+    void setAllocator(llaisysAllocatorType_t type, size_t max_cached_bytes);
+    LlaisysMemoryStats memoryStats() const;
+    void trimAllocator();
+
     llaisysStream_t stream() const;
     void synchronize() const;
 };
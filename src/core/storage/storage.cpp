@@ -3,8 +3,10 @@
 #include "../runtime/runtime.hpp"
 
 namespace llaisys::core {
-Storage::Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host)
-    : _memory(memory), _size(size), _runtime(runtime), _is_host(is_host) {}
+Storage::Storage(std::byte *memory, size_t size, Runtime &runtime, MemoryAllocator *allocator, bool is_host,
+                 std::shared_ptr<void> owner)
+    : _memory(memory), _size(size), _runtime(runtime), _allocator(allocator), _is_host(is_host),
+      _owner(std::move(owner)) {}
 
 Storage::~Storage() {
     _runtime.freeStorage(this);
@@ -37,4 +39,8 @@ int Storage::deviceId() const {
 bool Storage::isHost() const {
     return _is_host;
 }
+
+bool Storage::isExternal() const {
+    return _owner != nullptr;
+}
 } // namespace llaisys::core
\ No newline at end of file
@@ -11,8 +11,13 @@ private:
     std::byte *_memory;
     size_t _size;
     Runtime &_runtime;
+    // Allocator that produced a device storage; it may no longer be the runtime's current one.
+    MemoryAllocator *_allocator;
     bool _is_host;
-    Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host);
+    // Keeps externally owned memory (e.g. a mapped file) alive; such memory is never freed by the runtime.
+    std::shared_ptr<void> _owner;
+    Storage(std::byte *memory, size_t size, Runtime &runtime, MemoryAllocator *allocator, bool is_host,
+            std::shared_ptr<void> owner = nullptr);
 
 public:
     friend class Runtime;
@@ -23,6 +28,7 @@ public:
     llaisysDeviceType_t deviceType() const;
     int deviceId() const;
     bool isHost() const;
+    bool isExternal() const;
 };
 
 }; // namespace llaisys::core
@@ -1,10 +1,158 @@
 #include "../runtime_api.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
 
 namespace llaisys::device::cpu {
 
+namespace {
+// All blocks are aligned for full-width vector loads.
+constexpr size_t ALIGNMENT = 64;
+constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+std::atomic<int> huge_page_mode{LLAISYS_HUGE_PAGES_TRANSPARENT};
+std::atomic<size_t> huge_page_threshold{HUGE_PAGE_SIZE};
+
+size_t roundUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+void *heapAlloc(size_t size) {
+    size = roundUp(std::max<size_t>(size, 1), ALIGNMENT);
+#if defined(_WIN32)
+    return _aligned_malloc(size, ALIGNMENT);
+#else
+    void *ptr = nullptr;
+    return posix_memalign(&ptr, ALIGNMENT, size) == 0 ? ptr : nullptr;
+#endif
+}
+
+void heapFree(void *ptr) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+#if !defined(_WIN32)
+// Mapped blocks and their lengths. Every mapped block starts on a huge page boundary,
+// so release() only looks up (and locks) for pointers with that alignment; heap blocks
+// almost never have it, which keeps small frees off the lock.
+std::mutex mapped_mutex;
+std::unordered_map<void *, size_t> mapped_blocks;
+
+bool isHugeAligned(const void *ptr) {
+    return reinterpret_cast<uintptr_t>(ptr) % HUGE_PAGE_SIZE == 0;
+}
+
+// Map length bytes starting on a huge page boundary so that the whole range is
+// eligible for transparent huge pages.
+void *mapAligned(size_t length) {
+    size_t span = length + HUGE_PAGE_SIZE;
+    void *raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    auto begin = reinterpret_cast<uintptr_t>(raw);
+    auto aligned = roundUp(begin, HUGE_PAGE_SIZE);
+    if (aligned > begin) {
+        munmap(raw, aligned - begin);
+    }
+    size_t tail = begin + span - (aligned + length);
+    if (tail > 0) {
+        munmap(reinterpret_cast<void *>(aligned + length), tail);
+    }
+    return reinterpret_cast<void *>(aligned);
+}
+
+void *hugeAlloc(size_t size, int mode) {
+    size_t length = roundUp(size, HUGE_PAGE_SIZE);
+    void *ptr = nullptr;
+#if defined(MAP_HUGETLB)
+    if (mode == LLAISYS_HUGE_PAGES_EXPLICIT) {
+        // Needs a reserved hugetlbfs pool; fall back to transparent huge pages otherwise.
+        ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED) {
+            ptr = nullptr;
+        } else if (!isHugeAligned(ptr)) {
+            // release() only recognizes 2 MiB aligned blocks (smaller default huge page size)
+            munmap(ptr, length);
+            ptr = nullptr;
+        }
+    }
+#endif
+    if (ptr == nullptr) {
+        ptr = mapAligned(length);
+        if (ptr == nullptr) {
+            return nullptr;
+        }
+#if defined(MADV_HUGEPAGE)
+        madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+    }
+    std::lock_guard<std::mutex> lock(mapped_mutex);
+    mapped_blocks[ptr] = length;
+    return ptr;
+}
+
+bool hugeFree(void *ptr) {
+    size_t length;
+    {
+        std::lock_guard<std::mutex> lock(mapped_mutex);
+        auto it = mapped_blocks.find(ptr);
+        if (it == mapped_blocks.end()) {
+            return false;
+        }
+        length = it->second;
+        mapped_blocks.erase(it);
+    }
+    munmap(ptr, length);
+    return true;
+}
+#endif
+
+void *allocate(size_t size) {
+#if !defined(_WIN32)
+    int mode = huge_page_mode.load(std::memory_order_relaxed);
+    if (mode != LLAISYS_HUGE_PAGES_NONE && size >= huge_page_threshold.load(std::memory_order_relaxed)) {
+        if (void *ptr = hugeAlloc(size, mode)) {
+            return ptr;
+        }
+    }
+#endif
+    return heapAlloc(size);
+}
+
+void release(void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+#if !defined(_WIN32)
+    if (isHugeAligned(ptr) && hugeFree(ptr)) {
+        return;
+    }
+#endif
+    heapFree(ptr);
+}
+} // namespace
+
+void setMemoryPolicy(llaisysHugePageMode_t mode, size_t huge_page_min_bytes) {
+    huge_page_mode.store(mode, std::memory_order_relaxed);
+    huge_page_threshold.store(huge_page_min_bytes == 0 ? HUGE_PAGE_SIZE : huge_page_min_bytes, std::memory_order_relaxed);
+}
+
 namespace runtime_api {
 int getDeviceCount() {
     return 1;
@@ -30,11 +178,11 @@ void streamSynchronize(llaisysStream_t stream) {
 }
 
 void *mallocDevice(size_t size) {
-    return std::malloc(size);
+    return allocate(size);
 }
 
 void freeDevice(void *ptr) {
-    std::free(ptr);
+    release(ptr);
 }
 
 void *mallocHost(size_t size) {
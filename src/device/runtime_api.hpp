@@ -10,6 +10,7 @@ const LlaisysRuntimeAPI *getUnsupportedRuntimeAPI();
 
 namespace cpu {
 const LlaisysRuntimeAPI *getRuntimeAPI();
+void setMemoryPolicy(llaisysHugePageMode_t mode, size_t huge_page_min_bytes);
 }
 
 #ifdef ENABLE_NVIDIA_API
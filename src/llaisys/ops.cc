@@ -6,6 +6,7 @@
 #include "../ops/argmax/op.hpp"
 #include "../ops/embedding/op.hpp"
 #include "../ops/linear/op.hpp"
+#include "../ops/lm_head_topk/op.hpp"
 #include "../ops/rearrange/op.hpp"
 #include "../ops/rms_norm/op.hpp"
 #include "../ops/rope/op.hpp"
@@ -25,6 +26,9 @@ __C {
     void llaisysLinear(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias) {
         llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias->tensor);
     }
+    void llaisysLmHeadTopK(llaisysTensor_t topk_idx, llaisysTensor_t topk_val, llaisysTensor_t hidden, llaisysTensor_t norm_w, llaisysTensor_t weight, float eps) {
+        llaisys::ops::lm_head_topk(topk_idx->tensor, topk_val->tensor, hidden->tensor, norm_w->tensor, weight->tensor, eps);
+    }
     void llaisysRearrange(llaisysTensor_t out, llaisysTensor_t in) {
         llaisys::ops::rearrange(out->tensor, in->tensor);
     }
@@ -37,6 +41,14 @@ __C {
     void llaisysSelfAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, float scale) {
         llaisys::ops::self_attention(attn_val->tensor, q->tensor, k->tensor, v->tensor, scale);
     }
+    void llaisysSelfAttentionVarlen(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t *k, llaisysTensor_t *v, size_t *q_lens, size_t nseq, float scale) {
+        std::vector<llaisys::tensor_t> ks(nseq), vs(nseq);
+        for (size_t i = 0; i < nseq; i++) {
+            ks[i] = k[i]->tensor;
+            vs[i] = v[i]->tensor;
+        }
+        llaisys::ops::self_attention_varlen(attn_val->tensor, q->tensor, ks, vs, std::vector<size_t>(q_lens, q_lens + nseq), scale);
+    }
     void llaisysSwiGLU(llaisysTensor_t out, llaisysTensor_t gate, llaisysTensor_t up) {
         llaisys::ops::swiglu(out->tensor, gate->tensor, up->tensor);
     }
@@ -1,8 +1,20 @@
 #include "llaisys/models/qwen2.h"
+#include "../models/qwen2/engine.hpp"
+#include "../models/qwen2/generator.hpp"
+#include "../models/qwen2/layer_streamer.hpp"
+#include "../models/qwen2/llaisys_file.hpp"
 #include "../models/qwen2/qwen2_model.hpp"
+#include "../models/qwen2/safetensors.hpp"
+#include "../models/qwen2/scheduler.hpp"
+#include "../models/qwen2/session.hpp"
+#include "../models/qwen2/shared_weights.hpp"
+#include "../models/qwen2/speculative.hpp"
 #include "../utils.hpp"
 #include "llaisys_tensor.hpp"
+#include <algorithm>
 #include <iostream>
+#include <mutex>
+#include <utility>
 #include <vector>
 
 using namespace llaisys;
@@ -11,6 +23,10 @@ using namespace llaisys::models;
 struct LlaisysQwen2Model {
     Qwen2Model* model;
     LlaisysQwen2Weights weights;
+    // 该模型所有会话共享的 KV 内存预算
+    std::unique_ptr<KVMemoryManager> kv_manager = std::make_unique<KVMemoryManager>();
+    // 附加的跨进程共享权重映像，随模型销毁而释放引用
+    std::unique_ptr<SharedWeights> shared_weights;
     
     // 用于存储 LlaisysTensor 包装器的生命周期
     std::vector<LlaisysTensor*> tensor_wrappers;
@@ -23,6 +39,33 @@ struct LlaisysQwen2Model {
     }
 };
 
+struct LlaisysQwen2Sequence {
+    std::unique_ptr<ModelKVCache> kv_cache;
+};
+
+struct LlaisysQwen2Session {
+    std::unique_ptr<Qwen2Session> session;
+};
+
+struct LlaisysQwen2Scheduler {
+    std::unique_ptr<Qwen2Scheduler> scheduler;
+    Qwen2Model* model; // step() 时加锁
+};
+
+struct LlaisysQwen2Speculator {
+    std::unique_ptr<SpeculativeDecoder> decoder;
+    Qwen2Model* target; // start() / step() 时两个模型都加锁
+    Qwen2Model* draft;
+};
+
+struct LlaisysQwen2TokenRing {
+    std::unique_ptr<TokenRing> ring;
+};
+
+struct LlaisysQwen2Engine {
+    std::unique_ptr<Qwen2Engine> engine;
+};
+
 // 辅助函数：将 tensor_t 包装成 llaisysTensor_t
 static llaisysTensor_t wrap_tensor(tensor_t t, std::vector<LlaisysTensor*>& wrappers) {
     auto* wrapper = new LlaisysTensor{t};
@@ -51,6 +94,7 @@ __C __export struct LlaisysQwen2Model* llaisysQwen2ModelCreate(
         config.theta = meta->theta;
         config.eos_token_id = meta->end_token;
         config.dtype = meta->dtype;
+        config.act_dtype = meta->act_dtype;
         config.device_type = device;
         config.device_id = (ndevice > 0) ? device_ids[0] : 0;
         
@@ -131,6 +175,7 @@ __C __export int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model* model, int
     if (!model || !token_ids) return -1;
     
     try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
         return model->model->infer_one_step(token_ids, ntoken);
     } catch (const std::exception& e) {
         std::cerr << "[ERROR] Qwen2 inference failed: " << e.what() << std::endl;
@@ -138,8 +183,598 @@ __C __export int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model* model, int
     }
 }
 
+__C __export int64_t llaisysQwen2ModelInferReuse(struct LlaisysQwen2Model* model, int64_t* token_ids, size_t ntoken, size_t* reused) {
+    if (!model || !token_ids) return -1;
+    
+    try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        return model->model->infer_reuse(token_ids, ntoken, reused);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 inference failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+// 权重张量被加载器替换后，让句柄指向新的张量，旧的存储随之释放
+static void repoint_weights(struct LlaisysQwen2Model* model) {
+    auto* m = model->model;
+    auto& w = model->weights;
+    w.in_embed->tensor = m->embed_tokens();
+    w.out_embed->tensor = m->lm_head();
+    w.out_norm_w->tensor = m->final_norm_w();
+    for (size_t i = 0; i < m->config().nlayer; ++i) {
+        w.attn_norm_w[i]->tensor = m->attn_norm_w(i);
+        w.attn_q_w[i]->tensor = m->q_proj_w(i);
+        w.attn_q_b[i]->tensor = m->q_proj_b(i);
+        w.attn_k_w[i]->tensor = m->k_proj_w(i);
+        w.attn_k_b[i]->tensor = m->k_proj_b(i);
+        w.attn_v_w[i]->tensor = m->v_proj_w(i);
+        w.attn_v_b[i]->tensor = m->v_proj_b(i);
+        w.attn_o_w[i]->tensor = m->o_proj_w(i);
+        w.mlp_norm_w[i]->tensor = m->mlp_norm_w(i);
+        w.mlp_gate_w[i]->tensor = m->gate_proj_w(i);
+        w.mlp_up_w[i]->tensor = m->up_proj_w(i);
+        w.mlp_down_w[i]->tensor = m->down_proj_w(i);
+    }
+}
+
+static LlaisysQwen2LoadStats to_load_stats(const WeightLoadStats& s) {
+    return LlaisysQwen2LoadStats{s.files,   s.mapped,     s.converted, s.mapped_bytes, s.copied_bytes,
+                                 s.read_ms, s.convert_ms, s.place_ms,  s.total_ms};
+}
+
+static LoadOptions to_load_options(const LlaisysQwen2LoadOptions* options) {
+    LoadOptions opts;
+    if (options) {
+        opts.nthreads = options->nthreads;
+        opts.readahead = options->readahead != 0;
+        opts.prefault = options->prefault != 0;
+        if (options->progress) {
+            auto progress = options->progress;
+            void* user_data = options->user_data;
+            opts.progress = [progress, user_data](const char* stage, size_t done, size_t total) {
+                progress(stage, done, total, user_data);
+            };
+        }
+    }
+    return opts;
+}
+
+__C __export int llaisysQwen2ModelLoadSafetensors(struct LlaisysQwen2Model* model, const char* dir,
+                                                 struct LlaisysQwen2LoadStats* stats) {
+    return llaisysQwen2ModelLoadSafetensorsWithOptions(model, dir, nullptr, stats);
+}
+
+__C __export int llaisysQwen2ModelLoadSafetensorsWithOptions(struct LlaisysQwen2Model* model, const char* dir,
+                                                            const struct LlaisysQwen2LoadOptions* options,
+                                                            struct LlaisysQwen2LoadStats* stats) {
+    if (!model || !dir) return -1;
+    
+    try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        auto s = load_safetensors(*model->model, dir, to_load_options(options));
+        repoint_weights(model);
+        if (stats) *stats = to_load_stats(s);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to load safetensors: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2ReadLlaisysMeta(const char* path, struct LlaisysQwen2Meta* meta) {
+    if (!path || !meta) return -1;
+
+    try {
+        auto cfg = read_llaisys_config(path);
+        *meta = LlaisysQwen2Meta{cfg.dtype, cfg.nlayer, cfg.hs,  cfg.nh,      cfg.nkvh,  cfg.dh,
+                                 cfg.di,    cfg.maxseq, cfg.voc, cfg.epsilon, cfg.theta, cfg.eos_token_id,
+                                 LLAISYS_DTYPE_INVALID};
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to read llaisys file: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2ModelLoadLlaisys(struct LlaisysQwen2Model* model, const char* path,
+                                             const struct LlaisysQwen2LoadOptions* options,
+                                             struct LlaisysQwen2LoadStats* stats) {
+    if (!model || !path) return -1;
+
+    try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        auto s = load_llaisys(*model->model, path, to_load_options(options));
+        repoint_weights(model);
+        if (stats) *stats = to_load_stats(s);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to load llaisys file: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2ModelAttachSharedWeights(struct LlaisysQwen2Model* model, const char* image_path,
+                                                     const char* source,
+                                                     const struct LlaisysQwen2LoadOptions* options,
+                                                     struct LlaisysQwen2LoadStats* stats, int* created) {
+    if (!model || !image_path || !source) return -1;
+
+    try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        auto shared = std::make_unique<SharedWeights>(*model->model, image_path, source, to_load_options(options));
+        repoint_weights(model);
+        if (stats) *stats = to_load_stats(shared->stats());
+        if (created) *created = shared->created() ? 1 : 0;
+        // 旧的映像（如果有）在新的附加成功后才释放
+        model->shared_weights = std::move(shared);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to attach shared weights: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2ModelSetLayerStreaming(struct LlaisysQwen2Model* model, size_t lookahead,
+                                                   int drop_finished) {
+    if (!model) return -1;
+
+    try {
+        auto* m = model->model;
+        std::lock_guard<std::mutex> lock(m->mutex());
+        // 先销毁旧的预取线程，再按当前权重重新记录地址
+        m->set_layer_observer(nullptr);
+        if (lookahead > 0) {
+            m->set_layer_observer(std::make_shared<LayerStreamer>(*m, LayerStreamOptions{lookahead, drop_finished != 0}));
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to set layer streaming: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2ModelLayerStreamStats(struct LlaisysQwen2Model* model,
+                                                  struct LlaisysQwen2LayerStreamStats* stats) {
+    if (!model || !stats) return -1;
+    std::lock_guard<std::mutex> lock(model->model->mutex());
+    auto streamer = std::dynamic_pointer_cast<LayerStreamer>(model->model->layer_observer());
+    if (!streamer) return -1;
+    auto s = streamer->stats();
+    *stats = LlaisysQwen2LayerStreamStats{s.prefetched, s.released, s.stalls, s.stall_ms};
+    return 0;
+}
+
+__C __export int llaisysQwen2ModelFoldNormWeights(struct LlaisysQwen2Model* model) {
+    if (!model) return -1;
+
+    try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        model->model->fold_norm_weights();
+        repoint_weights(model);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to fold norm weights: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2ModelSaveLlaisys(struct LlaisysQwen2Model* model, const char* path) {
+    if (!model || !path) return -1;
+
+    try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        save_llaisys(*model->model, path);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to save llaisys file: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
 __C __export void llaisysQwen2ModelReset(struct LlaisysQwen2Model* model) {
     if (model) {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
         model->model->reset();
     }
 }
+
+__C __export void llaisysQwen2ModelSetGraphCapture(struct LlaisysQwen2Model* model, int enable) {
+    if (model) {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        model->model->set_graph_capture(enable != 0);
+    }
+}
+
+__C __export struct LlaisysQwen2Sequence* llaisysQwen2SequenceCreate(struct LlaisysQwen2Model* model) {
+    if (!model) return nullptr;
+    try {
+        return new LlaisysQwen2Sequence{model->model->create_kv_cache()};
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to create Qwen2 sequence: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+__C __export void llaisysQwen2SequenceDestroy(struct LlaisysQwen2Sequence* seq) {
+    delete seq;
+}
+
+__C __export void llaisysQwen2SequenceReset(struct LlaisysQwen2Sequence* seq) {
+    if (seq) {
+        seq->kv_cache->reset_all();
+    }
+}
+
+__C __export int64_t llaisysQwen2SequenceInfer(struct LlaisysQwen2Model* model, struct LlaisysQwen2Sequence* seq,
+                                              int64_t* token_ids, size_t ntoken) {
+    if (!model || !seq || !token_ids) return -1;
+    
+    try {
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        return model->model->infer(*seq->kv_cache, token_ids, ntoken);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 inference failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2ModelInferBatch(struct LlaisysQwen2Model* model, struct LlaisysQwen2Sequence** seqs,
+                                            int64_t* token_ids, size_t nseq, int64_t* next_tokens) {
+    if (!model || !seqs || !token_ids || !next_tokens) return -1;
+    
+    try {
+        std::vector<ModelKVCache*> kvs(nseq);
+        for (size_t i = 0; i < nseq; ++i) {
+            if (!seqs[i]) return -1;
+            kvs[i] = seqs[i]->kv_cache.get();
+        }
+        std::lock_guard<std::mutex> lock(model->model->mutex());
+        model->model->infer_batch(kvs.data(), token_ids, nseq, next_tokens);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 batch inference failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export struct LlaisysQwen2Session* llaisysQwen2SessionCreate(struct LlaisysQwen2Model* model) {
+    if (!model) return nullptr;
+    try {
+        return new LlaisysQwen2Session{std::make_unique<Qwen2Session>(*model->model, model->kv_manager.get())};
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to create Qwen2 session: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+__C __export void llaisysQwen2SessionDestroy(struct LlaisysQwen2Session* session) {
+    delete session;
+}
+
+__C __export int64_t llaisysQwen2SessionInfer(struct LlaisysQwen2Session* session, int64_t* token_ids, size_t ntoken) {
+    if (!session || !token_ids) return -1;
+    
+    try {
+        return session->session->infer(token_ids, ntoken);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 session inference failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export void llaisysQwen2SessionReset(struct LlaisysQwen2Session* session) {
+    if (session) {
+        session->session->reset();
+    }
+}
+
+__C __export size_t llaisysQwen2SessionLength(struct LlaisysQwen2Session* session) {
+    return session ? session->session->length() : 0;
+}
+
+__C __export size_t llaisysQwen2SessionKVBytes(struct LlaisysQwen2Session* session) {
+    return session ? session->session->kv_bytes() : 0;
+}
+
+__C __export int llaisysQwen2ModelSetKVBudget(struct LlaisysQwen2Model* model, size_t budget_bytes,
+                                             llaisysKVEvictionPolicy_t policy, const char* spill_dir) {
+    if (!model) return -1;
+    
+    try {
+        auto p = policy == LLAISYS_KV_EVICT_SPILL ? KVEvictionPolicy::SPILL : KVEvictionPolicy::DROP;
+        model->kv_manager->configure(budget_bytes, p, spill_dir ? spill_dir : "");
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to set Qwen2 KV budget: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export void llaisysQwen2ModelGetKVStats(struct LlaisysQwen2Model* model, struct LlaisysQwen2KVStats* stats) {
+    if (!model || !stats) return;
+    auto s = model->kv_manager->stats();
+    *stats = LlaisysQwen2KVStats{s.budget_bytes, s.used_bytes, s.peak_bytes, s.sessions, s.resident_sessions,
+                                 s.hits, s.misses, s.evictions, s.spilled_bytes, s.reprefill_tokens};
+}
+
+__C __export struct LlaisysQwen2Scheduler* llaisysQwen2SchedulerCreate(struct LlaisysQwen2Model* model,
+                                                                      size_t max_batch, size_t token_budget) {
+    if (!model) return nullptr;
+    return new LlaisysQwen2Scheduler{std::make_unique<Qwen2Scheduler>(*model->model, max_batch, token_budget),
+                                     model->model};
+}
+
+__C __export void llaisysQwen2SchedulerDestroy(struct LlaisysQwen2Scheduler* scheduler) {
+    delete scheduler;
+}
+
+__C __export int64_t llaisysQwen2SchedulerSubmit(struct LlaisysQwen2Scheduler* scheduler, int64_t* token_ids,
+                                                size_t ntoken, size_t max_new_tokens) {
+    if (!scheduler || !token_ids) return -1;
+    
+    try {
+        return scheduler->scheduler->submit(token_ids, ntoken, max_new_tokens);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 scheduler submit failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2SchedulerCancel(struct LlaisysQwen2Scheduler* scheduler, int64_t request_id) {
+    if (!scheduler) return 0;
+    return scheduler->scheduler->cancel(request_id) ? 1 : 0;
+}
+
+__C __export int64_t llaisysQwen2SchedulerStep(struct LlaisysQwen2Scheduler* scheduler) {
+    if (!scheduler) return -1;
+    
+    try {
+        std::lock_guard<std::mutex> lock(scheduler->model->mutex());
+        return static_cast<int64_t>(scheduler->scheduler->step());
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 scheduler step failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export size_t llaisysQwen2SchedulerPoll(struct LlaisysQwen2Scheduler* scheduler,
+                                             struct LlaisysQwen2TokenEvent* events, size_t capacity) {
+    if (!scheduler || !events) return 0;
+    
+    std::vector<TokenEvent> buf(std::min(capacity, scheduler->scheduler->num_pending_events()));
+    size_t n = scheduler->scheduler->poll(buf.data(), buf.size());
+    for (size_t i = 0; i < n; ++i) {
+        events[i] = LlaisysQwen2TokenEvent{buf[i].request_id, buf[i].token, buf[i].finished ? 1 : 0};
+    }
+    return n;
+}
+
+__C __export int llaisysQwen2SchedulerHasWork(struct LlaisysQwen2Scheduler* scheduler) {
+    return scheduler && scheduler->scheduler->has_work() ? 1 : 0;
+}
+
+__C __export struct LlaisysQwen2Speculator* llaisysQwen2SpeculatorCreate(struct LlaisysQwen2Model* target,
+                                                                        struct LlaisysQwen2Model* draft,
+                                                                        size_t num_draft, float temperature,
+                                                                        size_t top_k, uint64_t seed) {
+    if (!target || !draft) return nullptr;
+    
+    try {
+        SpeculativeParams params;
+        params.num_draft = num_draft;
+        params.temperature = temperature;
+        params.top_k = top_k;
+        params.seed = seed;
+        return new LlaisysQwen2Speculator{std::make_unique<SpeculativeDecoder>(*target->model, *draft->model, params),
+                                          target->model, draft->model};
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to create Qwen2 speculator: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+__C __export void llaisysQwen2SpeculatorDestroy(struct LlaisysQwen2Speculator* speculator) {
+    delete speculator;
+}
+
+// 同时锁住目标模型和草稿模型；两者可以是同一个模型
+static std::pair<std::unique_lock<std::mutex>, std::unique_lock<std::mutex>>
+lock_models(struct LlaisysQwen2Speculator* speculator) {
+    std::unique_lock<std::mutex> target(speculator->target->mutex(), std::defer_lock);
+    std::unique_lock<std::mutex> draft;
+    if (speculator->draft == speculator->target) {
+        target.lock();
+    } else {
+        draft = std::unique_lock<std::mutex>(speculator->draft->mutex(), std::defer_lock);
+        std::lock(target, draft);
+    }
+    return {std::move(target), std::move(draft)};
+}
+
+__C __export int64_t llaisysQwen2SpeculatorStart(struct LlaisysQwen2Speculator* speculator, int64_t* token_ids,
+                                                size_t ntoken) {
+    if (!speculator || !token_ids) return -1;
+    
+    try {
+        auto locks = lock_models(speculator);
+        return speculator->decoder->start(token_ids, ntoken);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 speculative prefill failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int64_t llaisysQwen2SpeculatorStep(struct LlaisysQwen2Speculator* speculator, int64_t* out_tokens) {
+    if (!speculator || !out_tokens) return -1;
+    
+    try {
+        auto locks = lock_models(speculator);
+        return static_cast<int64_t>(speculator->decoder->step(out_tokens));
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 speculative step failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export void llaisysQwen2SpeculatorGetStats(struct LlaisysQwen2Speculator* speculator,
+                                                struct LlaisysQwen2SpeculativeStats* stats) {
+    if (!speculator || !stats) return;
+    const auto& s = speculator->decoder->stats();
+    *stats = LlaisysQwen2SpeculativeStats{s.rounds, s.drafted, s.accepted, s.emitted};
+}
+
+__C __export int64_t llaisysQwen2SchedulerSubmitWithLookup(struct LlaisysQwen2Scheduler* scheduler, int64_t* token_ids,
+                                                          size_t ntoken, size_t max_new_tokens, size_t ngram,
+                                                          size_t num_draft) {
+    if (!scheduler || !token_ids) return -1;
+    
+    try {
+        PromptLookupParams lookup;
+        lookup.ngram = ngram;
+        lookup.num_draft = num_draft;
+        return scheduler->scheduler->submit(token_ids, ntoken, max_new_tokens, lookup);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 scheduler submit failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export void llaisysQwen2SchedulerGetLookupStats(struct LlaisysQwen2Scheduler* scheduler,
+                                                     struct LlaisysQwen2SpeculativeStats* stats) {
+    if (!scheduler || !stats) return;
+    const auto& s = scheduler->scheduler->lookup_stats();
+    *stats = LlaisysQwen2SpeculativeStats{s.rounds, s.drafted, s.accepted, s.emitted};
+}
+
+__C __export struct LlaisysQwen2TokenRing* llaisysQwen2TokenRingCreate(size_t capacity) {
+    try {
+        return new LlaisysQwen2TokenRing{std::make_unique<TokenRing>(capacity)};
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to create token ring: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+__C __export void llaisysQwen2TokenRingDestroy(struct LlaisysQwen2TokenRing* ring) {
+    delete ring;
+}
+
+__C __export size_t llaisysQwen2TokenRingPop(struct LlaisysQwen2TokenRing* ring, int64_t* tokens, size_t capacity, int wait) {
+    if (!ring || !tokens) return 0;
+    return ring->ring->pop(tokens, capacity, wait != 0);
+}
+
+__C __export int llaisysQwen2TokenRingFinished(struct LlaisysQwen2TokenRing* ring) {
+    return ring && ring->ring->finished() ? 1 : 0;
+}
+
+__C __export int llaisysQwen2ModelGenerate(struct LlaisysQwen2Model* model, int64_t* token_ids, size_t ntoken,
+                                          const struct LlaisysQwen2GenerateParams* params,
+                                          llaisysQwen2TokenCallback callback, void* user_data,
+                                          struct LlaisysQwen2TokenRing* ring, struct LlaisysQwen2GenerateResult* result) {
+    if (!model || !token_ids) {
+        if (ring) ring->ring->close();
+        return -1;
+    }
+    
+    try {
+        // 无论成功与否，结束时关闭队列，消费者不会一直等待
+        struct Close {
+            LlaisysQwen2TokenRing* ring;
+            ~Close() {
+                if (ring) ring->ring->close();
+            }
+        } close{ring};
+        
+        GenerateParams p;
+        if (params) {
+            p.max_new_tokens = params->max_new_tokens;
+            p.temperature = params->temperature;
+            p.top_k = params->top_k;
+            p.top_p = params->top_p;
+            p.seed = params->seed;
+            if (params->nstop_tokens > 0) {
+                p.stop_tokens.assign(params->stop_tokens, params->stop_tokens + params->nstop_tokens);
+            }
+            const int64_t* seq = params->stop_sequences;
+            for (size_t i = 0; i < params->nstop_sequences; ++i) {
+                p.stop_sequences.emplace_back(seq, seq + params->stop_sequence_lens[i]);
+                seq += params->stop_sequence_lens[i];
+            }
+            p.reuse_kv = params->reuse_kv != 0;
+        }
+        
+        auto r = generate(*model->model, token_ids, ntoken, p, [&](int64_t token) {
+            if (ring) ring->ring->push(token);
+            return !callback || callback(token, user_data) == 0;
+        });
+        if (result) {
+            *result = LlaisysQwen2GenerateResult{r.ntoken, r.reused, static_cast<llaisysQwen2StopReason_t>(r.stop_reason)};
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 generate failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export struct LlaisysQwen2Engine* llaisysQwen2EngineCreate(struct LlaisysQwen2Model* model, size_t max_batch,
+                                                               size_t token_budget) {
+    if (!model) return nullptr;
+    
+    try {
+        return new LlaisysQwen2Engine{std::make_unique<Qwen2Engine>(*model->model, max_batch, token_budget)};
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to create Qwen2 engine: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+__C __export void llaisysQwen2EngineDestroy(struct LlaisysQwen2Engine* engine) {
+    delete engine;
+}
+
+__C __export int64_t llaisysQwen2EngineSubmit(struct LlaisysQwen2Engine* engine, int64_t* token_ids, size_t ntoken,
+                                             size_t max_new_tokens, size_t ngram, size_t num_draft) {
+    if (!engine || !token_ids) return -1;
+    
+    try {
+        PromptLookupParams lookup;
+        lookup.ngram = ngram;
+        lookup.num_draft = num_draft;
+        return engine->engine->submit(token_ids, ntoken, max_new_tokens, lookup);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Qwen2 engine submit failed: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+__C __export int llaisysQwen2EngineCancel(struct LlaisysQwen2Engine* engine, int64_t request_id) {
+    return engine && engine->engine->cancel(request_id) ? 1 : 0;
+}
+
+__C __export size_t llaisysQwen2EnginePoll(struct LlaisysQwen2Engine* engine, struct LlaisysQwen2TokenEvent* events,
+                                          size_t capacity) {
+    if (!engine || !events) return 0;
+    
+    thread_local std::vector<TokenEvent> buffer;
+    buffer.resize(capacity);
+    size_t n = engine->engine->poll(buffer.data(), capacity);
+    for (size_t i = 0; i < n; ++i) {
+        events[i] = LlaisysQwen2TokenEvent{buffer[i].request_id, buffer[i].token, buffer[i].finished ? 1 : 0};
+    }
+    return n;
+}
+
+__C __export int llaisysQwen2EngineWait(struct LlaisysQwen2Engine* engine, int timeout_ms) {
+    return engine && engine->engine->wait(timeout_ms) ? 1 : 0;
+}
+
+__C __export int llaisysQwen2EngineFd(struct LlaisysQwen2Engine* engine) {
+    return engine ? engine->engine->fd() : -1;
+}
+
+__C __export size_t llaisysQwen2EngineNumActive(struct LlaisysQwen2Engine* engine) {
+    return engine ? engine->engine->num_active() : 0;
+}
@@ -10,4 +10,26 @@ __C void llaisysSetContextRuntime(llaisysDeviceType_t device_type, int device_id
 // Llaisys API for getting the runtime APIs
 __C const LlaisysRuntimeAPI *llaisysGetRuntimeAPI(llaisysDeviceType_t device_type) {
     return llaisys::device::getRuntimeAPI(device_type);
-}
\ No newline at end of file
+}
+// Llaisys API for selecting the allocator of a device runtime
+__C void llaisysSetContextAllocator(llaisysDeviceType_t device_type, int device_id, llaisysAllocatorType_t type, size_t max_cached_bytes) {
+    llaisys::core::context().setDevice(device_type, device_id);
+    llaisys::core::context().runtime().setAllocator(type, max_cached_bytes);
+}
+
+// Llaisys API for querying allocator statistics
+__C void llaisysGetContextMemoryStats(llaisysDeviceType_t device_type, int device_id, struct LlaisysMemoryStats *stats) {
+    llaisys::core::context().setDevice(device_type, device_id);
+    *stats = llaisys::core::context().runtime().memoryStats();
+}
+
+// Llaisys API for releasing cached device memory
+__C void llaisysTrimContextAllocator(llaisysDeviceType_t device_type, int device_id) {
+    llaisys::core::context().setDevice(device_type, device_id);
+    llaisys::core::context().runtime().trimAllocator();
+}
+
+// Llaisys API for setting how the CPU runtime backs large blocks
+__C void llaisysSetCpuMemoryPolicy(llaisysHugePageMode_t mode, size_t huge_page_min_bytes) {
+    llaisys::device::cpu::setMemoryPolicy(mode, huge_page_min_bytes);
+}
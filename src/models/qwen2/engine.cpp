@@ -0,0 +1,206 @@
+#include "engine.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace llaisys::models {
+
+Qwen2Engine::Qwen2Engine(Qwen2Model& model, size_t max_batch, size_t token_budget)
+    : model_(model), scheduler_(model, max_batch, token_budget) {
+#if defined(__linux__)
+    notify_read_ = notify_write_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    CHECK_ARGUMENT(notify_read_ >= 0, "Qwen2Engine: eventfd failed");
+#elif !defined(_WIN32)
+    int fds[2];
+    CHECK_ARGUMENT(pipe(fds) == 0, "Qwen2Engine: pipe failed");
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    notify_read_ = fds[0];
+    notify_write_ = fds[1];
+#endif
+    worker_ = std::thread([this] { run(); });
+}
+
+Qwen2Engine::~Qwen2Engine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    worker_.join();
+#if !defined(_WIN32)
+    if (notify_read_ >= 0) close(notify_read_);
+    if (notify_write_ >= 0 && notify_write_ != notify_read_) close(notify_write_);
+#endif
+}
+
+int64_t Qwen2Engine::submit(const int64_t* tokens, size_t n, size_t max_new_tokens, const PromptLookupParams& lookup) {
+    // 与调度器相同的检查，在调用线程上立即报错
+    CHECK_ARGUMENT(n > 0, "Qwen2Engine: empty prompt");
+    CHECK_ARGUMENT(n < model_.config().maxseq, "Qwen2Engine: prompt exceeds maxseq");
+    CHECK_ARGUMENT(max_new_tokens > 0, "Qwen2Engine: max_new_tokens must be positive");
+    CHECK_ARGUMENT(lookup.num_draft == 0 || lookup.ngram > 0, "Qwen2Engine: ngram must be positive");
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t id = next_id_++;
+    incoming_.push_back(Submission{id, std::vector<int64_t>(tokens, tokens + n), max_new_tokens, lookup});
+    active_[id] = State::QUEUED;
+    work_cv_.notify_one();
+    return id;
+}
+
+bool Qwen2Engine::cancel(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = active_.find(id);
+    if (it == active_.end() || it->second == State::CANCELLING) return false;
+
+    if (it->second == State::QUEUED) {
+        // 还没交给调度器，直接结束
+        incoming_.erase(std::find_if(incoming_.begin(), incoming_.end(),
+                                     [id](const Submission& s) { return s.id == id; }));
+        active_.erase(it);
+        publish(TokenEvent{id, -1, true});
+        return true;
+    }
+    it->second = State::CANCELLING;
+    cancels_.push_back(id);
+    work_cv_.notify_one();
+    return true;
+}
+
+size_t Qwen2Engine::poll(TokenEvent* events, size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = std::min(capacity, events_.size());
+    std::copy_n(events_.begin(), n, events);
+    events_.erase(events_.begin(), events_.begin() + n);
+    if (events_.empty()) clear_signal();
+    return n;
+}
+
+bool Qwen2Engine::wait(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ready = [this] { return !events_.empty(); };
+    if (timeout_ms < 0) {
+        events_cv_.wait(lock, ready);
+        return true;
+    }
+    return events_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+}
+
+size_t Qwen2Engine::num_active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_.size();
+}
+
+std::string Qwen2Engine::last_error() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+void Qwen2Engine::run() {
+    std::deque<Submission> subs;
+    std::vector<int64_t> cancels;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this] {
+                return stop_ || !incoming_.empty() || !cancels_.empty() || scheduler_.has_work();
+            });
+            if (stop_) return;
+            subs.swap(incoming_);
+            cancels.swap(cancels_);
+            for (const auto& s : subs) active_[s.id] = State::RUNNING;
+        }
+
+        std::string error;
+        std::vector<int64_t> failed; // 没能交给调度器的请求
+        try {
+            for (const auto& s : subs) {
+                int64_t sched_id = scheduler_.submit(s.prompt.data(), s.prompt.size(), s.max_new_tokens, s.lookup);
+                sched_to_engine_[sched_id] = s.id;
+                engine_to_sched_[s.id] = sched_id;
+            }
+            for (int64_t id : cancels) {
+                auto it = engine_to_sched_.find(id);
+                if (it != engine_to_sched_.end()) scheduler_.cancel(it->second);
+            }
+            if (scheduler_.has_work()) {
+                std::lock_guard<std::mutex> lock(model_.mutex());
+                scheduler_.step();
+            }
+        } catch (const std::exception& e) {
+            // 调度器状态已不可信，结束所有进行中的请求
+            error = e.what();
+            for (const auto& s : subs) {
+                if (!engine_to_sched_.count(s.id)) failed.push_back(s.id);
+            }
+            for (const auto& [sched_id, id] : sched_to_engine_) scheduler_.cancel(sched_id);
+        }
+        subs.clear();
+        cancels.clear();
+
+        step_events_.resize(scheduler_.num_pending_events());
+        step_events_.resize(scheduler_.poll(step_events_.data(), step_events_.size()));
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error.empty()) error_ = error;
+        for (int64_t id : failed) {
+            active_.erase(id);
+            publish(TokenEvent{id, -1, true});
+        }
+        for (auto event : step_events_) {
+            auto it = sched_to_engine_.find(event.request_id);
+            if (it == sched_to_engine_.end()) continue;
+            event.request_id = it->second;
+            if (event.finished) {
+                active_.erase(event.request_id);
+                engine_to_sched_.erase(event.request_id);
+                sched_to_engine_.erase(it);
+            }
+            publish(event);
+        }
+    }
+}
+
+void Qwen2Engine::publish(const TokenEvent& event) {
+    events_.push_back(event);
+    signal();
+    events_cv_.notify_all();
+}
+
+void Qwen2Engine::signal() {
+    if (signaled_) return;
+    signaled_ = true;
+#if defined(__linux__)
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t r = write(notify_write_, &one, sizeof(one));
+#elif !defined(_WIN32)
+    char one = 1;
+    [[maybe_unused]] ssize_t r = write(notify_write_, &one, 1);
+#endif
+}
+
+void Qwen2Engine::clear_signal() {
+    if (!signaled_) return;
+    signaled_ = false;
+#if defined(__linux__)
+    uint64_t count;
+    [[maybe_unused]] ssize_t r = read(notify_read_, &count, sizeof(count));
+#elif !defined(_WIN32)
+    char buf[16];
+    while (read(notify_read_, buf, sizeof(buf)) > 0) {
+    }
+#endif
+}
+
+} // namespace llaisys::models
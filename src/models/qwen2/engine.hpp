@@ -0,0 +1,85 @@
+#pragma once
+#include "scheduler.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::models {
+
+// 异步推理引擎：调度器运行在引擎自己的工作线程上，submit / cancel / poll 都不等待前向。
+// 产生 token 时引擎的通知 fd（Linux 上为 eventfd，其他 POSIX 系统为管道）变为可读，
+// 事件循环（epoll、asyncio 的 add_reader 等）监听该 fd 后调用 poll 取出 token；
+// 所有事件取空后 fd 重新变为不可读。不支持 fd 的平台上 fd() 为 -1，可用 wait 阻塞等待。
+// 前向时持有模型的 mutex()，与同一模型上的会话、generate 以及 C API 的推理 / 加载入口互斥，
+// 因此可以与它们并存。
+class Qwen2Engine {
+public:
+    Qwen2Engine(Qwen2Model& model, size_t max_batch, size_t token_budget);
+    ~Qwen2Engine();
+
+    Qwen2Engine(const Qwen2Engine&) = delete;
+    Qwen2Engine& operator=(const Qwen2Engine&) = delete;
+
+    // 提交请求，返回请求 id；参数错误时立即抛出异常
+    int64_t submit(const int64_t* token_ids, size_t ntoken, size_t max_new_tokens,
+                   const PromptLookupParams& lookup = PromptLookupParams{});
+    // 请求未结束时返回 true，随后产生一个 token 为 -1 的结束事件
+    bool cancel(int64_t request_id);
+
+    // 取出至多 capacity 个事件，不阻塞
+    size_t poll(TokenEvent* events, size_t capacity);
+    // 阻塞到有事件可取或超时（timeout_ms < 0 为不超时），返回是否有事件
+    bool wait(int timeout_ms);
+
+    int fd() const { return notify_read_; }
+    // 已提交且尚未结束的请求数
+    size_t num_active() const;
+    // 工作线程上最近一次失败（把请求交给调度器或前向）的原因，失败时所有进行中的请求以 -1 结束
+    std::string last_error() const;
+
+private:
+    struct Submission {
+        int64_t id;
+        std::vector<int64_t> prompt;
+        size_t max_new_tokens;
+        PromptLookupParams lookup;
+    };
+
+    Qwen2Model& model_;
+    Qwen2Scheduler scheduler_; // 只在工作线程上访问
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;   // 通知工作线程有新的提交 / 取消 / 退出
+    std::condition_variable events_cv_; // 通知 wait 有新事件
+    std::deque<Submission> incoming_;
+    std::vector<int64_t> cancels_;
+    std::deque<TokenEvent> events_;
+    enum class State { QUEUED, RUNNING, CANCELLING };
+    std::unordered_map<int64_t, State> active_; // 未结束的请求
+    int64_t next_id_ = 0;
+    bool stop_ = false;
+    std::string error_;
+
+    // 工作线程私有：调度器 id -> 引擎 id
+    std::unordered_map<int64_t, int64_t> sched_to_engine_;
+    std::unordered_map<int64_t, int64_t> engine_to_sched_;
+    std::vector<TokenEvent> step_events_;
+
+    int notify_read_ = -1;
+    int notify_write_ = -1;
+    bool signaled_ = false;
+
+    std::thread worker_;
+
+    void run();
+    // 调用者持有 mutex_
+    void publish(const TokenEvent& event);
+    void signal();
+    void clear_signal();
+};
+
+} // namespace llaisys::models
@@ -0,0 +1,195 @@
+#include "generator.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace llaisys::models {
+
+// top_k 为 0 时参与采样的候选数上限：lm_head_topk 按插入排序维护候选表，
+// 更长的尾部概率可以忽略
+static constexpr size_t MAX_SAMPLE_K = 256;
+
+TokenRing::TokenRing(size_t capacity) : _capacity(capacity) {
+    CHECK_ARGUMENT(capacity > 0, "TokenRing: capacity must be positive");
+}
+
+void TokenRing::push(int64_t token) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock, [&] { return _tokens.size() < _capacity; });
+    _tokens.push_back(token);
+    _not_empty.notify_one();
+}
+
+void TokenRing::close() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _not_empty.notify_all();
+}
+
+size_t TokenRing::pop(int64_t* out, size_t max_tokens, bool wait) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (wait) _not_empty.wait(lock, [&] { return !_tokens.empty() || _closed; });
+    size_t n = std::min(max_tokens, _tokens.size());
+    std::copy_n(_tokens.begin(), n, out);
+    _tokens.erase(_tokens.begin(), _tokens.begin() + n);
+    if (n > 0) _not_full.notify_one();
+    return n;
+}
+
+bool TokenRing::finished() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _closed && _tokens.empty();
+}
+
+namespace {
+
+// 在 top-k 候选上按 temperature / top_p 采样，候选按 logits 降序排列
+class Sampler {
+public:
+    Sampler(const GenerateParams& params, size_t voc) : params_(params), rng_(params.seed) {
+        greedy_ = params.temperature <= 0.0f || params.top_k == 1;
+        k_ = greedy_ ? 1 : std::min(params.top_k == 0 ? MAX_SAMPLE_K : params.top_k, voc);
+        idx_.resize(k_);
+        logit_.resize(k_);
+        prob_.resize(k_);
+    }
+
+    bool greedy() const { return greedy_; }
+    size_t k() const { return k_; }
+    int64_t* indices() { return idx_.data(); }
+    float* logits() { return logit_.data(); }
+
+    int64_t sample() {
+        float sum = 0.0f;
+        for (size_t j = 0; j < k_; ++j) {
+            prob_[j] = std::exp((logit_[j] - logit_[0]) / params_.temperature);
+            sum += prob_[j];
+        }
+        // 截取累计概率达到 top_p 的最小前缀
+        size_t n = 0;
+        float kept = 0.0f;
+        while (n < k_ && (n == 0 || kept < params_.top_p * sum)) kept += prob_[n++];
+
+        float r = std::uniform_real_distribution<float>(0.0f, kept)(rng_);
+        for (size_t j = 0; j + 1 < n; ++j) {
+            r -= prob_[j];
+            if (r < 0.0f) return idx_[j];
+        }
+        return idx_[n - 1];
+    }
+
+private:
+    const GenerateParams& params_;
+    std::mt19937_64 rng_;
+    bool greedy_;
+    size_t k_;
+    std::vector<int64_t> idx_;
+    std::vector<float> logit_;
+    std::vector<float> prob_;
+};
+
+bool ends_with(const std::vector<int64_t>& tokens, const int64_t* seq, size_t len) {
+    return tokens.size() >= len && std::equal(seq, seq + len, tokens.end() - len);
+}
+
+} // namespace
+
+GenerateResult generate(Qwen2Model& model, const int64_t* prompt, size_t n,
+                        const GenerateParams& params, const TokenCallback& on_token) {
+    CHECK_ARGUMENT(n > 0, "generate: empty prompt");
+    CHECK_ARGUMENT(n <= model.config().maxseq, "generate: prompt exceeds maxseq");
+    CHECK_ARGUMENT(params.max_new_tokens > 0, "generate: max_new_tokens must be positive");
+    CHECK_ARGUMENT(params.top_p > 0.0f, "generate: top_p must be positive");
+    for (const auto& s : params.stop_sequences) {
+        CHECK_ARGUMENT(!s.empty(), "generate: empty stop sequence");
+    }
+
+    GenerateResult result;
+    Sampler sampler(params, model.config().voc);
+    std::vector<int64_t> generated;
+    // generated 末尾尚未交给回调的 token 数（可能是某个停止序列的前缀）
+    size_t held = 0;
+    size_t pos = n; // 下一个 token 的位置
+    bool stop = false;
+
+    auto deliver = [&](size_t count) {
+        size_t begin = generated.size() - held;
+        held -= count;
+        for (size_t i = 0; i < count && !stop; ++i) {
+            result.ntoken++;
+            if (on_token && !on_token(generated[begin + i])) {
+                result.stop_reason = StopReason::CALLBACK;
+                stop = true;
+            }
+        }
+    };
+
+    auto next = [&](const int64_t* tokens, size_t count) {
+        std::lock_guard<std::mutex> lock(model.mutex());
+        if (sampler.greedy()) return model.infer_one_step(tokens, count);
+        model.infer_one_step_topk(tokens, count, sampler.k(), sampler.indices(), sampler.logits());
+        return sampler.sample();
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(model.mutex());
+        if (params.reuse_kv) {
+            result.reused = model.reuse_prefix(prompt, n);
+        } else {
+            model.reset();
+        }
+    }
+    int64_t token = next(prompt + result.reused, n - result.reused);
+
+    while (!stop) {
+        generated.push_back(token);
+        held++;
+
+        // 完整匹配停止序列：匹配部分全部处于暂存中，丢弃后停止
+        const std::vector<int64_t>* matched = nullptr;
+        for (const auto& s : params.stop_sequences) {
+            if (ends_with(generated, s.data(), s.size())) {
+                matched = &s;
+                break;
+            }
+        }
+        if (matched) {
+            generated.resize(generated.size() - matched->size());
+            held -= matched->size();
+            deliver(held);
+            if (!stop) result.stop_reason = StopReason::STOP_SEQUENCE;
+            break;
+        }
+
+        bool stop_token = token == model.config().eos_token_id
+                       || std::find(params.stop_tokens.begin(), params.stop_tokens.end(), token) != params.stop_tokens.end();
+        if (stop_token || generated.size() >= params.max_new_tokens || pos >= model.config().maxseq) {
+            deliver(held);
+            if (!stop) {
+                result.stop_reason = stop_token                               ? StopReason::STOP_TOKEN
+                                   : generated.size() >= params.max_new_tokens ? StopReason::MAX_TOKENS
+                                                                               : StopReason::MAXSEQ;
+            }
+            break;
+        }
+
+        // 仍需暂存的长度：generated 的最长后缀，且是某个停止序列的真前缀
+        size_t keep = 0;
+        for (const auto& s : params.stop_sequences) {
+            for (size_t len = std::min(s.size() - 1, held); len > keep; --len) {
+                if (ends_with(generated, s.data(), len)) {
+                    keep = len;
+                    break;
+                }
+            }
+        }
+        deliver(held - keep);
+        if (stop) break;
+
+        token = next(&token, 1);
+        pos++;
+    }
+    return result;
+}
+
+} // namespace llaisys::models
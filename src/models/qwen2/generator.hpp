@@ -0,0 +1,71 @@
+#pragma once
+#include "qwen2_model.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace llaisys::models {
+
+struct GenerateParams {
+    size_t max_new_tokens = 128;
+    float temperature = 0.0f; // <= 0 为贪心
+    size_t top_k = 1;         // 只在 logits 最大的 top_k 个 token 中采样，0 为不限（至多 MAX_SAMPLE_K 个）
+    float top_p = 1.0f;       // 再截取累计概率达到 top_p 的最小集合
+    uint64_t seed = 0;
+    // 除模型 eos_token_id 外的停止 token，停止 token 本身会输出
+    std::vector<int64_t> stop_tokens;
+    // 生成结果以其中任一序列结尾时停止，匹配到的序列不输出
+    std::vector<std::vector<int64_t>> stop_sequences;
+    // 复用与上次默认序列已缓存 token 的公共前缀（见 Qwen2Model::infer_reuse）
+    bool reuse_kv = true;
+};
+
+// 与 C API 的 llaisysQwen2StopReason_t 取值一致
+enum class StopReason {
+    MAX_TOKENS = 0,
+    STOP_TOKEN = 1,
+    STOP_SEQUENCE = 2,
+    MAXSEQ = 3,
+    CALLBACK = 4, // 回调要求停止
+};
+
+struct GenerateResult {
+    size_t ntoken = 0; // 输出的 token 数
+    size_t reused = 0; // 复用的 KV-Cache 长度
+    StopReason stop_reason = StopReason::MAX_TOKENS;
+};
+
+// 每输出一个 token 调用一次，返回 false 时停止生成
+using TokenCallback = std::function<bool(int64_t)>;
+
+// 有界的单生产者 token 队列：生成线程 push，消费线程 pop。
+// 满时 push 阻塞到有空位；close 之后 pop 取完剩余 token 即返回 0
+class TokenRing {
+public:
+    explicit TokenRing(size_t capacity);
+
+    void push(int64_t token);
+    void close();
+    // 取出至多 max_tokens 个 token；wait 为真时阻塞到至少有一个 token 或队列已关闭
+    size_t pop(int64_t* out, size_t max_tokens, bool wait);
+    // 已关闭且取空
+    bool finished() const;
+
+private:
+    size_t _capacity;
+    std::deque<int64_t> _tokens;
+    bool _closed = false;
+    mutable std::mutex _mutex;
+    std::condition_variable _not_empty, _not_full;
+};
+
+// 在模型的默认序列上运行完整的解码循环：预填充 prompt（可复用已缓存的前缀），
+// 逐 token 贪心或采样解码，直到 max_new_tokens、停止 token / 停止序列、maxseq 或回调要求停止。
+// 可能是停止序列前缀的 token 先暂存，确定不匹配后才交给回调
+GenerateResult generate(Qwen2Model& model, const int64_t* prompt, size_t ntoken,
+                        const GenerateParams& params, const TokenCallback& on_token);
+
+} // namespace llaisys::models
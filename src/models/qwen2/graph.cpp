@@ -0,0 +1,11 @@
+#include "graph.hpp"
+
+namespace llaisys::models {
+
+void StepGraph::replay(const std::vector<SeqStep>& steps) const {
+    for (const auto& node : _nodes) {
+        node(steps);
+    }
+}
+
+} // namespace llaisys::models
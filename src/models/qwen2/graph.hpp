@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace llaisys::models {
+
+class ModelKVCache;
+
+// 一步前向中一条序列的参数。同一步内各序列的 token 按顺序排列在激活的行上。
+struct SeqStep {
+    ModelKVCache* kv;
+    size_t past_len; // 本步之前该序列 KV-Cache 中已有的 token 数
+    size_t ntoken;   // 本步该序列的 token 数
+    bool sample;     // 是否需要该序列最后一个 token 之后的下一个 token
+    bool verify = false; // 是否需要每个 token 之后的下一个 token（验证投机草稿），此时忽略 sample
+};
+
+// 录制的执行计划：一次前向中全部 kernel 调用，指针与尺寸在录制时已解析好。
+// 回放时跳过算子包装层的形状检查、dtype 分发、设备切换与张量元数据构造，
+// 每步只需传入各序列的 KV-Cache 与长度（位置由调用方写入固定的 pos 缓冲区）。
+class StepGraph {
+public:
+    using Node = std::function<void(const std::vector<SeqStep>& steps)>;
+
+    void record(Node node) { _nodes.push_back(std::move(node)); }
+    void replay(const std::vector<SeqStep>& steps) const;
+
+    bool empty() const { return _nodes.empty(); }
+    size_t size() const { return _nodes.size(); }
+
+private:
+    std::vector<Node> _nodes;
+};
+
+} // namespace llaisys::models
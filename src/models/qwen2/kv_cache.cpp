@@ -1,6 +1,10 @@
 #include "kv_cache.hpp"
 #include "../../utils.hpp"
+#include "../../core/llaisys_core.hpp"
+#include <algorithm>
 #include <cstring>
+#include <istream>
+#include <ostream>
 
 namespace llaisys::models {
 
@@ -12,11 +16,12 @@ tensor_t LayerKVCache::update_k(tensor_t new_k) {
     size_t dh = new_k->shape()[2];
     
     size_t row_bytes = nkvh * dh * new_k->elementSize();
+    size_t src_stride = new_k->strides()[0] * new_k->elementSize(); // 源可以是融合 qkv 的跨步视图
     std::byte* dst = k_cache->data();
     const std::byte* src = new_k->data();
     
     for (size_t i = 0; i < len; ++i) {
-        std::memcpy(dst + (current_len + i) * row_bytes, src + i * row_bytes, row_bytes);
+        std::memcpy(dst + (current_len + i) * row_bytes, src + i * src_stride, row_bytes);
     }
     
     return k_cache->slice(0, 0, current_len + len);
@@ -30,11 +35,12 @@ tensor_t LayerKVCache::update_v(tensor_t new_v) {
     size_t dh = new_v->shape()[2];
     
     size_t row_bytes = nkvh * dh * new_v->elementSize();
+    size_t src_stride = new_v->strides()[0] * new_v->elementSize(); // 源可以是融合 qkv 的跨步视图
     std::byte* dst = v_cache->data();
     const std::byte* src = new_v->data();
     
     for (size_t i = 0; i < len; ++i) {
-        std::memcpy(dst + (current_len + i) * row_bytes, src + i * row_bytes, row_bytes);
+        std::memcpy(dst + (current_len + i) * row_bytes, src + i * src_stride, row_bytes);
     }
     
     current_len += len;
@@ -47,10 +53,82 @@ ModelKVCache::ModelKVCache(size_t nlayer, size_t maxlen, size_t nkvh, size_t dh,
       _dtype(dtype), _device_type(dev), _device_id(dev_id) {
     
     _layers.resize(nlayer);
-    for (size_t i = 0; i < nlayer; ++i) {
-        _layers[i].k_cache = Tensor::create({maxlen, nkvh, dh}, dtype, dev, dev_id);
-        _layers[i].v_cache = Tensor::create({maxlen, nkvh, dh}, dtype, dev, dev_id);
-        _layers[i].current_len = 0;
+}
+
+void ModelKVCache::reserve(size_t len) {
+    ASSERT(len <= _max_len, "ModelKVCache: cache overflow");
+    if (len <= _capacity) return;
+    
+    size_t cap = std::max(len, _capacity * 2);
+    cap = std::min((cap + GROW_STEP - 1) / GROW_STEP * GROW_STEP, _max_len);
+    for (auto& layer : _layers) {
+        auto k = Tensor::create({cap, _nkvhead, _dh}, _dtype, _device_type, _device_id);
+        auto v = Tensor::create({cap, _nkvhead, _dh}, _dtype, _device_type, _device_id);
+        if (layer.current_len > 0) {
+            size_t used = layer.current_len * _nkvhead * _dh * utils::dsize(_dtype);
+            core::context().setDevice(_device_type, _device_id);
+            core::context().runtime().api()->memcpy_sync(k->data(), layer.k_cache->data(), used, LLAISYS_MEMCPY_D2D);
+            core::context().runtime().api()->memcpy_sync(v->data(), layer.v_cache->data(), used, LLAISYS_MEMCPY_D2D);
+        }
+        layer.k_cache = std::move(k);
+        layer.v_cache = std::move(v);
+    }
+    _capacity = cap;
+}
+
+void ModelKVCache::release() {
+    for (auto& layer : _layers) {
+        layer.k_cache.reset();
+        layer.v_cache.reset();
+        layer.current_len = 0;
+    }
+    _capacity = 0;
+}
+
+size_t ModelKVCache::bytes() const {
+    return 2 * _nlayer * _capacity * _nkvhead * _dh * utils::dsize(_dtype);
+}
+
+size_t ModelKVCache::bytes_for(size_t len) const {
+    size_t row_bytes = 2 * _nlayer * _nkvhead * _dh * utils::dsize(_dtype);
+    return std::max(bytes(), std::min(len, _max_len) * row_bytes);
+}
+
+void ModelKVCache::save(std::ostream& out) const {
+    ASSERT(_device_type == LLAISYS_DEVICE_CPU, "ModelKVCache: only cpu caches can be saved");
+    size_t row_bytes = _nkvhead * _dh * utils::dsize(_dtype);
+    for (const auto& layer : _layers) {
+        if (layer.current_len == 0) continue;
+        out.write(reinterpret_cast<const char*>(layer.k_cache->data()), layer.current_len * row_bytes);
+        out.write(reinterpret_cast<const char*>(layer.v_cache->data()), layer.current_len * row_bytes);
+    }
+    CHECK_ARGUMENT(out.good(), "ModelKVCache: failed to write cache");
+}
+
+void ModelKVCache::load(std::istream& in, size_t len) {
+    ASSERT(_device_type == LLAISYS_DEVICE_CPU, "ModelKVCache: only cpu caches can be loaded");
+    reset_all();
+    if (len == 0) return;
+    reserve(len);
+    size_t row_bytes = _nkvhead * _dh * utils::dsize(_dtype);
+    for (auto& layer : _layers) {
+        in.read(reinterpret_cast<char*>(layer.k_cache->data()), len * row_bytes);
+        in.read(reinterpret_cast<char*>(layer.v_cache->data()), len * row_bytes);
+        layer.current_len = len;
+    }
+    CHECK_ARGUMENT(in.good(), "ModelKVCache: failed to read cache");
+}
+
+void ModelKVCache::advance(size_t len) {
+    for (auto& layer : _layers) {
+        ASSERT(layer.current_len + len <= _capacity, "ModelKVCache: cache overflow");
+        layer.current_len += len;
+    }
+}
+
+void ModelKVCache::truncate(size_t len) {
+    for (auto& layer : _layers) {
+        layer.truncate(len);
     }
 }
 
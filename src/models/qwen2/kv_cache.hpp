@@ -1,13 +1,14 @@
 #pragma once
 #include "../../tensor/tensor.hpp"
+#include <iosfwd>
 #include <vector>
 
 namespace llaisys::models {
 
 // 单层的 KV-Cache
 struct LayerKVCache {
-    tensor_t k_cache;  // [max_len, nkvhead, dh]
-    tensor_t v_cache;  // [max_len, nkvhead, dh]
+    tensor_t k_cache;  // [capacity, nkvhead, dh]
+    tensor_t v_cache;  // [capacity, nkvhead, dh]
     size_t current_len;  // 当前已使用的长度
     
     LayerKVCache() : current_len(0) {}
@@ -17,16 +18,23 @@ struct LayerKVCache {
         current_len = 0;
     }
     
+    // 回滚到前 len 个 token（丢弃投机解码中被拒绝的条目）
+    void truncate(size_t len) {
+        if (len < current_len) current_len = len;
+    }
+    
     // 更新缓存并返回完整的 K/V
     tensor_t update_k(tensor_t new_k);  // new_k: [seqlen, nkvhead, dh]
     tensor_t update_v(tensor_t new_v);  // new_v: [seqlen, nkvhead, dh]
 };
 
-// 整个模型的 KV-Cache
+// 整个模型的 KV-Cache。存储按需增长（容量按 GROW_STEP 对齐、至少翻倍，不超过 max_len），
+// 占用的内存与序列实际长度成正比
 class ModelKVCache {
 private:
     std::vector<LayerKVCache> _layers;
     size_t _max_len;
+    size_t _capacity = 0;
     size_t _nlayer;
     size_t _nkvhead;
     size_t _dh;
@@ -40,8 +48,29 @@ public:
     
     LayerKVCache& get_layer(size_t layer_idx) { return _layers[layer_idx]; }
     
+    static constexpr size_t GROW_STEP = 64;
+    
     void reset_all();
+    // 保证至少能容纳 len 个 token，必要时扩容并拷贝已有条目
+    void reserve(size_t len);
+    // 清空并释放存储
+    void release();
+    // 已缓存的 token 数，即下一个 token 的位置
+    size_t length() const { return _layers.empty() ? 0 : _layers[0].current_len; }
+    // 所有层的已用长度增加 len（数据已由调用方直接写入缓存）
+    void advance(size_t len);
+    // 所有层回滚到前 len 个 token
+    void truncate(size_t len);
     size_t max_len() const { return _max_len; }
+    size_t capacity() const { return _capacity; }
+    // 当前存储占用的字节数
+    size_t bytes() const;
+    // 容纳 len 个 token 时存储占用的字节数（不小于当前占用）
+    size_t bytes_for(size_t len) const;
+    
+    // 把已缓存的条目写入流 / 从流中读回 len 个 token 的条目（仅 CPU），用于换出到文件
+    void save(std::ostream& out) const;
+    void load(std::istream& in, size_t len);
 };
 
 } // namespace llaisys::models
@@ -0,0 +1,184 @@
+#include "kv_manager.hpp"
+#include "session.hpp"
+#include "../../utils.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace llaisys::models {
+
+namespace {
+
+// 在 dir 下新建一个唯一的换出文件并返回路径。fork 出的多个进程地址布局相同，
+// 不能只靠 this 区分文件名
+std::string create_spill_file(const std::string& dir, const void* owner, size_t id) {
+#if defined(_WIN32)
+    std::string path = dir + "/llaisys_kv_" + std::to_string(_getpid()) + "_"
+                     + std::to_string(reinterpret_cast<uintptr_t>(owner)) + "_" + std::to_string(id) + ".bin";
+    std::ofstream create(path, std::ios::binary | std::ios::trunc);
+    CHECK_ARGUMENT(create.is_open(), "KVMemoryManager: cannot create spill file " + path);
+    return path;
+#else
+    (void)owner;
+    (void)id;
+    std::string path = dir + "/llaisys_kv_XXXXXX";
+    int fd = mkstemp(path.data());
+    CHECK_ARGUMENT(fd >= 0, "KVMemoryManager: cannot create spill file in " + dir);
+    close(fd);
+    return path;
+#endif
+}
+
+} // namespace
+
+KVMemoryManager::~KVMemoryManager() {
+    for (auto& [session, entry] : entries_) {
+        if (entry.state == State::SPILLED) std::remove(entry.spill_path.c_str());
+    }
+}
+
+void KVMemoryManager::configure(size_t budget_bytes, KVEvictionPolicy policy, const std::string& spill_dir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_bytes_ = budget_bytes;
+    policy_ = policy;
+    spill_dir_ = spill_dir.empty() ? "." : spill_dir;
+    enforce_budget(used_bytes());
+}
+
+KVMemoryStats KVMemoryManager::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    KVMemoryStats s = stats_;
+    s.budget_bytes = budget_bytes_;
+    s.used_bytes = used_bytes();
+    s.sessions = entries_.size();
+    s.resident_sessions = 0;
+    for (const auto& [session, entry] : entries_) {
+        s.resident_sessions += entry.state == State::RESIDENT ? 1 : 0;
+    }
+    return s;
+}
+
+void KVMemoryManager::attach(Qwen2Session& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_[&session];
+    entry.lru = lru_.insert(lru_.end(), &session);
+}
+
+void KVMemoryManager::detach(Qwen2Session& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(&session);
+    if (it == entries_.end()) return;
+    if (it->second.state == State::SPILLED) std::remove(it->second.spill_path.c_str());
+    lru_.erase(it->second.lru);
+    entries_.erase(it);
+}
+
+bool KVMemoryManager::acquire(Qwen2Session& session, size_t target_len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_.at(&session);
+    entry.busy = true;
+    lru_.splice(lru_.end(), lru_, entry.lru);
+    
+    bool resident = entry.state == State::RESIDENT;
+    bool reprefill = entry.state == State::DROPPED;
+    if (resident) {
+        stats_.hits++;
+    } else {
+        stats_.misses++;
+        if (reprefill) stats_.reprefill_tokens += session.length();
+    }
+    // 按本次前向后的预计占用记账，先腾出预算，再恢复被驱逐的 KV
+    entry.bytes = session.kv_cache().bytes_for(target_len);
+    enforce_budget(used_bytes() + (resident ? 0 : entry.bytes));
+    if (!resident) restore(&session, entry);
+    return reprefill;
+}
+
+void KVMemoryManager::release(Qwen2Session& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_.at(&session);
+    entry.busy = false;
+    entry.bytes = session.kv_cache().bytes();
+    enforce_budget(used_bytes(), &session);
+}
+
+void KVMemoryManager::reset(Qwen2Session& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_.at(&session);
+    if (entry.state == State::SPILLED) {
+        std::remove(entry.spill_path.c_str());
+        entry.spill_path.clear();
+    }
+    entry.state = State::RESIDENT;
+    session.kv_cache().reset_all();
+    entry.bytes = session.kv_cache().bytes();
+}
+
+size_t KVMemoryManager::used_bytes() const {
+    size_t used = 0;
+    for (const auto& [session, entry] : entries_) {
+        if (entry.state == State::RESIDENT) used += entry.bytes;
+    }
+    return used;
+}
+
+void KVMemoryManager::enforce_budget(size_t used, const Qwen2Session* keep) {
+    stats_.peak_bytes = std::max(stats_.peak_bytes, used);
+    if (budget_bytes_ == 0) return;
+    for (auto it = lru_.begin(); it != lru_.end() && used > budget_bytes_; ++it) {
+        auto& entry = entries_.at(*it);
+        if (*it == keep || entry.busy || entry.state != State::RESIDENT || entry.bytes == 0) continue;
+        used -= entry.bytes;
+        evict(*it, entry);
+    }
+}
+
+void KVMemoryManager::evict(Qwen2Session* session, Entry& entry) {
+    auto& kv = session->kv_cache();
+    if (policy_ == KVEvictionPolicy::SPILL && kv.length() > 0) {
+        entry.spill_path = create_spill_file(spill_dir_, this, next_spill_id_++);
+        std::ofstream out(entry.spill_path, std::ios::binary | std::ios::trunc);
+        bool written = false;
+        try {
+            kv.save(out);
+            out.close(); // 缓冲区中剩余的数据在这里写出，同样可能失败
+            written = !out.fail();
+        } catch (const std::exception&) {
+        }
+        if (written) {
+            stats_.spilled_bytes += kv.bytes_for(kv.length());
+            entry.state = State::SPILLED;
+        } else {
+            // 写入失败（磁盘已满等）：删掉不完整的文件，退化为丢弃，下次使用时重新预填充
+            out.close();
+            std::remove(entry.spill_path.c_str());
+            entry.spill_path.clear();
+            entry.state = State::DROPPED;
+        }
+    } else {
+        entry.state = State::DROPPED;
+    }
+    kv.release();
+    entry.bytes = 0;
+    stats_.evictions++;
+}
+
+void KVMemoryManager::restore(Qwen2Session* session, Entry& entry) {
+    if (entry.state == State::SPILLED) {
+        std::ifstream in(entry.spill_path, std::ios::binary);
+        CHECK_ARGUMENT(in.is_open(), "KVMemoryManager: cannot open spill file " + entry.spill_path);
+        session->kv_cache().load(in, session->length());
+        in.close();
+        std::remove(entry.spill_path.c_str());
+        entry.spill_path.clear();
+    }
+    entry.state = State::RESIDENT;
+}
+
+} // namespace llaisys::models
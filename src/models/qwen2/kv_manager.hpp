@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace llaisys::models {
+
+class Qwen2Session;
+
+enum class KVEvictionPolicy {
+    DROP,  // 丢弃 KV，下次使用时按 token 历史重新预填充
+    SPILL, // 把 KV 写入本地文件，下次使用时读回
+};
+
+struct KVMemoryStats {
+    size_t budget_bytes = 0;   // 0 为不限制
+    size_t used_bytes = 0;     // 驻留会话的 KV 占用
+    size_t peak_bytes = 0;
+    size_t sessions = 0;
+    size_t resident_sessions = 0;
+    size_t hits = 0;           // 使用会话时其 KV 仍在内存中
+    size_t misses = 0;         // 使用会话时其 KV 已被驱逐，需要恢复
+    size_t evictions = 0;
+    size_t spilled_bytes = 0;  // 累计写入文件的字节数
+    size_t reprefill_tokens = 0; // 因丢弃而重新预填充的 token 数
+};
+
+// 同一模型所有会话的 KV 内存预算。每个会话按其 KV-Cache 的实际占用记账；
+// 某个会话即将前向时，若预计占用超出预算，按 LRU 顺序驱逐空闲会话（正在前向的会话不会被驱逐）。
+// 刚结束前向的会话保留在内存中，单个会话本身超出预算时仍然允许运行。
+class KVMemoryManager {
+public:
+    KVMemoryManager() = default;
+    ~KVMemoryManager();
+
+    // budget_bytes 为 0 时不限制；SPILL 策略的文件写在 spill_dir 下
+    void configure(size_t budget_bytes, KVEvictionPolicy policy, const std::string& spill_dir);
+    KVMemoryStats stats();
+
+    void attach(Qwen2Session& session);
+    void detach(Qwen2Session& session);
+
+    // 会话即将把 KV 增长到 target_len 个 token：必要时恢复其 KV，并驱逐其他空闲会话腾出预算。
+    // 返回 true 表示 KV 已被丢弃，调用方需要按 token 历史重新预填充
+    bool acquire(Qwen2Session& session, size_t target_len);
+    // 前向结束：按实际占用重新记账
+    void release(Qwen2Session& session);
+    // 清空会话的 KV（丢弃已换出的文件）
+    void reset(Qwen2Session& session);
+
+private:
+    enum class State { RESIDENT, DROPPED, SPILLED };
+    struct Entry {
+        State state = State::RESIDENT;
+        bool busy = false;
+        size_t bytes = 0;
+        std::string spill_path;
+        std::list<Qwen2Session*>::iterator lru;
+    };
+
+    std::mutex mutex_;
+    size_t budget_bytes_ = 0;
+    KVEvictionPolicy policy_ = KVEvictionPolicy::DROP;
+    std::string spill_dir_ = ".";
+    size_t next_spill_id_ = 0;
+    std::map<Qwen2Session*, Entry> entries_;
+    std::list<Qwen2Session*> lru_; // 表头为最久未使用
+    KVMemoryStats stats_;
+
+    size_t used_bytes() const;
+    // 按 LRU 驱逐空闲会话直到不超出预算；keep 不会被驱逐
+    void enforce_budget(size_t used, const Qwen2Session* keep = nullptr);
+    void evict(Qwen2Session* session, Entry& entry);
+    void restore(Qwen2Session* session, Entry& entry);
+};
+
+} // namespace llaisys::models
@@ -0,0 +1,159 @@
+#include "layer_streamer.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace llaisys::models {
+
+LayerStreamer::LayerStreamer(Qwen2Model& model, const LayerStreamOptions& options)
+    : options_(options), page_size_(4096) {
+    const auto& cfg = model.config();
+    CHECK_ARGUMENT(options.lookahead > 0, "LayerStreamer: lookahead must be positive");
+#if !defined(_WIN32)
+    page_size_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+
+    layers_.resize(cfg.nlayer);
+    state_.assign(cfg.nlayer, State::IDLE);
+    for (size_t l = 0; l < cfg.nlayer; ++l) {
+        std::vector<Range> ranges;
+        for (auto* w : {&model.attn_norm_w(l), &model.q_proj_w(l), &model.q_proj_b(l), &model.k_proj_w(l),
+                        &model.k_proj_b(l), &model.v_proj_w(l), &model.v_proj_b(l), &model.o_proj_w(l),
+                        &model.mlp_norm_w(l), &model.gate_proj_w(l), &model.up_proj_w(l), &model.down_proj_w(l)}) {
+            const tensor_t& t = *w;
+            if (t->deviceType() != LLAISYS_DEVICE_CPU || !t->isExternal()) continue;
+            ranges.push_back(Range{t->data(), t->numel() * t->elementSize()});
+            pinned_.push_back(t);
+        }
+        // 按地址合并相邻的张量（.llaisys 文件中同一层的权重是连续的）
+        std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+        for (const auto& r : ranges) {
+            auto& merged = layers_[l];
+            if (!merged.empty() && r.begin <= merged.back().begin + merged.back().size + page_size_) {
+                auto end = std::max(merged.back().begin + merged.back().size, r.begin + r.size);
+                merged.back().size = static_cast<size_t>(end - merged.back().begin);
+            } else {
+                merged.push_back(r);
+            }
+        }
+    }
+    worker_ = std::thread([this] { run(); });
+}
+
+LayerStreamer::~LayerStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    worker_.join();
+}
+
+void LayerStreamer::before_layer(size_t layer) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 解码时最后一层之后紧接着下一步的第 0 层，窗口循环
+    for (size_t k = 1; k <= options_.lookahead && k < layers_.size(); ++k) {
+        size_t next = (layer + k) % layers_.size();
+        if (state_[next] == State::IDLE) {
+            state_[next] = State::QUEUED;
+            queue_.push_back(next);
+        }
+    }
+    if (state_[layer] == State::QUEUED) {
+        // 当前层插到队首，由后台线程读入
+        queue_.erase(std::find(queue_.begin(), queue_.end(), layer));
+        queue_.push_front(layer);
+    }
+    work_cv_.notify_one();
+
+    if (state_[layer] == State::QUEUED || state_[layer] == State::LOADING) {
+        auto start = std::chrono::steady_clock::now();
+        ready_cv_.wait(lock, [&] { return state_[layer] == State::READY; });
+        stats_.stalls++;
+        stats_.stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    // IDLE（如第一次前向）时由前向自己缺页读入
+    state_[layer] = State::READY;
+}
+
+void LayerStreamer::after_layer(size_t layer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 层数不多于预取窗口时所有层都常驻
+        if (layers_.size() <= options_.lookahead + 1) return;
+        state_[layer] = State::IDLE;
+        stats_.released++;
+    }
+    release(layer);
+}
+
+LayerStreamStats LayerStreamer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void LayerStreamer::run() {
+    for (;;) {
+        size_t layer;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            layer = queue_.front();
+            queue_.pop_front();
+            state_[layer] = State::LOADING;
+        }
+        prefetch(layer);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            state_[layer] = State::READY;
+            stats_.prefetched++;
+        }
+        ready_cv_.notify_all();
+    }
+}
+
+void LayerStreamer::prefetch(size_t layer) const {
+    for (const auto& r : layers_[layer]) {
+        auto addr = reinterpret_cast<uintptr_t>(r.begin);
+        auto begin = addr / page_size_ * page_size_;
+#if !defined(_WIN32)
+        madvise(reinterpret_cast<void*>(begin), addr + r.size - begin, MADV_WILLNEED);
+#endif
+        // WILLNEED 只发起异步读，逐页访问确保前向开始时页面已经映射
+        volatile unsigned char sink = 0;
+        for (uintptr_t p = begin < addr ? begin + page_size_ : begin; p < addr + r.size; p += page_size_) {
+            sink = sink + *reinterpret_cast<const unsigned char*>(p);
+        }
+        sink = sink + static_cast<unsigned char>(*r.begin);
+        (void)sink;
+    }
+}
+
+void LayerStreamer::release([[maybe_unused]] size_t layer) const {
+#if !defined(_WIN32)
+    for (const auto& r : layers_[layer]) {
+        // 只释放完全属于本层的页，边界页可能与相邻层共享
+        auto addr = reinterpret_cast<uintptr_t>(r.begin);
+        auto begin = (addr + page_size_ - 1) / page_size_ * page_size_;
+        auto end = (addr + r.size) / page_size_ * page_size_;
+        if (end <= begin) continue;
+        if (options_.drop_finished) {
+            // 映射是私有且只读使用的，丢弃后再访问会从文件重新读入
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+        } else {
+#if defined(MADV_COLD)
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_COLD);
+#endif
+        }
+    }
+#endif
+}
+
+} // namespace llaisys::models
@@ -0,0 +1,67 @@
+#pragma once
+#include "qwen2_model.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llaisys::models {
+
+struct LayerStreamOptions {
+    size_t lookahead = 2;       // 提前预取的层数
+    bool drop_finished = false; // 算完的层立即丢弃页面；否则只标记为优先回收，内存紧张时才被换出
+};
+
+struct LayerStreamStats {
+    size_t prefetched = 0; // 后台预取的层数
+    size_t released = 0;   // 释放页面的层数
+    size_t stalls = 0;     // 前向等待预取完成的次数
+    double stall_ms = 0;
+};
+
+// 逐层流式加载映射权重：前向进入第 l 层时，后台线程对之后 lookahead 层的权重页
+// madvise(WILLNEED) 并逐页读入；第 l 层算完后释放其页面。只处理以文件映射为存储的权重
+// （load_safetensors / load_llaisys 在 CPU 上直接映射的张量），embedding、final norm 与 lm_head 常驻。
+// 加载时应关闭预读与预取，否则整个文件仍会被读入内存。
+// 构造时记录当前权重的地址并持有这些张量；重新加载或折叠权重时模型会丢弃它，之后需要重新创建
+class LayerStreamer : public LayerObserver {
+public:
+    LayerStreamer(Qwen2Model& model, const LayerStreamOptions& options);
+    ~LayerStreamer() override;
+
+    LayerStreamer(const LayerStreamer&) = delete;
+    LayerStreamer& operator=(const LayerStreamer&) = delete;
+
+    void before_layer(size_t layer) override;
+    void after_layer(size_t layer) override;
+
+    LayerStreamStats stats() const;
+
+private:
+    struct Range {
+        std::byte* begin;
+        size_t size;
+    };
+    enum class State { IDLE, QUEUED, LOADING, READY };
+
+    LayerStreamOptions options_;
+    size_t page_size_;
+    std::vector<std::vector<Range>> layers_; // 每层映射权重覆盖的地址范围（已合并相邻张量）
+    std::vector<tensor_t> pinned_;           // 保持映射存活
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable ready_cv_;
+    std::vector<State> state_;
+    std::deque<size_t> queue_;
+    LayerStreamStats stats_;
+    bool stop_ = false;
+    std::thread worker_;
+
+    void run();
+    void prefetch(size_t layer) const;
+    void release(size_t layer) const;
+};
+
+} // namespace llaisys::models
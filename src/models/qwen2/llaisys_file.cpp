@@ -0,0 +1,189 @@
+#include "llaisys_file.hpp"
+#include "../../utils.hpp"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace llaisys::models {
+
+namespace {
+
+size_t align_up(size_t n) {
+    return (n + LLAISYS_FILE_ALIGNMENT - 1) / LLAISYS_FILE_ALIGNMENT * LLAISYS_FILE_ALIGNMENT;
+}
+
+void check_header(const LlaisysFileHeader& h, const std::string& path) {
+    CHECK_ARGUMENT(std::memcmp(h.magic, LLAISYS_FILE_MAGIC, sizeof(h.magic)) == 0, "llaisys file: bad magic in " + path);
+    CHECK_ARGUMENT(h.version == LLAISYS_FILE_VERSION,
+                   "llaisys file: unsupported version " + std::to_string(h.version) + " in " + path);
+}
+
+Qwen2Config config_of(const LlaisysFileHeader& h) {
+    Qwen2Config cfg;
+    cfg.nlayer = h.nlayer;
+    cfg.hs = h.hs;
+    cfg.nh = h.nh;
+    cfg.nkvh = h.nkvh;
+    cfg.dh = h.dh;
+    cfg.di = h.di;
+    cfg.maxseq = h.maxseq;
+    cfg.voc = h.voc;
+    cfg.epsilon = h.epsilon;
+    cfg.theta = h.theta;
+    cfg.eos_token_id = h.eos_token_id;
+    cfg.dtype = static_cast<llaisysDataType_t>(h.dtype);
+    cfg.device_type = LLAISYS_DEVICE_CPU;
+    cfg.device_id = 0;
+    return cfg;
+}
+
+} // namespace
+
+void save_llaisys(Qwen2Model& model, const std::string& path) {
+    const auto& cfg = model.config();
+    auto slots = weight_slots(model);
+
+    // 按层顺序排列，同一层的权重在文件中相邻
+    std::vector<std::pair<std::string, tensor_t>> tensors;
+    tensors.emplace_back("model.embed_tokens.weight", model.embed_tokens());
+    for (size_t i = 0; i < cfg.nlayer; ++i) {
+        std::string prefix = "model.layers." + std::to_string(i) + ".";
+        for (auto it = slots.lower_bound(prefix); it != slots.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+            tensors.emplace_back(it->first, *it->second);
+        }
+    }
+    tensors.emplace_back("model.norm.weight", model.final_norm_w());
+    if (model.lm_head()->data() != model.embed_tokens()->data()) tensors.emplace_back("lm_head.weight", model.lm_head());
+
+    LlaisysFileHeader header{};
+    std::memcpy(header.magic, LLAISYS_FILE_MAGIC, sizeof(header.magic));
+    header.version = LLAISYS_FILE_VERSION;
+    header.ntensor = static_cast<uint32_t>(tensors.size());
+    header.dtype = static_cast<uint32_t>(cfg.dtype);
+    header.nlayer = cfg.nlayer;
+    header.hs = cfg.hs;
+    header.nh = cfg.nh;
+    header.nkvh = cfg.nkvh;
+    header.dh = cfg.dh;
+    header.di = cfg.di;
+    header.maxseq = cfg.maxseq;
+    header.voc = cfg.voc;
+    header.epsilon = cfg.epsilon;
+    header.theta = cfg.theta;
+    header.eos_token_id = cfg.eos_token_id;
+
+    std::vector<LlaisysTensorRecord> records(tensors.size());
+    size_t offset = align_up(sizeof(header) + records.size() * sizeof(LlaisysTensorRecord));
+    for (size_t i = 0; i < tensors.size(); ++i) {
+        const auto& [name, w] = tensors[i];
+        CHECK_ARGUMENT(w->deviceType() == LLAISYS_DEVICE_CPU, "save_llaisys: weights must be on CPU");
+        CHECK_ARGUMENT(w->isContiguous(), "save_llaisys: weight " + name + " is not contiguous");
+        CHECK_ARGUMENT(name.size() < LLAISYS_FILE_NAME_LEN && w->ndim() <= LLAISYS_FILE_MAX_NDIM,
+                       "save_llaisys: cannot store " + name);
+        auto& r = records[i];
+        r = LlaisysTensorRecord{};
+        std::memcpy(r.name, name.data(), name.size());
+        r.dtype = static_cast<uint32_t>(w->dtype());
+        r.ndim = static_cast<uint32_t>(w->ndim());
+        for (size_t d = 0; d < w->ndim(); ++d) r.shape[d] = w->shape()[d];
+        r.offset = offset;
+        r.nbytes = w->numel() * w->elementSize();
+        offset = align_up(offset + r.nbytes);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    CHECK_ARGUMENT(out.is_open(), "save_llaisys: cannot open " + path);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(LlaisysTensorRecord));
+    const char zeros[LLAISYS_FILE_ALIGNMENT] = {};
+    for (size_t i = 0; i < tensors.size(); ++i) {
+        out.write(zeros, records[i].offset - static_cast<size_t>(out.tellp()));
+        out.write(reinterpret_cast<const char*>(tensors[i].second->data()), records[i].nbytes);
+    }
+    CHECK_ARGUMENT(out.good(), "save_llaisys: write failed for " + path);
+}
+
+Qwen2Config read_llaisys_config(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    CHECK_ARGUMENT(in.is_open(), "llaisys file: cannot open " + path);
+    LlaisysFileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    CHECK_ARGUMENT(in.good(), "llaisys file: truncated header in " + path);
+    check_header(header, path);
+    return config_of(header);
+}
+
+WeightLoadStats load_llaisys(Qwen2Model& model, const std::string& path, const LoadOptions& options) {
+    const auto& cfg = model.config();
+    CHECK_ARGUMENT(!model.norm_weights_folded(), "load_llaisys: weights have been folded, load into a new model");
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    WeightLoadStats stats;
+
+    auto file = std::make_shared<MappedFile>(path, options.readahead);
+    CHECK_ARGUMENT(file->size() >= sizeof(LlaisysFileHeader), "llaisys file: truncated header in " + path);
+    LlaisysFileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    check_header(header, path);
+    CHECK_ARGUMENT(sizeof(header) + size_t(header.ntensor) * sizeof(LlaisysTensorRecord) <= file->size(),
+                   "llaisys file: truncated tensor table in " + path);
+
+    auto fcfg = config_of(header);
+    CHECK_ARGUMENT(fcfg.dtype == cfg.dtype && fcfg.nlayer == cfg.nlayer && fcfg.hs == cfg.hs && fcfg.nh == cfg.nh
+                       && fcfg.nkvh == cfg.nkvh && fcfg.dh == cfg.dh && fcfg.di == cfg.di && fcfg.voc == cfg.voc,
+                   "load_llaisys: model config does not match " + path);
+    stats.files = 1;
+    stats.read_ms = elapsed_ms(start);
+
+    auto place_start = std::chrono::steady_clock::now();
+    core::context().setDevice(cfg.device_type, cfg.device_id);
+    auto& runtime = core::context().runtime();
+    core::storage_t storage;
+    if (cfg.device_type == LLAISYS_DEVICE_CPU) storage = runtime.wrapExternalStorage(file->data(), file->size(), file);
+
+    auto slots = weight_slots(model);
+    const auto* records = reinterpret_cast<const LlaisysTensorRecord*>(file->data() + sizeof(header));
+    for (uint32_t i = 0; i < header.ntensor; ++i) {
+        LlaisysTensorRecord r;
+        std::memcpy(&r, records + i, sizeof(r));
+        std::string name(r.name, strnlen(r.name, LLAISYS_FILE_NAME_LEN));
+        auto it = slots.find(name);
+        if (it == slots.end()) continue;
+        tensor_t& w = *it->second;
+
+        CHECK_ARGUMENT(r.ndim <= LLAISYS_FILE_MAX_NDIM, "load_llaisys: bad ndim for " + name);
+        std::vector<size_t> shape(r.shape, r.shape + r.ndim);
+        CHECK_ARGUMENT(r.dtype == static_cast<uint32_t>(cfg.dtype) && shape == w->shape(),
+                       "load_llaisys: dtype or shape mismatch for " + name);
+        CHECK_ARGUMENT(r.nbytes == w->numel() * w->elementSize() && r.offset % LLAISYS_FILE_ALIGNMENT == 0
+                           && r.offset + r.nbytes <= file->size(),
+                       "load_llaisys: bad data range for " + name);
+
+        if (storage) {
+            w = Tensor::createOnStorage(storage, r.offset, shape, cfg.dtype);
+            stats.mapped++;
+            stats.mapped_bytes += r.nbytes;
+        } else {
+            w->load(file->data() + r.offset);
+            stats.converted++;
+            stats.copied_bytes += r.nbytes;
+        }
+        slots.erase(it);
+    }
+
+    // tied embeddings
+    if (slots.count("lm_head.weight") && !slots.count("model.embed_tokens.weight")) {
+        model.lm_head() = model.embed_tokens();
+        slots.erase("lm_head.weight");
+    }
+    CHECK_ARGUMENT(slots.empty(), "load_llaisys: missing weight " + (slots.empty() ? "" : slots.begin()->first));
+
+    model.weights_replaced();
+    stats.place_ms = elapsed_ms(place_start);
+    stats.total_ms = elapsed_ms(start);
+    return stats;
+}
+
+} // namespace llaisys::models
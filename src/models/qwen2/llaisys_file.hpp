@@ -0,0 +1,52 @@
+#pragma once
+#include "safetensors.hpp"
+#include <cstdint>
+#include <string>
+
+namespace llaisys::models {
+
+// .llaisys 模型文件：离线转换好的权重，加载时直接映射，不做任何变换。
+// 布局（小端）：LlaisysFileHeader | ntensor 个 LlaisysTensorRecord | 张量数据。
+// 张量数据的偏移都按 LLAISYS_FILE_ALIGNMENT 对齐，dtype 即模型 dtype；
+// tied embeddings 只存一份 embed_tokens，不存 lm_head
+constexpr char LLAISYS_FILE_MAGIC[8] = {'L', 'L', 'A', 'I', 'S', 'Y', 'S', '\0'};
+constexpr uint32_t LLAISYS_FILE_VERSION = 1;
+constexpr size_t LLAISYS_FILE_ALIGNMENT = 64;
+constexpr size_t LLAISYS_FILE_MAX_NDIM = 4;
+constexpr size_t LLAISYS_FILE_NAME_LEN = 96;
+
+struct LlaisysFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t ntensor;
+    // 模型配置
+    uint32_t dtype;
+    uint32_t reserved;
+    uint64_t nlayer, hs, nh, nkvh, dh, di, maxseq, voc;
+    float epsilon, theta;
+    int64_t eos_token_id;
+};
+static_assert(sizeof(LlaisysFileHeader) == 104, "LlaisysFileHeader layout changed");
+
+struct LlaisysTensorRecord {
+    char name[LLAISYS_FILE_NAME_LEN]; // HuggingFace 权重名，以 '\0' 结尾
+    uint32_t dtype;
+    uint32_t ndim;
+    uint64_t shape[LLAISYS_FILE_MAX_NDIM];
+    uint64_t offset; // 相对于文件开头
+    uint64_t nbytes;
+};
+static_assert(sizeof(LlaisysTensorRecord) == 152, "LlaisysTensorRecord layout changed");
+
+// 把模型当前的权重（须在 CPU 上）写成 .llaisys 文件
+void save_llaisys(Qwen2Model& model, const std::string& path);
+
+// 读取文件中嵌入的模型配置，设备为 CPU
+Qwen2Config read_llaisys_config(const std::string& path);
+
+// 加载 .llaisys 文件：CPU 上所有权重直接以映射为存储，其他设备拷贝。
+// 文件中的配置必须与模型一致，否则抛出异常。options 中只有 readahead 起作用
+// （逐层流式执行时关闭，见 LayerStreamer）
+WeightLoadStats load_llaisys(Qwen2Model& model, const std::string& path, const LoadOptions& options = LoadOptions{});
+
+} // namespace llaisys::models
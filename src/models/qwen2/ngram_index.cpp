@@ -0,0 +1,42 @@
+#include "ngram_index.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+
+namespace llaisys::models {
+
+static constexpr uint64_t BASE = 1000003;
+
+NgramIndex::NgramIndex(size_t n) : _n(n), _pow(1) {
+    CHECK_ARGUMENT(n > 0, "NgramIndex: n must be positive");
+    for (size_t i = 1; i < n; ++i) _pow *= BASE;
+}
+
+void NgramIndex::append(const int64_t* tokens, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = _tokens.size();
+        // 上一个末尾窗口不再是末尾，加入索引
+        if (len >= _n) {
+            _last_end[_hash] = len;
+            _hash -= static_cast<uint64_t>(_tokens[len - _n]) * _pow;
+        }
+        _hash = _hash * BASE + static_cast<uint64_t>(tokens[i]);
+        _tokens.push_back(tokens[i]);
+    }
+}
+
+size_t NgramIndex::propose(int64_t* out, size_t max_tokens) const {
+    size_t len = _tokens.size();
+    if (len < _n || max_tokens == 0) return 0;
+    auto it = _last_end.find(_hash);
+    if (it == _last_end.end()) return 0;
+
+    // 排除哈希碰撞
+    size_t end = it->second;
+    if (!std::equal(_tokens.begin() + (end - _n), _tokens.begin() + end, _tokens.end() - _n)) return 0;
+
+    size_t count = std::min(max_tokens, len - end);
+    std::copy_n(_tokens.begin() + end, count, out);
+    return count;
+}
+
+} // namespace llaisys::models
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::models {
+
+// prompt lookup 投机解码用的 n-gram 索引：对 prompt 与已生成 token 中每个长度为 n 的
+// 窗口做滚动哈希，记录其最近一次出现的位置。用历史末尾的 n-gram 查到更早的一次出现，
+// 其后的 token 即为草稿，无需草稿模型。
+class NgramIndex {
+public:
+    explicit NgramIndex(size_t n);
+
+    // 追加 token 并为新形成的窗口建立索引
+    void append(const int64_t* tokens, size_t count);
+    void append(int64_t token) { append(&token, 1); }
+
+    // 查找末尾 n-gram 在更早位置的最近一次出现，把其后至多 max_tokens 个 token 写入 out，
+    // 返回个数（没有匹配时为 0）
+    size_t propose(int64_t* out, size_t max_tokens) const;
+
+    size_t size() const { return _tokens.size(); }
+
+private:
+    size_t _n;
+    uint64_t _pow;  // BASE^(n-1)，滚动时移出最旧的 token
+    uint64_t _hash = 0; // 末尾 n 个 token 的哈希
+    std::vector<int64_t> _tokens;
+    // 窗口哈希 -> 该窗口最近一次出现的结束位置（不含）；末尾窗口在下一个 token 到来时才加入
+    std::unordered_map<uint64_t, size_t> _last_end;
+};
+
+} // namespace llaisys::models
@@ -1,11 +1,21 @@
 #include "qwen2_model.hpp"
 #include "../../utils.hpp"
+#include "../../ops/add/cpu/add_cpu.hpp"
+#include "../../ops/embedding/cpu/embedding_cpu.hpp"
+#include "../../ops/linear/cpu/linear_cpu.hpp"
+#include "../../ops/rms_norm/cpu/rms_norm_cpu.hpp"
+#include "../../ops/rope/cpu/rope_cpu.hpp"
+#include "../../ops/self_attention/cpu/self_attention_cpu.hpp"
+#include "../../ops/swiglu/cpu/swiglu_cpu.hpp"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 namespace llaisys::models {
 
 Qwen2Model::Qwen2Model(const Qwen2Config& cfg) 
-    : config_(cfg), current_pos_(0) {
+    : config_(cfg) {
+    if (config_.act_dtype == LLAISYS_DTYPE_INVALID) config_.act_dtype = cfg.dtype;
     
     // allocate weight tensors
     embed_tokens_ = Tensor::create({cfg.voc, cfg.hs}, cfg.dtype, cfg.device_type, cfg.device_id);
@@ -42,141 +52,442 @@ Qwen2Model::Qwen2Model(const Qwen2Config& cfg)
     }
     
     // init kv cache
-    kv_cache_ = std::make_unique<ModelKVCache>(
-        cfg.nlayer, cfg.maxseq, cfg.nkvh, cfg.dh, cfg.dtype, cfg.device_type, cfg.device_id
-    );
+    kv_cache_ = create_kv_cache();
+    
+    plan_workspace();
 }
 
-tensor_t Qwen2Model::create_position_ids(size_t len) {
-    auto pos = Tensor::create({len}, LLAISYS_DTYPE_I64, config_.device_type, config_.device_id);
-    
-    if (config_.device_type == LLAISYS_DEVICE_CPU) {
-        int64_t* p = reinterpret_cast<int64_t*>(pos->data());
-        for (size_t i = 0; i < len; ++i) p[i] = current_pos_ + i;
+std::unique_ptr<ModelKVCache> Qwen2Model::create_kv_cache() const {
+    const auto& c = config_;
+    return std::make_unique<ModelKVCache>(c.nlayer, c.maxseq, c.nkvh, c.dh, c.act_dtype, c.device_type, c.device_id);
+}
+
+void Qwen2Model::plan_workspace() {
+    const auto& c = config_;
+    size_t rows = c.max_chunk;
+    size_t esize = utils::dsize(c.act_dtype);
+    size_t hs_bytes = rows * c.hs * esize;
+    size_t q_bytes = rows * c.nh * c.dh * esize;
+    size_t kv_bytes = rows * c.nkvh * c.dh * esize;
+    size_t di_bytes = rows * c.di * esize;
+    
+    // 一层内的算子步：
+    //  0 normed = rms_norm(residual)      6 h1 = residual + attn_out
+    //  1 q/k/v = linear(normed)           7 mlp_in = rms_norm(h1)
+    //    （q/k/v 共用一个缓冲区，折叠权重后由一次融合投影写出）
+    //  2 qr/kr = rope(q/k)                8 gate/up = linear(mlp_in)
+    //  3 写入 kv cache (kr, v)            9 act = swiglu(gate, up)
+    //  4 attn = self_attention(qr)       10 mlp_out = linear(act)
+    //  5 attn_out = linear(attn)         11 residual = h1 + mlp_out
+    // 所有层之后：
+    // 12 last = 各序列最后一行的 residual，topk = lm_head_topk(last)
+    // residual / ids / pos 贯穿所有层，其余缓冲区按区间复用
+    constexpr size_t LAST = 12;
+    slots_.ids = workspace_.declare(rows * sizeof(int64_t), 0, LAST);
+    slots_.pos = workspace_.declare(rows * sizeof(int64_t), 0, LAST);
+    slots_.residual = workspace_.declare(hs_bytes, 0, LAST);
+    slots_.normed = workspace_.declare(hs_bytes, 0, 1);
+    slots_.qkv = workspace_.declare(q_bytes + 2 * kv_bytes, 1, 3);
+    slots_.qr = workspace_.declare(q_bytes, 2, 4);
+    slots_.kr = workspace_.declare(kv_bytes, 2, 3);
+    slots_.attn = workspace_.declare(q_bytes, 4, 5);
+    slots_.attn_out = workspace_.declare(hs_bytes, 5, 6);
+    slots_.h1 = workspace_.declare(hs_bytes, 6, LAST);
+    slots_.mlp_in = workspace_.declare(hs_bytes, 7, 8);
+    slots_.gate = workspace_.declare(di_bytes, 8, 9);
+    slots_.up = workspace_.declare(di_bytes, 8, 9);
+    slots_.act = workspace_.declare(di_bytes, 9, 10);
+    slots_.mlp_out = workspace_.declare(hs_bytes, 10, LAST);
+    slots_.last = workspace_.declare(hs_bytes, LAST, LAST);
+    slots_.topk_idx = workspace_.declare(rows * sizeof(int64_t), LAST, LAST);
+    slots_.topk_val = workspace_.declare(rows * esize, LAST, LAST);
+    workspace_.plan(c.device_type, c.device_id);
+    heads_.resize(rows + 1);
+}
+
+Qwen2Model::Activations& Qwen2Model::bind_activations(size_t seq) {
+    ASSERT(seq > 0 && seq <= config_.max_chunk, "Qwen2Model: chunk exceeds workspace capacity");
+    if (acts_.seq == seq) return acts_;
+    
+    const auto& c = config_;
+    auto& ws = workspace_;
+    auto dt = c.act_dtype;
+    acts_.seq = seq;
+    acts_.ids = ws.tensor(slots_.ids, {seq}, LLAISYS_DTYPE_I64);
+    acts_.pos = ws.tensor(slots_.pos, {seq}, LLAISYS_DTYPE_I64);
+    acts_.residual = ws.tensor(slots_.residual, {seq, c.hs}, dt);
+    acts_.normed = ws.tensor(slots_.normed, {seq, c.hs}, dt);
+    if (norm_folded_) {
+        // 融合投影按 token 输出 [q | k | v]，q/k/v 是按头切出的跨步视图
+        size_t nhead = c.nh + 2 * c.nkvh;
+        acts_.qkv = ws.tensor(slots_.qkv, {seq, nhead * c.dh}, dt);
+        auto heads = ws.tensor(slots_.qkv, {seq, nhead, c.dh}, dt);
+        acts_.q = heads->slice(1, 0, c.nh);
+        acts_.k = heads->slice(1, c.nh, c.nh + c.nkvh);
+        acts_.v = heads->slice(1, c.nh + c.nkvh, nhead);
     } else {
-        std::vector<int64_t> tmp(len);
-        for (size_t i = 0; i < len; ++i) tmp[i] = current_pos_ + i;
-        pos->load(tmp.data());
+        // 三个投影各自输出，在缓冲区中依次排列
+        size_t qn = seq * c.nh * c.dh, kvn = seq * c.nkvh * c.dh;
+        auto flat = ws.tensor(slots_.qkv, {qn + 2 * kvn}, dt);
+        acts_.qkv = nullptr;
+        acts_.q = flat->slice(0, 0, qn)->view({seq, c.nh, c.dh});
+        acts_.k = flat->slice(0, qn, qn + kvn)->view({seq, c.nkvh, c.dh});
+        acts_.v = flat->slice(0, qn + kvn, qn + 2 * kvn)->view({seq, c.nkvh, c.dh});
     }
-    return pos;
+    acts_.qr = ws.tensor(slots_.qr, {seq, c.nh, c.dh}, dt);
+    acts_.kr = ws.tensor(slots_.kr, {seq, c.nkvh, c.dh}, dt);
+    acts_.attn = ws.tensor(slots_.attn, {seq, c.nh, c.dh}, dt);
+    acts_.attn_2d = ws.tensor(slots_.attn, {seq, c.nh * c.dh}, dt);
+    acts_.attn_out = ws.tensor(slots_.attn_out, {seq, c.hs}, dt);
+    acts_.h1 = ws.tensor(slots_.h1, {seq, c.hs}, dt);
+    acts_.mlp_in = ws.tensor(slots_.mlp_in, {seq, c.hs}, dt);
+    acts_.gate = ws.tensor(slots_.gate, {seq, c.di}, dt);
+    acts_.up = ws.tensor(slots_.up, {seq, c.di}, dt);
+    acts_.act = ws.tensor(slots_.act, {seq, c.di}, dt);
+    acts_.mlp_out = ws.tensor(slots_.mlp_out, {seq, c.hs}, dt);
+    return acts_;
 }
 
-tensor_t Qwen2Model::transformer_layer(tensor_t hidden, size_t layer, tensor_t pos) {
-    size_t seq = hidden->shape()[0];
-    size_t hs = config_.hs;
-    size_t nh = config_.nh;
-    size_t nkvh = config_.nkvh;
+void Qwen2Model::transformer_layer(Activations& a, size_t layer, const std::vector<SeqStep>& steps) {
     size_t dh = config_.dh;
-    size_t di = config_.di;
     
     // attention
-    auto normed = Tensor::create({seq, hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::rms_norm(normed, hidden, attn_norm_w_[layer], config_.epsilon);
-    
-    auto q = Tensor::create({seq, nh * dh}, config_.dtype, config_.device_type, config_.device_id);
-    auto k = Tensor::create({seq, nkvh * dh}, config_.dtype, config_.device_type, config_.device_id);
-    auto v = Tensor::create({seq, nkvh * dh}, config_.dtype, config_.device_type, config_.device_id);
-    
-    ops::linear(q, normed, q_proj_w_[layer], q_proj_b_[layer]);
-    ops::linear(k, normed, k_proj_w_[layer], k_proj_b_[layer]);
-    ops::linear(v, normed, v_proj_w_[layer], v_proj_b_[layer]);
-    
-    q = q->view({seq, nh, dh});
-    k = k->view({seq, nkvh, dh});
-    v = v->view({seq, nkvh, dh});
+    if (norm_folded_) {
+        ops::rms_norm(a.normed, a.residual, nullptr, config_.epsilon);
+        ops::linear(a.qkv, a.normed, qkv_proj_w_[layer], qkv_proj_b_[layer]);
+    } else {
+        ops::rms_norm(a.normed, a.residual, attn_norm_w_[layer], config_.epsilon);
+        
+        ops::linear(a.q, a.normed, q_proj_w_[layer], q_proj_b_[layer]);
+        ops::linear(a.k, a.normed, k_proj_w_[layer], k_proj_b_[layer]);
+        ops::linear(a.v, a.normed, v_proj_w_[layer], v_proj_b_[layer]);
+    }
     
     // rope
-    auto qr = Tensor::create(q->shape(), config_.dtype, config_.device_type, config_.device_id);
-    auto kr = Tensor::create(k->shape(), config_.dtype, config_.device_type, config_.device_id);
-    ops::rope(qr, q, pos, config_.theta);
-    ops::rope(kr, k, pos, config_.theta);
+    ops::rope(a.qr, a.q, a.pos, config_.theta);
+    ops::rope(a.kr, a.k, a.pos, config_.theta);
     
-    // kv cache
-    auto& cache = kv_cache_->get_layer(layer);
-    auto fk = cache.update_k(kr);
-    auto fv = cache.update_v(v);
-    (void)cache.current_len;
-    
-    // attention
+    // kv cache 逐序列写入，注意力对所有序列一次计算
     float scale = 1.0f / std::sqrt((float)dh);
-    auto attn = Tensor::create({seq, nh, dh}, config_.dtype, config_.device_type, config_.device_id);
-    ops::self_attention(attn, qr, fk, fv, scale);
-    
-    attn = attn->view({seq, nh * dh});
-    auto attn_out = Tensor::create({seq, hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::linear(attn_out, attn, o_proj_w_[layer], nullptr);
+    auto& vl = varlen_;
+    vl.k_views.clear();
+    vl.v_views.clear();
+    vl.q_lens.clear();
+    size_t row = 0;
+    for (const auto& s : steps) {
+        size_t end = row + s.ntoken;
+        auto& cache = s.kv->get_layer(layer);
+        vl.k_views.push_back(cache.update_k(steps.size() == 1 ? a.kr : a.kr->slice(0, row, end)));
+        vl.v_views.push_back(cache.update_v(steps.size() == 1 ? a.v : a.v->slice(0, row, end)));
+        vl.q_lens.push_back(s.ntoken);
+        row = end;
+    }
+    ops::self_attention_varlen(a.attn, a.qr, vl.k_views, vl.v_views, vl.q_lens, scale);
+    ops::linear(a.attn_out, a.attn_2d, o_proj_w_[layer], nullptr);
     
     // residual
-    auto h1 = Tensor::create({seq, hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::add(h1, hidden, attn_out);
+    ops::add(a.h1, a.residual, a.attn_out);
     
     // mlp
-    auto mlp_in = Tensor::create({seq, hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::rms_norm(mlp_in, h1, mlp_norm_w_[layer], config_.epsilon);
+    ops::rms_norm(a.mlp_in, a.h1, norm_folded_ ? nullptr : mlp_norm_w_[layer], config_.epsilon);
+    ops::linear(a.gate, a.mlp_in, gate_proj_w_[layer], nullptr);
+    ops::linear(a.up, a.mlp_in, up_proj_w_[layer], nullptr);
+    ops::swiglu(a.act, a.gate, a.up);
+    ops::linear(a.mlp_out, a.act, down_proj_w_[layer], nullptr);
     
-    auto gate = Tensor::create({seq, di}, config_.dtype, config_.device_type, config_.device_id);
-    auto up = Tensor::create({seq, di}, config_.dtype, config_.device_type, config_.device_id);
-    ops::linear(gate, mlp_in, gate_proj_w_[layer], nullptr);
-    ops::linear(up, mlp_in, up_proj_w_[layer], nullptr);
-    
-    auto act = Tensor::create({seq, di}, config_.dtype, config_.device_type, config_.device_id);
-    ops::swiglu(act, gate, up);
-    
-    auto mlp_out = Tensor::create({seq, hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::linear(mlp_out, act, down_proj_w_[layer], nullptr);
-    
-    auto out = Tensor::create({seq, hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::add(out, h1, mlp_out);
-    
-    return out;
+    ops::add(a.residual, a.h1, a.mlp_out);
 }
 
-tensor_t Qwen2Model::forward(tensor_t input_ids) {
-    size_t seq = input_ids->numel();
-    
-    auto hidden = Tensor::create({seq, config_.hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::embedding(hidden, input_ids, embed_tokens_);
-    
-    auto pos = create_position_ids(seq);
-    
-    for (size_t l = 0; l < config_.nlayer; ++l) {
-        hidden = transformer_layer(hidden, l, pos);
+void Qwen2Model::capture_graph(Activations& a, StepGraph& g) {
+    // 与 transformer_layer 一一对应，但直接调用 CPU kernel
+    const auto c = config_;
+    const auto dt = c.act_dtype;
+    const auto wdt = c.dtype;
+    const size_t seq = a.seq;
+    const size_t qdim = c.nh * c.dh;
+    const size_t kvdim = c.nkvh * c.dh;
+    const size_t row_bytes = kvdim * utils::dsize(dt);
+    // q/k/v 每个 token 之间的距离（元素数），折叠权重后是融合投影的行宽
+    const size_t q_stride = a.q->strides()[0], k_stride = a.k->strides()[0];
+    const size_t v_row_bytes = a.v->strides()[0] * utils::dsize(dt);
+    const bool folded = norm_folded_;
+    auto* vl = &varlen_;
+    const float scale = 1.0f / std::sqrt((float)c.dh);
+    auto p = [](const tensor_t& t) { return t ? t->data() : nullptr; };
+    
+    std::byte *ids = p(a.ids), *pos = p(a.pos), *residual = p(a.residual), *h1 = p(a.h1), *normed = p(a.normed);
+    std::byte *qkv = p(a.qkv), *q = p(a.q), *k = p(a.k), *v = p(a.v), *qr = p(a.qr), *kr = p(a.kr);
+    std::byte *attn = p(a.attn), *attn_out = p(a.attn_out), *mlp_in = p(a.mlp_in);
+    std::byte *gate = p(a.gate), *up = p(a.up), *act = p(a.act), *mlp_out = p(a.mlp_out);
+    
+    std::byte* embed = p(embed_tokens_);
+    g.record([=](const std::vector<SeqStep>&) { ops::cpu::embedding(residual, ids, embed, dt, wdt, seq, c.hs); });
+    
+    for (size_t l = 0; l < c.nlayer; ++l) {
+        // 折叠后 mlp 前的 norm 只做归一化
+        std::byte *attn_norm = p(attn_norm_w_[l]), *mlp_norm = folded ? nullptr : p(mlp_norm_w_[l]);
+        std::byte *wq = p(q_proj_w_[l]), *bq = p(q_proj_b_[l]);
+        std::byte *wk = p(k_proj_w_[l]), *bk = p(k_proj_b_[l]);
+        std::byte *wv = p(v_proj_w_[l]), *bv = p(v_proj_b_[l]);
+        std::byte *wo = p(o_proj_w_[l]), *wg = p(gate_proj_w_[l]), *wu = p(up_proj_w_[l]), *wd = p(down_proj_w_[l]);
+        
+        if (auto* observer = layer_observer_.get()) {
+            g.record([=](const std::vector<SeqStep>&) { observer->before_layer(l); });
+        }
+        if (folded) {
+            std::byte *wqkv = p(qkv_proj_w_[l]), *bqkv = p(qkv_proj_b_[l]);
+            g.record([=](const std::vector<SeqStep>&) {
+                ops::cpu::rms_norm(normed, residual, nullptr, dt, wdt, seq, c.hs, c.epsilon);
+                ops::cpu::linear(qkv, normed, wqkv, bqkv, dt, wdt, seq, c.hs, qdim + 2 * kvdim);
+            });
+        } else {
+            g.record([=](const std::vector<SeqStep>&) {
+                ops::cpu::rms_norm(normed, residual, attn_norm, dt, wdt, seq, c.hs, c.epsilon);
+                ops::cpu::linear(q, normed, wq, bq, dt, wdt, seq, c.hs, qdim);
+                ops::cpu::linear(k, normed, wk, bk, dt, wdt, seq, c.hs, kvdim);
+                ops::cpu::linear(v, normed, wv, bv, dt, wdt, seq, c.hs, kvdim);
+            });
+        }
+        g.record([=](const std::vector<SeqStep>&) {
+            ops::cpu::rope(qr, q, pos, dt, seq, c.nh, c.dh, q_stride, c.theta);
+            ops::cpu::rope(kr, k, pos, dt, seq, c.nkvh, c.dh, k_stride, c.theta);
+        });
+        // 需要按步修补的只有各序列的 KV 基址、写入偏移和注意力覆盖的长度
+        g.record([=](const std::vector<SeqStep>& steps) {
+            size_t n = steps.size();
+            vl->k.resize(n);
+            vl->v.resize(n);
+            vl->q_start.resize(n + 1);
+            vl->kv_len.resize(n);
+            vl->q_start[0] = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const auto& s = steps[i];
+                auto& cache = s.kv->get_layer(l);
+                std::byte *kc = cache.k_cache->data(), *vc = cache.v_cache->data();
+                size_t row = vl->q_start[i];
+                std::memcpy(kc + s.past_len * row_bytes, kr + row * row_bytes, s.ntoken * row_bytes);
+                for (size_t r = 0; r < s.ntoken; ++r) {
+                    std::memcpy(vc + (s.past_len + r) * row_bytes, v + (row + r) * v_row_bytes, row_bytes);
+                }
+                vl->k[i] = kc;
+                vl->v[i] = vc;
+                vl->kv_len[i] = s.past_len + s.ntoken;
+                vl->q_start[i + 1] = row + s.ntoken;
+            }
+            ops::cpu::self_attention_varlen(attn, qr, vl->k.data(), vl->v.data(), vl->q_start.data(),
+                                            vl->kv_len.data(), dt, n, c.nh, c.nkvh, c.dh, c.dh, scale);
+        });
+        g.record([=](const std::vector<SeqStep>&) {
+            ops::cpu::linear(attn_out, attn, wo, nullptr, dt, wdt, seq, qdim, c.hs);
+            ops::cpu::add(h1, residual, attn_out, dt, seq * c.hs);
+            ops::cpu::rms_norm(mlp_in, h1, mlp_norm, dt, wdt, seq, c.hs, c.epsilon);
+            ops::cpu::linear(gate, mlp_in, wg, nullptr, dt, wdt, seq, c.hs, c.di);
+            ops::cpu::linear(up, mlp_in, wu, nullptr, dt, wdt, seq, c.hs, c.di);
+            ops::cpu::swiglu(act, gate, up, dt, seq * c.di);
+            ops::cpu::linear(mlp_out, act, wd, nullptr, dt, wdt, seq, c.di, c.hs);
+            ops::cpu::add(residual, h1, mlp_out, dt, seq * c.hs);
+        });
+        if (auto* observer = layer_observer_.get()) {
+            g.record([=](const std::vector<SeqStep>&) { observer->after_layer(l); });
+        }
     }
+}
+
+tensor_t Qwen2Model::forward(const int64_t* token_ids, std::vector<SeqStep>& steps) {
+    ASSERT(!steps.empty(), "Qwen2Model: no sequence to run");
+    size_t rows = 0;
+    for (auto& s : steps) {
+        s.past_len = s.kv->length();
+        ASSERT(s.ntoken > 0, "Qwen2Model: empty sequence step");
+        ASSERT(s.past_len + s.ntoken <= config_.maxseq, "Qwen2Model: sequence exceeds maxseq");
+        s.kv->reserve(s.past_len + s.ntoken);
+        rows += s.ntoken;
+    }
+    auto& a = bind_activations(rows);
+    a.ids->load(token_ids);
     
-    auto normed = Tensor::create({seq, config_.hs}, config_.dtype, config_.device_type, config_.device_id);
-    ops::rms_norm(normed, hidden, final_norm_w_, config_.epsilon);
+    if (config_.device_type == LLAISYS_DEVICE_CPU) {
+        int64_t* p = reinterpret_cast<int64_t*>(a.pos->data());
+        for (const auto& s : steps) {
+            for (size_t i = 0; i < s.ntoken; ++i) *p++ = s.past_len + i;
+        }
+    } else {
+        std::vector<int64_t> tmp;
+        for (const auto& s : steps) {
+            for (size_t i = 0; i < s.ntoken; ++i) tmp.push_back(s.past_len + i);
+        }
+        a.pos->load(tmp.data());
+    }
     
-    auto logits = Tensor::create({seq, config_.voc}, config_.dtype, config_.device_type, config_.device_id);
-    ops::linear(logits, normed, lm_head_, nullptr);
+    if (use_graphs_ && config_.device_type == LLAISYS_DEVICE_CPU) {
+        auto& graph = graphs_[{steps.size(), rows}];
+        if (graph.empty()) capture_graph(a, graph);
+        graph.replay(steps);
+        for (const auto& s : steps) s.kv->advance(s.ntoken);
+    } else {
+        ops::embedding(a.residual, a.ids, embed_tokens_);
+        for (size_t l = 0; l < config_.nlayer; ++l) {
+            if (layer_observer_) layer_observer_->before_layer(l);
+            transformer_layer(a, l, steps);
+            if (layer_observer_) layer_observer_->after_layer(l);
+        }
+    }
     
-    return logits;
+    return a.residual;
 }
 
 int64_t Qwen2Model::infer_one_step(const int64_t* tokens, size_t n) {
-    auto ids = Tensor::create({n}, LLAISYS_DTYPE_I64, config_.device_type, config_.device_id);
-    ids->load(tokens);
-    
-    auto logits = forward(ids);
-    
-    auto last = logits->slice(0, n - 1, n);
-    last = last->view({config_.voc});
-    
-    auto idx = Tensor::create({1}, LLAISYS_DTYPE_I64, LLAISYS_DEVICE_CPU, 0);
-    auto val = Tensor::create({1}, config_.dtype, LLAISYS_DEVICE_CPU, 0);
-    
-    ASSERT(last->deviceType() == LLAISYS_DEVICE_CPU, "only cpu inference supported");
+    int64_t next = infer(*kv_cache_, tokens, n);
+    history_.insert(history_.end(), tokens, tokens + n);
+    return next;
+}
+
+int64_t Qwen2Model::infer_reuse(const int64_t* tokens, size_t n, size_t* reused) {
+    size_t common = reuse_prefix(tokens, n);
+    if (reused) *reused = common;
+    return infer_one_step(tokens + common, n - common);
+}
+
+size_t Qwen2Model::reuse_prefix(const int64_t* tokens, size_t n) {
+    ASSERT(n > 0, "Qwen2Model: empty input");
+    
+    // 最后一个 token 总要前向一次才能得到下一个 token
+    size_t limit = std::min(history_.size(), n - 1);
+    size_t common = std::mismatch(history_.begin(), history_.begin() + limit, tokens).first - history_.begin();
+    kv_cache_->truncate(common);
+    history_.resize(common);
+    return common;
+}
+
+void Qwen2Model::infer_one_step_topk(const int64_t* tokens, size_t n, size_t k, int64_t* indices, float* logits) {
+    ASSERT(n > 0, "Qwen2Model: empty input");
+    if (n > 1) prefill(*kv_cache_, tokens, n - 1);
+    forward_topk(*kv_cache_, tokens + n - 1, 1, k, indices, logits);
+    history_.insert(history_.end(), tokens, tokens + n);
+}
+
+void Qwen2Model::prefill(ModelKVCache& kv, const int64_t* tokens, size_t n) {
+    ASSERT(n > 0, "Qwen2Model: empty input");
+    ASSERT(config_.device_type == LLAISYS_DEVICE_CPU, "only cpu inference supported");
+    
+    // 长 prompt 按 max_chunk 分块预填充，工作区大小与 prompt 长度无关
+    size_t done = 0;
+    while (done < n) {
+        size_t chunk = std::min(config_.max_chunk, n - done);
+        steps_.assign(1, SeqStep{&kv, 0, chunk, true});
+        forward(tokens + done, steps_);
+        done += chunk;
+    }
+}
+
+int64_t Qwen2Model::infer(ModelKVCache& kv, const int64_t* tokens, size_t n) {
+    prefill(kv, tokens, n);
+    int64_t next = -1;
+    head(steps_, &next);
+    return next;
+}
+
+void Qwen2Model::infer_batch(ModelKVCache* const* kvs, const int64_t* tokens, size_t nseq, int64_t* next_tokens) {
+    ASSERT(nseq > 0 && nseq <= config_.max_chunk, "Qwen2Model: batch size exceeds max_chunk");
     
-    ops::argmax(idx, val, last);
+    steps_.resize(nseq);
+    for (size_t i = 0; i < nseq; ++i) steps_[i] = SeqStep{kvs[i], 0, 1, true};
+    step(tokens, steps_, next_tokens);
+}
+
+void Qwen2Model::step(const int64_t* tokens, std::vector<SeqStep>& steps, int64_t* next_tokens) {
+    ASSERT(config_.device_type == LLAISYS_DEVICE_CPU, "only cpu inference supported");
+    forward(tokens, steps);
+    head(steps, next_tokens);
+}
+
+void Qwen2Model::forward_topk(ModelKVCache& kv, const int64_t* tokens, size_t n, size_t k,
+                              int64_t* indices, float* logits) {
+    ASSERT(config_.device_type == LLAISYS_DEVICE_CPU, "only cpu inference supported");
+    ASSERT(n > 0 && n <= config_.max_chunk, "Qwen2Model: chunk exceeds workspace capacity");
+    ASSERT(k > 0 && k <= config_.voc, "Qwen2Model: invalid top-k");
+    
+    steps_.assign(1, SeqStep{&kv, 0, n, false});
+    forward(tokens, steps_);
+    
+    auto& h = topk_heads_[{n, k}];
+    if (!h.topk_idx) {
+        h.topk_idx = Tensor::create({n, k}, LLAISYS_DTYPE_I64, config_.device_type, config_.device_id);
+        h.topk_val = Tensor::create({n, k}, config_.act_dtype, config_.device_type, config_.device_id);
+    }
+    // 单序列前向时 residual 正好是 [n, hs]
+    ops::lm_head_topk(h.topk_idx, h.topk_val, acts_.residual, final_norm_w_, lm_head_, config_.epsilon);
+    
+    std::memcpy(indices, h.topk_idx->data(), n * k * sizeof(int64_t));
+    const std::byte* val = h.topk_val->data();
+    for (size_t i = 0; i < n * k; ++i) {
+        switch (config_.act_dtype) {
+        case LLAISYS_DTYPE_F32:
+            logits[i] = reinterpret_cast<const float*>(val)[i];
+            break;
+        case LLAISYS_DTYPE_F16:
+            logits[i] = utils::cast<float>(reinterpret_cast<const fp16_t*>(val)[i]);
+            break;
+        case LLAISYS_DTYPE_BF16:
+            logits[i] = utils::cast<float>(reinterpret_cast<const bf16_t*>(val)[i]);
+            break;
+        default:
+            EXCEPTION_UNSUPPORTED_DATATYPE(config_.act_dtype);
+        }
+    }
+}
+
+void Qwen2Model::head(const std::vector<SeqStep>& steps, int64_t* next_tokens) {
+    size_t n = 0;
+    for (const auto& s : steps) n += s.verify ? s.ntoken : s.sample ? 1 : 0;
+    if (n == 0) {
+        std::fill(next_tokens, next_tokens + steps.size(), -1);
+        return;
+    }
     
-    int64_t next = *reinterpret_cast<int64_t*>(idx->data());
-    current_pos_ += n;
+    auto& h = heads_[n];
+    if (!h.last) {
+        h.last = workspace_.tensor(slots_.last, {n, config_.hs}, config_.act_dtype);
+        h.topk_idx = workspace_.tensor(slots_.topk_idx, {n, 1}, LLAISYS_DTYPE_I64);
+        h.topk_val = workspace_.tensor(slots_.topk_val, {n, 1}, config_.act_dtype);
+    }
     
-    return next;
+    // 把需要采样的行（各序列最后一行，verify 序列的全部行）收集到 last，
+    // 再一次性做 final norm + lm_head + argmax，不生成完整 logits
+    size_t row_bytes = config_.hs * utils::dsize(config_.act_dtype);
+    const std::byte* residual = acts_.residual->data();
+    std::byte* last = h.last->data();
+    size_t end = 0;
+    for (const auto& s : steps) {
+        end += s.ntoken;
+        size_t rows = s.verify ? s.ntoken : s.sample ? 1 : 0;
+        std::memcpy(last, residual + (end - rows) * row_bytes, rows * row_bytes);
+        last += rows * row_bytes;
+    }
+    ops::lm_head_topk(h.topk_idx, h.topk_val, h.last, final_norm_w_, lm_head_, config_.epsilon);
+    
+    const int64_t* idx = reinterpret_cast<const int64_t*>(h.topk_idx->data());
+    for (const auto& s : steps) {
+        if (s.verify) {
+            next_tokens = std::copy_n(idx, s.ntoken, next_tokens);
+            idx += s.ntoken;
+        } else {
+            *next_tokens++ = s.sample ? *idx++ : -1;
+        }
+    }
 }
 
 void Qwen2Model::reset() {
-    current_pos_ = 0;
     kv_cache_->reset_all();
+    history_.clear();
+}
+
+void Qwen2Model::weights_replaced() {
+    // 被替换的权重张量已释放，执行计划中记录的是旧指针；
+    // 流式预取线程仍持有旧的映射，先停掉它，旧映射才能随之释放
+    layer_observer_.reset();
+    invalidate_graphs();
+    core::context().runtime().trimAllocator();
 }
 
 } // namespace llaisys::models
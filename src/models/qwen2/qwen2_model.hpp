@@ -2,8 +2,12 @@
 #include "../../tensor/tensor.hpp"
 #include "../../ops/ops.hpp"
 #include "kv_cache.hpp"
+#include "workspace.hpp"
+#include "graph.hpp"
 #include <vector>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 
 namespace llaisys::models {
@@ -20,9 +24,21 @@ struct Qwen2Config {
     float epsilon;
     float theta;
     int64_t eos_token_id;
-    llaisysDataType_t dtype;
+    llaisysDataType_t dtype; // 权重的 dtype
     llaisysDeviceType_t device_type;
     int device_id;
+    size_t max_chunk = 256; // 单次前向最多处理的 token 数，决定激活工作区大小
+    // 激活、残差流与 KV-Cache 的 dtype；INVALID 表示与权重相同。
+    // 如 bf16 权重 + f32 激活：权重仍按 bf16 存储与读取，各算子之间不再舍入到 bf16
+    llaisysDataType_t act_dtype = LLAISYS_DTYPE_INVALID;
+};
+
+// 逐层前向的观察者（如权重的流式预取），在前向线程上于每层开始前 / 结束后调用
+class LayerObserver {
+public:
+    virtual ~LayerObserver() = default;
+    virtual void before_layer(size_t layer) = 0;
+    virtual void after_layer(size_t layer) = 0;
 };
 
 class Qwen2Model {
@@ -48,13 +64,63 @@ private:
     std::vector<tensor_t> up_proj_w_;
     std::vector<tensor_t> down_proj_w_;
     
-    // KV-Cache
+    // fold_norm_weights 之后：q/k/v 权重与偏置按行拼接为一个投影，q/k/v_proj 是其切片
+    std::vector<tensor_t> qkv_proj_w_;
+    std::vector<tensor_t> qkv_proj_b_;
+    bool norm_folded_ = false;
+    
+    // 默认序列的 KV-Cache（infer_one_step 使用），其长度即当前位置
     std::unique_ptr<ModelKVCache> kv_cache_;
-    size_t current_pos_;
+    // 已写入默认序列 KV-Cache 的 token，用于多轮对话时查找可复用的公共前缀
+    std::vector<int64_t> history_;
+    std::vector<SeqStep> steps_;
+
+    // 激活工作区及各中间张量的缓冲区 id
+    Workspace workspace_;
+    struct {
+        size_t ids, pos, residual, h1, normed, qkv, qr, kr, attn, attn_out;
+        size_t mlp_in, gate, up, act, mlp_out, last, topk_idx, topk_val;
+    } slots_;
+
+    // 按 seq 绑定的激活视图；seq 不变时（如逐 token 解码）直接复用
+    struct Activations {
+        size_t seq = 0;
+        tensor_t ids, pos, residual, h1, normed;
+        tensor_t qkv, q, k, v, qr, kr, attn, attn_2d, attn_out;
+        tensor_t mlp_in, gate, up, act, mlp_out;
+    } acts_;
+    
+    // 输出头的视图，按需要采样的序列数 n 缓存：last [n, hs]，topk [n, 1]
+    struct HeadViews {
+        tensor_t last, topk_idx, topk_val;
+    };
+    std::vector<HeadViews> heads_;
+    // forward_topk 的输出，按 (行数, k) 缓存
+    std::map<std::pair<size_t, size_t>, HeadViews> topk_heads_;
+    
+    // 变长注意力的参数暂存，跨步复用
+    struct {
+        std::vector<const std::byte*> k, v;
+        std::vector<size_t> q_start, kv_len;
+        std::vector<tensor_t> k_views, v_views;
+        std::vector<size_t> q_lens;
+    } varlen_;
+
+    // 按 (batch, chunk) 分桶的录制执行计划，首次遇到某个桶时录制
+    std::map<std::pair<size_t, size_t>, StepGraph> graphs_;
+    bool use_graphs_ = true;
+    
+    std::shared_ptr<LayerObserver> layer_observer_;
+    
+    std::mutex mutex_;
 
 public:
     Qwen2Model(const Qwen2Config& config);
     
+    const Qwen2Config& config() const { return config_; }
+    // 工作区与执行计划只有一份，多线程共享模型时（如多个会话）前向需持有该锁
+    std::mutex& mutex() { return mutex_; }
+    
     // 获取权重指针
     tensor_t& embed_tokens() { return embed_tokens_; }
     tensor_t& lm_head() { return lm_head_; }
@@ -72,18 +138,72 @@ public:
     tensor_t& up_proj_w(size_t i) { return up_proj_w_[i]; }
     tensor_t& down_proj_w(size_t i) { return down_proj_w_[i]; }
     
-    // 前向传播
-    tensor_t forward(tensor_t input_ids);
+    // 加载后的权重优化（仅 CPU）：把 RMSNorm 的权重乘进其后的 q/k/v 与 gate/up 权重的列，
+    // 并把 q/k/v 的权重与偏置拼接为一个投影。之后每层的两次 RMSNorm 只做归一化，
+    // q/k/v 由一次线性层算出；norm 权重置为 1，保存的权重与未优化的路径等价（至多差一次舍入）。
+    // 被折叠的权重改为模型自有的新张量，不再是文件映射；折叠后不能再加载权重
+    void fold_norm_weights();
+    bool norm_weights_folded() const { return norm_folded_; }
     
-    // 推理一步
+    // 为一条新序列创建独立的 KV-Cache
+    std::unique_ptr<ModelKVCache> create_kv_cache() const;
+    
+    // 对若干序列做一次前向：token_ids 按 steps 的顺序排列，总数不超过 max_chunk。
+    // 各序列的 past_len 由其 KV-Cache 当前长度填入，前向后 KV-Cache 随之增长。
+    // 返回最后一层输出的隐藏状态 [总 token 数, hs]（未经过 final norm），
+    // 是工作区中的视图，下一次前向时会被覆盖。
+    tensor_t forward(const int64_t* token_ids, std::vector<SeqStep>& steps);
+    
+    // 推理一步（默认序列）
     int64_t infer_one_step(const int64_t* token_ids, size_t ntoken);
+    // 以完整的 token 序列（如整段对话）推理默认序列：与已缓存 token 的公共前缀直接复用，
+    // KV-Cache 截断到第一个不同的位置，只前向其后的 token（至少最后一个）。
+    // reused 非空时写入复用的 token 数
+    int64_t infer_reuse(const int64_t* token_ids, size_t ntoken, size_t* reused = nullptr);
+    // 把默认序列截断到与 token_ids 的公共前缀（不超过 ntoken - 1），返回其长度
+    size_t reuse_prefix(const int64_t* token_ids, size_t ntoken);
+    // 推理一步（默认序列），最后一个 token 的 top-k 写入 indices / logits（[k]，降序），用于采样
+    void infer_one_step_topk(const int64_t* token_ids, size_t ntoken, size_t k, int64_t* indices, float* logits);
+    // 推理一步（指定序列）：预填充或解码，返回下一个 token
+    int64_t infer(ModelKVCache& kv, const int64_t* token_ids, size_t ntoken);
+    // 只把 token 写入指定序列的 KV-Cache，不计算下一个 token（分块预填充的中间块）
+    void prefill(ModelKVCache& kv, const int64_t* token_ids, size_t ntoken);
+    // 批量解码：每条序列输入一个 token，一次前向中线性层按 [nseq, hs] 计算
+    void infer_batch(ModelKVCache* const* kvs, const int64_t* token_ids, size_t nseq, int64_t* next_tokens);
+    // 混合步：解码 token 与预填充块按 steps 顺序排在同一次前向中（总数不超过 max_chunk）。
+    // next_tokens 按 steps 顺序排列：verify 的序列写入 ntoken 个（每个 token 之后的下一个 token），
+    // 其余序列写入 1 个，sample 为假时为 -1
+    void step(const int64_t* token_ids, std::vector<SeqStep>& steps, int64_t* next_tokens);
+    // 在指定序列上前向 ntoken 个 token（不超过 max_chunk），并对每一行都做
+    // final norm + lm_head + top-k：indices/logits 为 [ntoken, k]，logits 转为 float。
+    // 用于投机解码中一次前向验证多个草稿 token
+    void forward_topk(ModelKVCache& kv, const int64_t* token_ids, size_t ntoken, size_t k,
+                      int64_t* indices, float* logits);
     
     // 重置
     void reset();
+    
+    // 开关执行计划回放（仅 CPU）；关闭时每步逐个调用算子
+    void set_graph_capture(bool enable) { use_graphs_ = enable; }
+    // 权重张量被替换后必须调用，已录制的计划持有旧指针
+    void invalidate_graphs() { graphs_.clear(); }
+    // 加载器与 fold_norm_weights 替换完权重后调用：丢弃执行计划与逐层观察者
+    // （观察者记录的是旧权重，如 LayerStreamer），并把空出的缓存块还给系统
+    void weights_replaced();
+    // 设置逐层观察者（nullptr 取消），已录制的计划随之失效
+    void set_layer_observer(std::shared_ptr<LayerObserver> observer) {
+        layer_observer_ = std::move(observer);
+        invalidate_graphs();
+    }
+    const std::shared_ptr<LayerObserver>& layer_observer() const { return layer_observer_; }
 
 private:
-    tensor_t transformer_layer(tensor_t hidden, size_t layer_idx, tensor_t pos_ids);
-    tensor_t create_position_ids(size_t seqlen);
+    void plan_workspace();
+    Activations& bind_activations(size_t seq);
+    // final norm + lm_head + argmax，只对 sample 为真的序列的最后一行与 verify 序列的所有行计算
+    void head(const std::vector<SeqStep>& steps, int64_t* next_tokens);
+    void transformer_layer(Activations& acts, size_t layer_idx, const std::vector<SeqStep>& steps);
+    void capture_graph(Activations& acts, StepGraph& graph);
 };
 
 } // namespace llaisys::models
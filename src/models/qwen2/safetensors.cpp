@@ -0,0 +1,565 @@
+#include "safetensors.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace llaisys::models {
+
+MappedFile::MappedFile(const std::string& path, [[maybe_unused]] bool readahead) {
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    CHECK_ARGUMENT(fd >= 0, "MappedFile: cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        CHECK_ARGUMENT(false, "MappedFile: cannot stat " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+#if defined(POSIX_FADV_WILLNEED)
+    if (readahead) {
+        // 加大预读窗口并立即在后台读入整个文件
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    }
+#endif
+    void* addr = size_ > 0 ? mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    CHECK_ARGUMENT(addr != MAP_FAILED, "MappedFile: cannot map " + path);
+    data_ = static_cast<std::byte*>(addr);
+    if (readahead && data_) madvise(data_, size_, MADV_WILLNEED);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    CHECK_ARGUMENT(in.is_open(), "MappedFile: cannot open " + path);
+    size_ = static_cast<size_t>(in.tellg());
+    buffer_.resize(size_);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(buffer_.data()), size_);
+    CHECK_ARGUMENT(in.good(), "MappedFile: cannot read " + path);
+    data_ = buffer_.data();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (data_) munmap(data_, size_);
+#endif
+}
+
+namespace {
+
+// safetensors 头部与 config.json 用到的 JSON 子集：对象、数组、字符串、数字；其他值只跳过
+class HeaderParser {
+public:
+    HeaderParser(const char* begin, const char* end, const std::string& path) : p_(begin), end_(end), path_(path) {}
+
+    void parse(std::map<std::string, SafetensorsEntry>& out, size_t data_start, size_t file_size) {
+        expect('{');
+        if (peek() == '}') {
+            ++p_;
+            return;
+        }
+        do {
+            std::string name = string();
+            expect(':');
+            if (name == "__metadata__") {
+                skip_value();
+                continue;
+            }
+            out[name] = entry(data_start, file_size);
+        } while (next_member('}'));
+    }
+
+    // 顶层的数值成员；值为数组时取第一个元素（如多个 eos_token_id）
+    void parse_numbers(std::map<std::string, double>& out) {
+        expect('{');
+        if (peek() == '}') {
+            ++p_;
+            return;
+        }
+        do {
+            std::string name = string();
+            expect(':');
+            if (number_ahead()) {
+                out[name] = number();
+            } else if (peek() == '[') {
+                ++p_;
+                if (peek() == ']') {
+                    ++p_;
+                    continue;
+                }
+                bool first = true;
+                do {
+                    if (first && number_ahead()) {
+                        out[name] = number();
+                    } else {
+                        skip_value();
+                    }
+                    first = false;
+                } while (next_member(']'));
+            } else {
+                skip_value();
+            }
+        } while (next_member('}'));
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    const std::string& path_;
+
+    [[noreturn]] void fail(const std::string& what) {
+        throw std::invalid_argument("safetensors: malformed header in " + path_ + ": " + what);
+    }
+
+    char peek() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+        if (p_ == end_) fail("unexpected end");
+        return *p_;
+    }
+
+    void expect(char c) {
+        if (peek() != c) fail(std::string("expected '") + c + "'");
+        ++p_;
+    }
+
+    // 读到 ',' 返回 true，读到 close 返回 false
+    bool next_member(char close) {
+        char c = peek();
+        ++p_;
+        if (c == ',') return true;
+        if (c != close) fail("expected ',' or closing bracket");
+        return false;
+    }
+
+    std::string string() {
+        expect('"');
+        std::string s;
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ == '\\') {
+                if (++p_ == end_) break;
+                // 张量名只含 ASCII，\uXXXX 原样保留
+                s.push_back(*p_ == 'n' ? '\n' : *p_ == 't' ? '\t' : *p_);
+            } else {
+                s.push_back(*p_);
+            }
+            ++p_;
+        }
+        if (p_ == end_) fail("unterminated string");
+        ++p_;
+        return s;
+    }
+
+    size_t integer() {
+        peek();
+        if (p_ == end_ || *p_ < '0' || *p_ > '9') fail("expected integer");
+        size_t v = 0;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') v = v * 10 + static_cast<size_t>(*p_++ - '0');
+        return v;
+    }
+
+    bool number_ahead() {
+        char c = peek();
+        return c == '-' || (c >= '0' && c <= '9');
+    }
+
+    double number() {
+        peek();
+        const char* begin = p_;
+        while (p_ < end_ && (std::strchr("+-.eE", *p_) || (*p_ >= '0' && *p_ <= '9'))) ++p_;
+        std::string text(begin, p_);
+        char* parsed = nullptr;
+        double v = std::strtod(text.c_str(), &parsed);
+        if (text.empty() || parsed != text.c_str() + text.size()) fail("expected number");
+        return v;
+    }
+
+    std::vector<size_t> integers() {
+        std::vector<size_t> v;
+        expect('[');
+        if (peek() == ']') {
+            ++p_;
+            return v;
+        }
+        do {
+            v.push_back(integer());
+        } while (next_member(']'));
+        return v;
+    }
+
+    void skip_value() {
+        char c = peek();
+        if (c == '"') {
+            string();
+        } else if (c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            ++p_;
+            if (peek() == close) {
+                ++p_;
+                return;
+            }
+            do {
+                if (close == '}') {
+                    string();
+                    expect(':');
+                }
+                skip_value();
+            } while (next_member(close));
+        } else {
+            while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']') ++p_;
+        }
+    }
+
+    static llaisysDataType_t dtype(const std::string& s) {
+        static const std::map<std::string, llaisysDataType_t> types = {
+            {"BOOL", LLAISYS_DTYPE_BOOL}, {"U8", LLAISYS_DTYPE_U8},   {"I8", LLAISYS_DTYPE_I8},
+            {"I16", LLAISYS_DTYPE_I16},   {"U16", LLAISYS_DTYPE_U16}, {"I32", LLAISYS_DTYPE_I32},
+            {"U32", LLAISYS_DTYPE_U32},   {"I64", LLAISYS_DTYPE_I64}, {"U64", LLAISYS_DTYPE_U64},
+            {"F16", LLAISYS_DTYPE_F16},   {"BF16", LLAISYS_DTYPE_BF16}, {"F32", LLAISYS_DTYPE_F32},
+            {"F64", LLAISYS_DTYPE_F64},
+        };
+        auto it = types.find(s);
+        return it == types.end() ? LLAISYS_DTYPE_INVALID : it->second;
+    }
+
+    SafetensorsEntry entry(size_t data_start, size_t file_size) {
+        SafetensorsEntry e{LLAISYS_DTYPE_INVALID, {}, 0, 0};
+        std::vector<size_t> offsets;
+        expect('{');
+        do {
+            std::string key = string();
+            expect(':');
+            if (key == "dtype") {
+                e.dtype = dtype(string());
+            } else if (key == "shape") {
+                e.shape = integers();
+            } else if (key == "data_offsets") {
+                offsets = integers();
+            } else {
+                skip_value();
+            }
+        } while (next_member('}'));
+
+        if (offsets.size() != 2 || offsets[0] > offsets[1]) fail("bad data_offsets");
+        e.offset = data_start + offsets[0];
+        e.nbytes = offsets[1] - offsets[0];
+        if (e.offset + e.nbytes > file_size) fail("tensor data out of range");
+        return e;
+    }
+};
+
+// 逐元素转换浮点 dtype
+void convert(std::byte* dst, llaisysDataType_t dst_dtype, const std::byte* src, llaisysDataType_t src_dtype, size_t n) {
+    auto load = [&](size_t i) -> float {
+        switch (src_dtype) {
+        case LLAISYS_DTYPE_F32:
+            return reinterpret_cast<const float*>(src)[i];
+        case LLAISYS_DTYPE_F16:
+            return utils::cast<float>(reinterpret_cast<const fp16_t*>(src)[i]);
+        case LLAISYS_DTYPE_BF16:
+            return utils::cast<float>(reinterpret_cast<const bf16_t*>(src)[i]);
+        default:
+            EXCEPTION_UNSUPPORTED_DATATYPE(src_dtype);
+        }
+    };
+    for (size_t i = 0; i < n; ++i) {
+        float v = load(i);
+        switch (dst_dtype) {
+        case LLAISYS_DTYPE_F32:
+            reinterpret_cast<float*>(dst)[i] = v;
+            break;
+        case LLAISYS_DTYPE_F16:
+            reinterpret_cast<fp16_t*>(dst)[i] = utils::cast<fp16_t>(v);
+            break;
+        case LLAISYS_DTYPE_BF16:
+            reinterpret_cast<bf16_t*>(dst)[i] = utils::cast<bf16_t>(v);
+            break;
+        default:
+            EXCEPTION_UNSUPPORTED_DATATYPE(dst_dtype);
+        }
+    }
+}
+
+} // namespace
+
+SafetensorsFile::SafetensorsFile(const std::string& path, bool readahead)
+    : file_(std::make_shared<MappedFile>(path, readahead)) {
+    CHECK_ARGUMENT(file_->size() >= 8, "safetensors: file too small: " + path);
+    uint64_t header_len = 0;
+    for (int i = 7; i >= 0; --i) header_len = (header_len << 8) | static_cast<uint8_t>(file_->data()[i]);
+    CHECK_ARGUMENT(header_len <= file_->size() - 8, "safetensors: bad header length in " + path);
+
+    const char* header = reinterpret_cast<const char*>(file_->data() + 8);
+    HeaderParser(header, header + header_len, path).parse(tensors_, 8 + header_len, file_->size());
+}
+
+Qwen2Config read_hf_config(const std::string& dir, llaisysDataType_t dtype, size_t max_maxseq) {
+    std::string path = (std::filesystem::path(dir) / "config.json").string();
+    std::ifstream in(path, std::ios::binary);
+    CHECK_ARGUMENT(in.is_open(), "read_hf_config: cannot open " + path);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::map<std::string, double> values;
+    HeaderParser(text.data(), text.data() + text.size(), path).parse_numbers(values);
+    auto get = [&](const char* key, std::optional<double> fallback = std::nullopt) {
+        auto it = values.find(key);
+        if (it != values.end()) return it->second;
+        CHECK_ARGUMENT(fallback.has_value(), std::string("read_hf_config: missing ") + key + " in " + path);
+        return *fallback;
+    };
+
+    Qwen2Config cfg;
+    cfg.nlayer = static_cast<size_t>(get("num_hidden_layers"));
+    cfg.hs = static_cast<size_t>(get("hidden_size"));
+    cfg.nh = static_cast<size_t>(get("num_attention_heads"));
+    cfg.nkvh = static_cast<size_t>(get("num_key_value_heads", static_cast<double>(cfg.nh)));
+    cfg.dh = cfg.hs / cfg.nh;
+    cfg.di = static_cast<size_t>(get("intermediate_size"));
+    cfg.maxseq = std::min(static_cast<size_t>(get("max_position_embeddings", 2048)), max_maxseq);
+    cfg.voc = static_cast<size_t>(get("vocab_size"));
+    cfg.epsilon = static_cast<float>(get("rms_norm_eps", 1e-6));
+    cfg.theta = static_cast<float>(get("rope_theta", 10000.0));
+    cfg.eos_token_id = static_cast<int64_t>(get("eos_token_id", 151643));
+    cfg.dtype = dtype;
+    cfg.device_type = LLAISYS_DEVICE_CPU;
+    cfg.device_id = 0;
+    return cfg;
+}
+
+std::map<std::string, tensor_t*> weight_slots(Qwen2Model& model) {
+    const auto& cfg = model.config();
+    std::map<std::string, tensor_t*> slots = {
+        {"model.embed_tokens.weight", &model.embed_tokens()},
+        {"lm_head.weight", &model.lm_head()},
+        {"model.norm.weight", &model.final_norm_w()},
+    };
+    for (size_t i = 0; i < cfg.nlayer; ++i) {
+        std::string p = "model.layers." + std::to_string(i) + ".";
+        slots[p + "input_layernorm.weight"] = &model.attn_norm_w(i);
+        slots[p + "self_attn.q_proj.weight"] = &model.q_proj_w(i);
+        slots[p + "self_attn.q_proj.bias"] = &model.q_proj_b(i);
+        slots[p + "self_attn.k_proj.weight"] = &model.k_proj_w(i);
+        slots[p + "self_attn.k_proj.bias"] = &model.k_proj_b(i);
+        slots[p + "self_attn.v_proj.weight"] = &model.v_proj_w(i);
+        slots[p + "self_attn.v_proj.bias"] = &model.v_proj_b(i);
+        slots[p + "self_attn.o_proj.weight"] = &model.o_proj_w(i);
+        slots[p + "post_attention_layernorm.weight"] = &model.mlp_norm_w(i);
+        slots[p + "mlp.gate_proj.weight"] = &model.gate_proj_w(i);
+        slots[p + "mlp.up_proj.weight"] = &model.up_proj_w(i);
+        slots[p + "mlp.down_proj.weight"] = &model.down_proj_w(i);
+    }
+    return slots;
+}
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// 一个 safetensors 张量到模型权重的加载任务
+struct LoadJob {
+    enum class Kind {
+        MAP,     // CPU 上 dtype 一致：直接以映射为存储
+        COPY,    // 其他设备上 dtype 一致：原样拷贝到设备
+        CONVERT, // dtype 不同：先转换
+    };
+    Kind kind;
+    tensor_t* slot;
+    const SafetensorsFile* file;
+    const SafetensorsEntry* entry;
+    tensor_t target;                // CONVERT 在 CPU 上的目标张量，可能就是 *slot
+    std::vector<std::byte> staging; // CONVERT 在其他设备上的转换结果
+};
+
+// convert 阶段的工作单元：任务中 [begin, end) 范围的元素
+struct LoadChunk {
+    size_t job;
+    size_t begin;
+    size_t end;
+};
+
+// 每块约 4 MiB，大张量（embedding 等）也能分给多个线程
+constexpr size_t LOAD_CHUNK_BYTES = size_t(4) << 20;
+constexpr size_t PAGE_BYTES = 4096;
+
+// 逐页读一个字节，让缺页读盘发生在工作线程上
+void prefault(const std::byte* p, size_t n) {
+    volatile unsigned char sink = 0;
+    for (size_t i = 0; i < n; i += PAGE_BYTES) sink = sink + static_cast<unsigned char>(p[i]);
+    if (n > 0) sink = sink + static_cast<unsigned char>(p[n - 1]);
+    (void)sink;
+}
+
+} // namespace
+
+WeightLoadStats load_safetensors(Qwen2Model& model, const std::string& dir, const LoadOptions& options) {
+    const auto& cfg = model.config();
+    CHECK_ARGUMENT(!model.norm_weights_folded(), "load_safetensors: weights have been folded, load into a new model");
+    const auto start = std::chrono::steady_clock::now();
+    WeightLoadStats stats;
+
+    std::vector<std::string> paths;
+    for (const auto& f : std::filesystem::directory_iterator(dir)) {
+        if (f.is_regular_file() && f.path().extension() == ".safetensors") paths.push_back(f.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    CHECK_ARGUMENT(!paths.empty(), "load_safetensors: no .safetensors file in " + dir);
+
+    auto slots = weight_slots(model);
+    // 共享同一块内存的权重（如 tied embeddings 的 lm_head）不能原地转换
+    std::map<const std::byte*, size_t> owners;
+    if (cfg.device_type == LLAISYS_DEVICE_CPU) {
+        for (const auto& [name, w] : slots) owners[(*w)->data()]++;
+    }
+
+    core::context().setDevice(cfg.device_type, cfg.device_id);
+    auto& runtime = core::context().runtime();
+    auto report = [&](const char* stage, size_t done, size_t total) {
+        if (options.progress) options.progress(stage, done, total);
+    };
+
+    // read：顺序映射文件、发起预读、解析头部并生成任务
+    std::vector<std::unique_ptr<SafetensorsFile>> files;
+    std::vector<LoadJob> jobs;
+    size_t total_bytes = 0;
+    for (size_t f = 0; f < paths.size(); ++f) {
+        files.push_back(std::make_unique<SafetensorsFile>(paths[f], options.readahead));
+        stats.files++;
+        for (const auto& [name, e] : files.back()->tensors()) {
+            auto it = slots.find(name);
+            if (it == slots.end()) continue;
+            tensor_t& w = *it->second;
+            CHECK_ARGUMENT(e.shape == w->shape(), "load_safetensors: shape mismatch for " + name);
+            CHECK_ARGUMENT(e.nbytes == w->numel() * utils::dsize(e.dtype), "load_safetensors: size mismatch for " + name);
+
+            LoadJob job{LoadJob::Kind::CONVERT, &w, files.back().get(), &e, nullptr, {}};
+            if (e.dtype == cfg.dtype) {
+                job.kind = cfg.device_type == LLAISYS_DEVICE_CPU ? LoadJob::Kind::MAP : LoadJob::Kind::COPY;
+            } else if (cfg.device_type == LLAISYS_DEVICE_CPU) {
+                // 分配在这里顺序进行，工作线程只写数据
+                job.target = owners[w->data()] == 1 ? w : Tensor::create(e.shape, cfg.dtype);
+            } else {
+                job.staging.resize(w->numel() * w->elementSize());
+            }
+            total_bytes += e.nbytes;
+            jobs.push_back(std::move(job));
+            slots.erase(it);
+        }
+        report("read", f + 1, paths.size());
+    }
+    // tied embeddings
+    bool tie_lm_head = slots.count("lm_head.weight") && !slots.count("model.embed_tokens.weight");
+    if (tie_lm_head) slots.erase("lm_head.weight");
+    CHECK_ARGUMENT(slots.empty(), "load_safetensors: missing weight " + (slots.empty() ? "" : slots.begin()->first));
+    stats.read_ms = elapsed_ms(start);
+
+    // convert：按文件内偏移顺序切块，工作线程依次领取，读盘顺序与预读方向一致
+    auto convert_start = std::chrono::steady_clock::now();
+    std::vector<LoadChunk> chunks;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        const auto& job = jobs[j];
+        if (job.kind != LoadJob::Kind::CONVERT && !options.prefault) continue;
+        size_t numel = job.entry->nbytes / utils::dsize(job.entry->dtype);
+        size_t step = std::max<size_t>(1, LOAD_CHUNK_BYTES / utils::dsize(job.entry->dtype));
+        for (size_t b = 0; b < numel; b += step) chunks.push_back(LoadChunk{j, b, std::min(numel, b + step)});
+    }
+
+    std::atomic<size_t> next{0};
+    std::mutex progress_mutex;
+    size_t done_bytes = 0;
+    std::string error;
+    auto work = [&] {
+        for (size_t c; (c = next.fetch_add(1)) < chunks.size();) {
+            const auto& chunk = chunks[c];
+            auto& job = jobs[chunk.job];
+            const auto& e = *job.entry;
+            size_t src_size = utils::dsize(e.dtype);
+            const std::byte* src = job.file->file()->data() + e.offset + chunk.begin * src_size;
+            size_t n = chunk.end - chunk.begin;
+            try {
+                if (job.kind != LoadJob::Kind::CONVERT) {
+                    prefault(src, n * src_size);
+                } else {
+                    size_t dst_size = utils::dsize(cfg.dtype);
+                    std::byte* dst = job.target ? job.target->data() : job.staging.data();
+                    convert(dst + chunk.begin * dst_size, cfg.dtype, src, e.dtype, n);
+                }
+            } catch (const std::exception& ex) {
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                if (error.empty()) error = ex.what();
+                next.store(chunks.size());
+                return;
+            }
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            done_bytes += n * src_size;
+            report("convert", done_bytes, total_bytes);
+        }
+    };
+    size_t nthreads = options.nthreads ? options.nthreads : std::max(1u, std::thread::hardware_concurrency());
+    nthreads = std::max<size_t>(1, std::min(nthreads, chunks.size()));
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < nthreads; ++t) workers.emplace_back(work);
+    work();
+    for (auto& t : workers) t.join();
+    CHECK_ARGUMENT(error.empty(), "load_safetensors: " + error);
+    stats.convert_ms = elapsed_ms(convert_start);
+
+    // place：放入模型，拷贝到设备顺序进行
+    auto place_start = std::chrono::steady_clock::now();
+    std::map<const SafetensorsFile*, core::storage_t> storages; // 每个文件一份，按需创建
+    size_t placed_bytes = 0;
+    for (auto& job : jobs) {
+        tensor_t& w = *job.slot;
+        const auto& e = *job.entry;
+        const auto& file = job.file->file();
+        switch (job.kind) {
+        case LoadJob::Kind::MAP: {
+            auto& storage = storages[job.file];
+            if (!storage) storage = runtime.wrapExternalStorage(file->data(), file->size(), file);
+            w = Tensor::createOnStorage(storage, e.offset, e.shape, e.dtype);
+            stats.mapped++;
+            stats.mapped_bytes += e.nbytes;
+            break;
+        }
+        case LoadJob::Kind::COPY:
+            w->load(file->data() + e.offset);
+            stats.converted++;
+            stats.copied_bytes += e.nbytes;
+            break;
+        case LoadJob::Kind::CONVERT:
+            if (job.target) {
+                w = job.target;
+            } else {
+                w->load(job.staging.data());
+                std::vector<std::byte>().swap(job.staging);
+            }
+            stats.converted++;
+            stats.copied_bytes += w->numel() * w->elementSize();
+            break;
+        }
+        placed_bytes += e.nbytes;
+        report("place", placed_bytes, total_bytes);
+    }
+    if (tie_lm_head) model.lm_head() = model.embed_tokens();
+
+    model.weights_replaced();
+    stats.place_ms = elapsed_ms(place_start);
+    stats.total_ms = elapsed_ms(start);
+    return stats;
+}
+
+} // namespace llaisys::models
@@ -0,0 +1,88 @@
+#pragma once
+#include "qwen2_model.hpp"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llaisys::models {
+
+// 整个文件以写时复制方式映射到内存（不支持 mmap 的平台上读入内存），析构时解除映射。
+// 映射页与页缓存共享，误写权重也不会修改文件。
+// readahead 为真时提示内核顺序访问并立即开始异步预读整个文件
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path, bool readahead = true);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::byte* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<std::byte> buffer_; // 无 mmap 时的后备存储
+};
+
+struct SafetensorsEntry {
+    llaisysDataType_t dtype;
+    std::vector<size_t> shape;
+    size_t offset; // 相对于文件开头
+    size_t nbytes;
+};
+
+// safetensors 文件：8 字节小端头部长度 + JSON 头部 + 连续的张量数据
+class SafetensorsFile {
+public:
+    explicit SafetensorsFile(const std::string& path, bool readahead = true);
+
+    const std::map<std::string, SafetensorsEntry>& tensors() const { return tensors_; }
+    const std::shared_ptr<MappedFile>& file() const { return file_; }
+
+private:
+    std::shared_ptr<MappedFile> file_;
+    std::map<std::string, SafetensorsEntry> tensors_;
+};
+
+struct WeightLoadStats {
+    size_t files = 0;
+    size_t mapped = 0;       // 直接以映射为存储的张量数
+    size_t converted = 0;    // 需要拷贝（dtype 不同或非 CPU 设备）的张量数
+    size_t mapped_bytes = 0;
+    size_t copied_bytes = 0;
+    // 各阶段耗时（毫秒）：映射并解析头部、并行转换 / 预取、放入模型
+    double read_ms = 0;
+    double convert_ms = 0;
+    double place_ms = 0;
+    double total_ms = 0;
+};
+
+// 进度回调：stage 为 "read" / "convert" / "place"，done / total 为该阶段已完成 / 总字节数。
+// convert 阶段在工作线程上调用，调用之间互斥
+using LoadProgress = std::function<void(const char* stage, size_t done, size_t total)>;
+
+struct LoadOptions {
+    size_t nthreads = 0;   // convert 阶段的线程数，0 为硬件线程数
+    bool readahead = true; // 映射后提示内核预读
+    bool prefault = true;  // 直接映射的权重也在 convert 阶段并行读入页面，避免首次前向时缺页
+    LoadProgress progress;
+};
+
+// 读取 HuggingFace 的 config.json；maxseq 限制在 max_maxseq 以内（与 Python 端一致），设备为 CPU
+Qwen2Config read_hf_config(const std::string& dir, llaisysDataType_t dtype, size_t max_maxseq = 4096);
+
+// HuggingFace 权重名 -> 模型中的权重张量
+std::map<std::string, tensor_t*> weight_slots(Qwen2Model& model);
+
+// 从目录中所有 *.safetensors 文件加载 Qwen2 权重（HuggingFace 命名）。
+// CPU 上 dtype 一致的张量直接以文件映射为存储，不分配也不拷贝；其余转换 dtype 后拷贝进已有张量。
+// 没有 lm_head.weight 时与 embed_tokens 共享（tied embeddings）。缺少权重或形状不符时抛出异常。
+// 分三个阶段：read 顺序映射各文件并发起预读；convert 把张量切成块交给线程池并行转换 dtype 或读入页面；
+// place 把结果放入模型（拷贝到设备也在这里顺序进行）
+WeightLoadStats load_safetensors(Qwen2Model& model, const std::string& dir, const LoadOptions& options = LoadOptions{});
+
+} // namespace llaisys::models
@@ -0,0 +1,175 @@
+#include "scheduler.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+
+namespace llaisys::models {
+
+Qwen2Scheduler::Qwen2Scheduler(Qwen2Model& model, size_t max_batch, size_t token_budget)
+    : model_(model),
+      max_batch_(std::min(std::max<size_t>(max_batch, 1), model.config().max_chunk)),
+      token_budget_(std::min(std::max(token_budget, max_batch_), model.config().max_chunk)) {}
+
+int64_t Qwen2Scheduler::submit(const int64_t* tokens, size_t n, size_t max_new_tokens,
+                               const PromptLookupParams& lookup) {
+    CHECK_ARGUMENT(n > 0, "Qwen2Scheduler: empty prompt");
+    CHECK_ARGUMENT(n < model_.config().maxseq, "Qwen2Scheduler: prompt exceeds maxseq");
+    CHECK_ARGUMENT(max_new_tokens > 0, "Qwen2Scheduler: max_new_tokens must be positive");
+    
+    auto req = std::make_unique<Request>();
+    req->id = next_id_++;
+    req->prompt.assign(tokens, tokens + n);
+    req->max_new_tokens = max_new_tokens;
+    if (lookup.num_draft > 0) {
+        req->lookup = std::make_unique<NgramIndex>(lookup.ngram);
+        req->lookup->append(tokens, n);
+        req->lookup_draft = std::min(lookup.num_draft, model_.config().max_chunk - 1);
+    }
+    waiting_.push_back(std::move(req));
+    return waiting_.back()->id;
+}
+
+bool Qwen2Scheduler::cancel(int64_t id) {
+    auto match = [id](const std::unique_ptr<Request>& r) { return r->id == id; };
+    auto w = std::find_if(waiting_.begin(), waiting_.end(), match);
+    if (w != waiting_.end()) {
+        waiting_.erase(w);
+        events_.push_back(TokenEvent{id, -1, true});
+        return true;
+    }
+    auto r = std::find_if(running_.begin(), running_.end(), match);
+    if (r != running_.end() && !(*r)->finished) {
+        (*r)->finished = true;
+        events_.push_back(TokenEvent{id, -1, true});
+        retire_finished();
+        return true;
+    }
+    return false;
+}
+
+void Qwen2Scheduler::admit() {
+    while (!waiting_.empty() && running_.size() < max_batch_) {
+        auto req = std::move(waiting_.front());
+        waiting_.pop_front();
+        if (free_kv_.empty()) {
+            req->kv = model_.create_kv_cache();
+        } else {
+            req->kv = std::move(free_kv_.back());
+            free_kv_.pop_back();
+            req->kv->reset_all();
+        }
+        running_.push_back(std::move(req));
+    }
+}
+
+bool Qwen2Scheduler::emit(Request& req, int64_t token, size_t kv_len) {
+    req.generated++;
+    req.last_token = token;
+    if (req.lookup) req.lookup->append(token);
+    req.finished = token == model_.config().eos_token_id
+                || req.generated >= req.max_new_tokens
+                || kv_len >= model_.config().maxseq;
+    events_.push_back(TokenEvent{req.id, token, req.finished});
+    return req.finished;
+}
+
+void Qwen2Scheduler::retire_finished() {
+    auto it = std::stable_partition(running_.begin(), running_.end(),
+                                    [](const std::unique_ptr<Request>& r) { return !r->finished; });
+    for (auto r = it; r != running_.end(); ++r) {
+        free_kv_.push_back(std::move((*r)->kv));
+    }
+    running_.erase(it, running_.end());
+}
+
+size_t Qwen2Scheduler::step() {
+    size_t budget = token_budget_;
+    steps_.clear();
+    step_reqs_.clear();
+    step_tokens_.clear();
+    
+    // 1. 所有处于解码阶段的请求各一个 token；开启 prompt lookup 的请求再附带草稿，
+    //    草稿只使用所有解码 token 之外的预算
+    for (auto& r : running_) {
+        if (r->decoding()) budget--;
+    }
+    for (auto& r : running_) {
+        if (!r->decoding()) continue;
+        
+        size_t ndraft = 0;
+        if (r->lookup) {
+            size_t limit = std::min({r->lookup_draft, budget,
+                                     model_.config().maxseq - r->kv->length() - 1,
+                                     r->max_new_tokens - r->generated - 1});
+            draft_.resize(r->lookup_draft);
+            ndraft = r->lookup->propose(draft_.data(), limit);
+            budget -= ndraft;
+        }
+        steps_.push_back(SeqStep{r->kv.get(), 0, 1 + ndraft, true, ndraft > 0});
+        step_reqs_.push_back(r.get());
+        step_tokens_.push_back(r->last_token);
+        step_tokens_.insert(step_tokens_.end(), draft_.begin(), draft_.begin() + ndraft);
+    }
+    
+    // 2. 接纳新请求，3. 用剩余预算按到达顺序安排预填充块，与解码 token 同一次前向
+    admit();
+    for (auto& r : running_) {
+        if (budget == 0) break;
+        if (r->decoding()) continue;
+        
+        size_t chunk = std::min(r->prompt.size() - r->prefilled, budget);
+        const int64_t* tokens = r->prompt.data() + r->prefilled;
+        r->prefilled += chunk;
+        budget -= chunk;
+        steps_.push_back(SeqStep{r->kv.get(), 0, chunk, r->decoding()});
+        step_reqs_.push_back(r.get());
+        step_tokens_.insert(step_tokens_.end(), tokens, tokens + chunk);
+    }
+    if (steps_.empty()) return 0;
+    
+    size_t nnext = 0;
+    for (const auto& s : steps_) nnext += s.verify ? s.ntoken : 1;
+    step_next_.resize(nnext);
+    model_.step(step_tokens_.data(), steps_, step_next_.data());
+    
+    size_t produced = 0;
+    const int64_t* input = step_tokens_.data();
+    const int64_t* next = step_next_.data();
+    for (size_t i = 0; i < steps_.size(); ++i) {
+        const SeqStep& s = steps_[i];
+        Request& r = *step_reqs_[i];
+        if (s.verify) {
+            // 第 j 行预测第 j 个草稿；接受到第一个不一致处为止，该处的预测作为修正 token，
+            // 全部接受时最后一行再给出一个 token。被拒绝草稿的 KV 条目回滚
+            size_t ndraft = s.ntoken - 1, accepted = 0;
+            while (accepted < ndraft && next[accepted] == input[accepted + 1]) accepted++;
+            r.kv->truncate(s.past_len + 1 + accepted);
+            lookup_stats_.rounds++;
+            lookup_stats_.drafted += ndraft;
+            lookup_stats_.accepted += accepted;
+            for (size_t j = 0; j <= accepted; ++j) {
+                produced++;
+                lookup_stats_.emitted++;
+                if (emit(r, next[j], s.past_len + 1 + j)) break;
+            }
+            next += s.ntoken;
+        } else {
+            if (s.sample) {
+                emit(r, *next, r.kv->length());
+                produced++;
+            }
+            next++;
+        }
+        input += s.ntoken;
+    }
+    retire_finished();
+    return produced;
+}
+
+size_t Qwen2Scheduler::poll(TokenEvent* events, size_t capacity) {
+    size_t n = std::min(capacity, events_.size());
+    std::copy(events_.begin(), events_.begin() + n, events);
+    events_.erase(events_.begin(), events_.begin() + n);
+    return n;
+}
+
+} // namespace llaisys::models
@@ -0,0 +1,97 @@
+#pragma once
+#include "qwen2_model.hpp"
+#include "ngram_index.hpp"
+#include "speculative.hpp"
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace llaisys::models {
+
+// 调度器产生的一个 token
+struct TokenEvent {
+    int64_t request_id;
+    int64_t token;
+    bool finished; // 该请求的最后一个 token（EOS、达到 max_new_tokens 或 maxseq）
+};
+
+// 按请求开启的 prompt lookup 投机解码：用末尾 ngram 个 token 在 prompt 与已生成 token 中
+// 查找上一次出现，把其后至多 num_draft 个 token 作为草稿，与解码 token 一起验证
+struct PromptLookupParams {
+    size_t ngram = 3;
+    size_t num_draft = 0; // 0 为关闭
+};
+
+// 迭代级（continuous batching）调度器：
+// 每一步为所有已完成预填充的运行中请求各安排一个解码 token，再从等待队列
+// 接纳新请求，用剩余的 token 预算安排预填充块，两者合并为一次前向，
+// 长 prompt 不会阻塞正在解码的请求。请求一旦结束立即退出运行队列，
+// KV-Cache 回收复用。开启 prompt lookup 的请求在解码时附带草稿 token（占用剩余预算），
+// 一步可接受多个 token，被拒绝的 KV 条目随即回滚。输出与逐 token 贪心解码一致。
+class Qwen2Scheduler {
+public:
+    // max_batch: 同时运行的请求数上限（不超过模型的 max_chunk）
+    // token_budget: 每步处理的 token 数上限（解码 token + 预填充 token），
+    //               至少为 max_batch，保证每步所有运行中的请求都能解码；
+    //               不超过 max_chunk
+    Qwen2Scheduler(Qwen2Model& model, size_t max_batch, size_t token_budget);
+
+    // 提交请求，返回请求 id
+    int64_t submit(const int64_t* token_ids, size_t ntoken, size_t max_new_tokens,
+                   const PromptLookupParams& lookup = PromptLookupParams{});
+    // 取消等待或运行中的请求，并产生一个 token 为 -1 的结束事件；返回是否找到
+    bool cancel(int64_t request_id);
+
+    // 执行一次迭代，返回本步产生的 token 数
+    size_t step();
+    // 取出至多 capacity 个已产生的 token，返回实际数量
+    size_t poll(TokenEvent* events, size_t capacity);
+
+    bool has_work() const { return !waiting_.empty() || !running_.empty(); }
+    size_t num_waiting() const { return waiting_.size(); }
+    size_t num_running() const { return running_.size(); }
+    size_t num_pending_events() const { return events_.size(); }
+    // 所有请求累计的 prompt lookup 统计（rounds 为附带草稿的解码步数）
+    const SpeculativeStats& lookup_stats() const { return lookup_stats_; }
+
+private:
+    struct Request {
+        int64_t id;
+        std::vector<int64_t> prompt;
+        size_t prefilled = 0; // 已写入 KV-Cache 的 prompt token 数
+        size_t max_new_tokens;
+        size_t generated = 0;
+        int64_t last_token = -1;
+        bool finished = false;
+        std::unique_ptr<ModelKVCache> kv;
+        std::unique_ptr<NgramIndex> lookup; // prompt lookup 关闭时为空
+        size_t lookup_draft = 0;
+
+        bool decoding() const { return prefilled == prompt.size(); }
+    };
+
+    Qwen2Model& model_;
+    size_t max_batch_;
+    size_t token_budget_;
+    int64_t next_id_ = 0;
+
+    std::deque<std::unique_ptr<Request>> waiting_;
+    std::vector<std::unique_ptr<Request>> running_;
+    std::deque<TokenEvent> events_;
+    std::vector<std::unique_ptr<ModelKVCache>> free_kv_;
+
+    // 每步前向的暂存，跨步复用
+    std::vector<SeqStep> steps_;
+    std::vector<Request*> step_reqs_;
+    std::vector<int64_t> step_tokens_;
+    std::vector<int64_t> step_next_;
+    std::vector<int64_t> draft_;
+    SpeculativeStats lookup_stats_;
+
+    void admit();
+    // 记录一个新 token，kv_len 为产生该 token 时 KV-Cache 的长度；请求结束时返回 true
+    bool emit(Request& req, int64_t token, size_t kv_len);
+    void retire_finished();
+};
+
+} // namespace llaisys::models
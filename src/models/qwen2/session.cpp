@@ -0,0 +1,47 @@
+#include "session.hpp"
+#include "../../utils.hpp"
+#include <mutex>
+
+namespace llaisys::models {
+
+Qwen2Session::Qwen2Session(Qwen2Model& model, KVMemoryManager* manager)
+    : model_(model), manager_(manager), kv_(model.create_kv_cache()) {
+    if (manager_) manager_->attach(*this);
+}
+
+Qwen2Session::~Qwen2Session() {
+    if (manager_) manager_->detach(*this);
+}
+
+int64_t Qwen2Session::infer(const int64_t* tokens, size_t n) {
+    CHECK_ARGUMENT(n > 0, "Qwen2Session: empty input");
+    CHECK_ARGUMENT(length() + n <= model_.config().maxseq, "Qwen2Session: session exceeds maxseq");
+    
+    // 前向期间会话不会被驱逐；结束后（包括异常）按实际占用重新记账
+    bool reprefill = manager_ && manager_->acquire(*this, length() + n);
+    struct Release {
+        Qwen2Session* session;
+        ~Release() {
+            if (session->manager_) session->manager_->release(*session);
+        }
+    } release{this};
+    
+    std::lock_guard<std::mutex> lock(model_.mutex());
+    if (reprefill && !tokens_.empty()) {
+        model_.prefill(*kv_, tokens_.data(), tokens_.size());
+    }
+    int64_t next = model_.infer(*kv_, tokens, n);
+    tokens_.insert(tokens_.end(), tokens, tokens + n);
+    return next;
+}
+
+void Qwen2Session::reset() {
+    if (manager_) {
+        manager_->reset(*this);
+    } else {
+        kv_->reset_all();
+    }
+    tokens_.clear();
+}
+
+} // namespace llaisys::models
@@ -0,0 +1,36 @@
+#pragma once
+#include "qwen2_model.hpp"
+#include "kv_manager.hpp"
+#include <memory>
+#include <vector>
+
+namespace llaisys::models {
+
+// 会话：一段对话独立的 KV-Cache、位置与 token 历史，与同一模型的其他会话共享权重。
+// 每个会话额外占用的内存只有其 KV-Cache（按实际长度增长）。
+// 不同线程可以同时使用不同的会话，前向在模型的 mutex() 上串行执行。
+// 指定 manager 时 KV 占用计入其预算，空闲时可能被驱逐，下次使用时自动恢复。
+class Qwen2Session {
+public:
+    explicit Qwen2Session(Qwen2Model& model, KVMemoryManager* manager = nullptr);
+    ~Qwen2Session();
+
+    // 在会话末尾追加 token（新一轮的 prompt 或上一步生成的 token），返回下一个 token
+    int64_t infer(const int64_t* token_ids, size_t ntoken);
+    void reset();
+
+    // 已写入的 token 数，即下一个 token 的位置（KV 被驱逐时仍保持不变）
+    size_t length() const { return tokens_.size(); }
+    const std::vector<int64_t>& tokens() const { return tokens_; }
+    size_t kv_bytes() const { return kv_->bytes(); }
+    ModelKVCache& kv_cache() { return *kv_; }
+    Qwen2Model& model() { return model_; }
+
+private:
+    Qwen2Model& model_;
+    KVMemoryManager* manager_;
+    std::unique_ptr<ModelKVCache> kv_;
+    std::vector<int64_t> tokens_;
+};
+
+} // namespace llaisys::models
@@ -0,0 +1,99 @@
+#include "shared_weights.hpp"
+#include "../../utils.hpp"
+#include <cstdio>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace llaisys::models {
+
+#if !defined(_WIN32)
+
+namespace {
+
+int open_lock(const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    CHECK_ARGUMENT(fd >= 0, "SharedWeights: cannot open " + path);
+    return fd;
+}
+
+// 在作用域内持有排他锁
+class ExclusiveLock {
+public:
+    explicit ExclusiveLock(int fd) : fd_(fd) { flock(fd_, LOCK_EX); }
+    ~ExclusiveLock() { flock(fd_, LOCK_UN); }
+
+private:
+    int fd_;
+};
+
+} // namespace
+
+SharedWeights::SharedWeights(Qwen2Model& model, const std::string& image_path, const std::string& source,
+                             const LoadOptions& options)
+    : path_(image_path), mutex_fd_(open_lock(image_path + ".lock")) {
+    try {
+        ref_fd_ = open_lock(path_ + ".ref");
+        ExclusiveLock lock(mutex_fd_);
+        bool attached = false;
+        if (std::filesystem::exists(path_)) {
+            try {
+                stats_ = load_llaisys(model, path_, options);
+                attached = true;
+            } catch (const std::exception&) {
+                // 残留或配置不符的映像：重新生成，已映射旧映像的进程不受影响
+            }
+        }
+        if (!attached) {
+            bool from_file = std::filesystem::is_regular_file(source);
+            auto built = from_file ? load_llaisys(model, source, options) : load_safetensors(model, source, options);
+            // 先写临时文件再改名，其他进程不会看到写了一半的映像
+            std::string tmp = path_ + ".tmp";
+            save_llaisys(model, tmp);
+            CHECK_ARGUMENT(std::rename(tmp.c_str(), path_.c_str()) == 0, "SharedWeights: cannot create " + path_);
+            stats_ = load_llaisys(model, path_, options);
+            stats_.converted = built.converted;
+            stats_.copied_bytes = built.copied_bytes;
+            stats_.convert_ms = built.convert_ms;
+            created_ = true;
+        }
+        // 持有期间即计入引用
+        flock(ref_fd_, LOCK_SH);
+    } catch (...) {
+        if (ref_fd_ >= 0) close(ref_fd_);
+        close(mutex_fd_);
+        throw;
+    }
+}
+
+SharedWeights::~SharedWeights() {
+    {
+        // 与新的附加互斥，避免删除刚被附加的映像
+        ExclusiveLock lock(mutex_fd_);
+        flock(ref_fd_, LOCK_UN);
+        // 没有其他共享锁时能取得排他锁：本进程是最后一个使用者
+        if (flock(ref_fd_, LOCK_EX | LOCK_NB) == 0) {
+            std::remove(path_.c_str());
+            flock(ref_fd_, LOCK_UN);
+        }
+    }
+    close(ref_fd_);
+    close(mutex_fd_);
+}
+
+#else
+
+SharedWeights::SharedWeights(Qwen2Model&, const std::string& image_path, const std::string&, const LoadOptions&)
+    : path_(image_path) {
+    CHECK_ARGUMENT(false, "SharedWeights: not supported on this platform");
+}
+
+SharedWeights::~SharedWeights() = default;
+
+#endif
+
+} // namespace llaisys::models
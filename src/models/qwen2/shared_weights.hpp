@@ -0,0 +1,38 @@
+#pragma once
+#include "llaisys_file.hpp"
+#include <string>
+
+namespace llaisys::models {
+
+// 多个进程共享同一份只读权重：权重以 .llaisys 映像存放在 image_path（如 /dev/shm 下的文件），
+// 各进程映射同一个文件，未被写过的页只在页缓存中存一份，N 个副本约占 1 份权重的内存。
+//
+// 生命周期按引用计数管理，计数即 image_path + ".ref" 上的共享文件锁（flock），
+// 附加与释放由 image_path + ".lock" 上的排他锁互斥：第一个进程从 source（HuggingFace 目录
+// 或 .llaisys 文件）加载、转换并写出映像，之后的进程直接映射；每个使用者持有共享锁直到析构。
+// 析构时若能取得 .ref 的排他锁，说明已没有其他使用者，删除映像。
+// 进程异常退出时锁由内核释放，计数不会泄漏。
+// 已映射的进程不受映像删除的影响。只支持 POSIX 平台
+class SharedWeights {
+public:
+    SharedWeights(Qwen2Model& model, const std::string& image_path, const std::string& source,
+                  const LoadOptions& options = LoadOptions{});
+    ~SharedWeights();
+
+    SharedWeights(const SharedWeights&) = delete;
+    SharedWeights& operator=(const SharedWeights&) = delete;
+
+    // 本进程是否创建了映像
+    bool created() const { return created_; }
+    // 映射映像的统计；created() 时 converted / copied_bytes 等来自从 source 加载的过程
+    const WeightLoadStats& stats() const { return stats_; }
+
+private:
+    std::string path_;
+    int mutex_fd_ = -1; // 附加 / 释放互斥
+    int ref_fd_ = -1;   // 共享锁即引用
+    bool created_ = false;
+    WeightLoadStats stats_;
+};
+
+} // namespace llaisys::models
@@ -0,0 +1,176 @@
+#include "speculative.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace llaisys::models {
+
+SpeculativeDecoder::SpeculativeDecoder(Qwen2Model& target, Qwen2Model& draft, const SpeculativeParams& params)
+    : target_(target), draft_(draft), params_(params), rng_(params.seed) {
+    CHECK_ARGUMENT(target.config().voc == draft.config().voc, "SpeculativeDecoder: vocabulary size mismatch");
+    CHECK_ARGUMENT(params.temperature <= 0.0f || params.top_k > 0, "SpeculativeDecoder: top_k must be positive");
+    topk_ = params.temperature > 0.0f ? std::min(params.top_k, target.config().voc) : 1;
+    // 验证时一次前向 num_draft + 1 个 token
+    params_.num_draft = std::min(params.num_draft, target.config().max_chunk - 1);
+    target_kv_ = target.create_kv_cache();
+    draft_kv_ = draft.create_kv_cache();
+}
+
+int64_t SpeculativeDecoder::start(const int64_t* prompt, size_t n) {
+    size_t maxseq = std::min(target_.config().maxseq, draft_.config().maxseq);
+    CHECK_ARGUMENT(n > 0, "SpeculativeDecoder: empty prompt");
+    CHECK_ARGUMENT(n < maxseq, "SpeculativeDecoder: prompt exceeds maxseq");
+
+    target_kv_->reset_all();
+    draft_kv_->reset_all();
+    tokens_.assign(prompt, prompt + n);
+    prompt_len_ = n;
+    stats_ = SpeculativeStats{};
+
+    // 草稿模型缺少的 prompt 尾部在第一轮草稿时补上
+    if (n > 1) {
+        target_.prefill(*target_kv_, prompt, n - 1);
+        draft_.prefill(*draft_kv_, prompt, n - 1);
+    }
+    target_idx_.resize(topk_);
+    target_logit_.resize(topk_);
+    target_.forward_topk(*target_kv_, prompt + n - 1, 1, topk_, target_idx_.data(), target_logit_.data());
+    int64_t first = sample(target_idx_.data(), target_logit_.data());
+    tokens_.push_back(first);
+    return first;
+}
+
+size_t SpeculativeDecoder::step(int64_t* out) {
+    ASSERT(!tokens_.empty(), "SpeculativeDecoder: start() has not been called");
+    size_t maxseq = std::min(target_.config().maxseq, draft_.config().maxseq);
+    size_t past = tokens_.size() - 1;
+    if (past >= maxseq) return 0;
+    // 目标模型本轮写入 k + 1 个 token
+    size_t k = std::min(params_.num_draft, maxseq - past - 1);
+    size_t v = topk_;
+
+    // 1. 草稿：第一次前向补上草稿 KV-Cache 落后的 token（至少包括最后一个输出 token）
+    draft_tokens_.clear();
+    draft_idx_.resize(k * v);
+    draft_logit_.resize(k * v);
+    for (size_t i = 0; i < k; ++i) {
+        const int64_t* in = i == 0 ? tokens_.data() + draft_kv_->length() : &draft_tokens_[i - 1];
+        size_t m = i == 0 ? tokens_.size() - draft_kv_->length() : 1;
+        row_idx_.resize(m * v);
+        row_logit_.resize(m * v);
+        draft_.forward_topk(*draft_kv_, in, m, v, row_idx_.data(), row_logit_.data());
+        std::copy_n(row_idx_.end() - v, v, draft_idx_.begin() + i * v);
+        std::copy_n(row_logit_.end() - v, v, draft_logit_.begin() + i * v);
+        draft_tokens_.push_back(sample(&draft_idx_[i * v], &draft_logit_[i * v]));
+    }
+
+    // 2. 验证：最后一个输出 token 与 k 个草稿 token 一次前向，第 i 行给出第 i 个草稿位置的分布
+    draft_tokens_.insert(draft_tokens_.begin(), tokens_.back());
+    target_idx_.resize((k + 1) * v);
+    target_logit_.resize((k + 1) * v);
+    target_.forward_topk(*target_kv_, draft_tokens_.data(), k + 1, v, target_idx_.data(), target_logit_.data());
+    draft_tokens_.erase(draft_tokens_.begin());
+
+    // 3. 逐个接受草稿 token，第一个被拒绝处输出修正 token；全部接受时再从最后一行采样一个
+    size_t n = 0;
+    bool rejected = false;
+    for (size_t i = 0; i < k && !rejected; ++i) {
+        int64_t fix;
+        if (accept(i, &fix)) {
+            out[n++] = draft_tokens_[i];
+        } else {
+            out[n++] = fix;
+            rejected = true;
+        }
+    }
+    if (!rejected) out[n++] = sample(&target_idx_[k * v], &target_logit_[k * v]);
+
+    stats_.rounds++;
+    stats_.drafted += k;
+    stats_.accepted += rejected ? n - 1 : k;
+    stats_.emitted += n;
+
+    // 4. 回滚：两个 KV-Cache 只保留已输出的 token（最后一个除外）。
+    //    草稿全部被接受时草稿模型还缺最后一个草稿 token，下一轮补上
+    tokens_.insert(tokens_.end(), out, out + n);
+    target_kv_->truncate(tokens_.size() - 1);
+    draft_kv_->truncate(tokens_.size() - 1);
+    return n;
+}
+
+bool SpeculativeDecoder::accept(size_t i, int64_t* fix) {
+    size_t v = topk_;
+    const int64_t* tidx = &target_idx_[i * v];
+    const float* tlogit = &target_logit_[i * v];
+    int64_t token = draft_tokens_[i];
+
+    if (params_.temperature <= 0.0f) {
+        *fix = tidx[0];
+        return tidx[0] == token;
+    }
+
+    const int64_t* didx = &draft_idx_[i * v];
+    const float* dlogit = &draft_logit_[i * v];
+    float p = prob_of(tidx, tlogit, token);
+    float q = prob_of(didx, dlogit, token);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    if (uniform(rng_) * q < p) return true;
+
+    // 拒绝：从 max(0, p - q) 归一化后的分布中采样
+    prob_.resize(v);
+    softmax(tlogit, prob_.data());
+    float total = 0.0f;
+    for (size_t j = 0; j < v; ++j) {
+        prob_[j] = std::max(0.0f, prob_[j] - prob_of(didx, dlogit, tidx[j]));
+        total += prob_[j];
+    }
+    if (total <= 0.0f) {
+        *fix = sample(tidx, tlogit);
+        return false;
+    }
+    float r = uniform(rng_) * total;
+    size_t j = 0;
+    for (; j + 1 < v; ++j) {
+        r -= prob_[j];
+        if (r < 0.0f) break;
+    }
+    *fix = tidx[j];
+    return false;
+}
+
+void SpeculativeDecoder::softmax(const float* logit, float* prob) const {
+    size_t v = topk_;
+    float max_l = *std::max_element(logit, logit + v);
+    float sum = 0.0f;
+    for (size_t j = 0; j < v; ++j) {
+        prob[j] = std::exp((logit[j] - max_l) / params_.temperature);
+        sum += prob[j];
+    }
+    for (size_t j = 0; j < v; ++j) prob[j] /= sum;
+}
+
+float SpeculativeDecoder::prob_of(const int64_t* idx, const float* logit, int64_t token) const {
+    size_t v = topk_;
+    const int64_t* it = std::find(idx, idx + v, token);
+    if (it == idx + v) return 0.0f;
+    float max_l = *std::max_element(logit, logit + v);
+    float sum = 0.0f;
+    for (size_t j = 0; j < v; ++j) sum += std::exp((logit[j] - max_l) / params_.temperature);
+    return std::exp((logit[it - idx] - max_l) / params_.temperature) / sum;
+}
+
+int64_t SpeculativeDecoder::sample(const int64_t* idx, const float* logit) {
+    if (params_.temperature <= 0.0f) return idx[0];
+
+    size_t v = topk_;
+    prob_.resize(v);
+    softmax(logit, prob_.data());
+    float r = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng_);
+    for (size_t j = 0; j + 1 < v; ++j) {
+        r -= prob_[j];
+        if (r < 0.0f) return idx[j];
+    }
+    return idx[v - 1];
+}
+
+} // namespace llaisys::models
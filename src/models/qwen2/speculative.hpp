@@ -0,0 +1,73 @@
+#pragma once
+#include "qwen2_model.hpp"
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace llaisys::models {
+
+struct SpeculativeParams {
+    size_t num_draft = 4;      // 每轮草稿 token 数 k
+    float temperature = 0.0f;  // <= 0 为贪心
+    size_t top_k = 1;          // 采样时只在 logits 最大的 top_k 个 token 中采样
+    uint64_t seed = 0;
+};
+
+struct SpeculativeStats {
+    size_t rounds = 0;   // 验证轮数（目标模型前向次数）
+    size_t drafted = 0;  // 草稿 token 总数
+    size_t accepted = 0; // 被接受的草稿 token 数
+    size_t emitted = 0;  // step() 输出的 token 总数（含每轮的修正 / 额外 token）
+};
+
+// 投机解码：小的草稿模型自回归地提出 k 个 token，目标模型一次前向验证全部 k 个，
+// 被拒绝位置之后的 KV 条目在两个模型中都回滚。
+// 贪心模式下输出与目标模型逐 token 贪心解码完全一致；采样模式用拒绝采样
+// （接受概率 min(1, p/q)，拒绝时从 max(0, p - q) 重新采样），输出分布与目标模型
+// 按 temperature / top_k 直接采样相同。两个模型必须共享词表。
+class SpeculativeDecoder {
+public:
+    SpeculativeDecoder(Qwen2Model& target, Qwen2Model& draft, const SpeculativeParams& params);
+
+    // 预填充 prompt，返回第一个生成的 token
+    int64_t start(const int64_t* prompt, size_t ntoken);
+    // 执行一轮草稿 + 验证，把本轮输出的 token（1 到 num_draft + 1 个）写入 out，返回个数。
+    // 序列到达任一模型的 maxseq 时返回 0
+    size_t step(int64_t* out);
+
+    const SpeculativeStats& stats() const { return stats_; }
+    // 已生成的 token（不含 prompt）
+    size_t num_generated() const { return tokens_.size() - prompt_len_; }
+
+private:
+    Qwen2Model& target_;
+    Qwen2Model& draft_;
+    SpeculativeParams params_;
+    size_t topk_; // 贪心时为 1
+    std::unique_ptr<ModelKVCache> target_kv_;
+    std::unique_ptr<ModelKVCache> draft_kv_;
+    std::mt19937_64 rng_;
+    SpeculativeStats stats_;
+
+    // prompt 与已输出的全部 token；两个 KV-Cache 不含最后一个 token
+    std::vector<int64_t> tokens_;
+    size_t prompt_len_ = 0;
+
+    // 每轮的暂存
+    std::vector<int64_t> draft_tokens_;
+    std::vector<int64_t> draft_idx_, target_idx_;
+    std::vector<float> draft_logit_, target_logit_;
+    std::vector<int64_t> row_idx_;
+    std::vector<float> row_logit_;
+    std::vector<float> prob_;
+
+    // 由一行 top-k logits 得到概率（prob_ 中与 idx 对齐）并按其采样
+    int64_t sample(const int64_t* idx, const float* logit);
+    // 行内 token 的概率，不在 top-k 中为 0
+    float prob_of(const int64_t* idx, const float* logit, int64_t token) const;
+    void softmax(const float* logit, float* prob) const;
+    // 第 i 个草稿 token 是否被接受；拒绝时 *fix 为修正 token
+    bool accept(size_t i, int64_t* fix);
+};
+
+} // namespace llaisys::models
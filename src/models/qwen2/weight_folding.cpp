@@ -0,0 +1,137 @@
+#include "qwen2_model.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace llaisys::models {
+
+namespace {
+
+float load(const std::byte* src, llaisysDataType_t dtype, size_t i) {
+    switch (dtype) {
+    case LLAISYS_DTYPE_F32:
+        return reinterpret_cast<const float*>(src)[i];
+    case LLAISYS_DTYPE_F16:
+        return utils::cast<float>(reinterpret_cast<const fp16_t*>(src)[i]);
+    case LLAISYS_DTYPE_BF16:
+        return utils::cast<float>(reinterpret_cast<const bf16_t*>(src)[i]);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(dtype);
+    }
+}
+
+void store(std::byte* dst, llaisysDataType_t dtype, size_t i, float v) {
+    switch (dtype) {
+    case LLAISYS_DTYPE_F32:
+        reinterpret_cast<float*>(dst)[i] = v;
+        break;
+    case LLAISYS_DTYPE_F16:
+        reinterpret_cast<fp16_t*>(dst)[i] = utils::cast<fp16_t>(v);
+        break;
+    case LLAISYS_DTYPE_BF16:
+        reinterpret_cast<bf16_t*>(dst)[i] = utils::cast<bf16_t>(v);
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(dtype);
+    }
+}
+
+// dst[r, k] = src[r, k] * scale[k]，dst 可以是更大张量中的若干行
+void scale_columns(std::byte* dst, const tensor_t& src, const std::vector<float>& scale) {
+    size_t cols = scale.size();
+    size_t rows = src->numel() / cols;
+    auto dtype = src->dtype();
+    const std::byte* s = src->data();
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t k = 0; k < cols; ++k) {
+            store(dst, dtype, r * cols + k, load(s, dtype, r * cols + k) * scale[k]);
+        }
+    }
+}
+
+std::vector<float> to_float(const tensor_t& t) {
+    std::vector<float> v(t->numel());
+    for (size_t i = 0; i < v.size(); ++i) v[i] = load(t->data(), t->dtype(), i);
+    return v;
+}
+
+} // namespace
+
+void Qwen2Model::fold_norm_weights() {
+    if (norm_folded_) return;
+    const auto& c = config_;
+    CHECK_ARGUMENT(c.device_type == LLAISYS_DEVICE_CPU, "fold_norm_weights: weights must be on CPU");
+    CHECK_ARGUMENT(c.dtype == LLAISYS_DTYPE_F32 || c.dtype == LLAISYS_DTYPE_F16 || c.dtype == LLAISYS_DTYPE_BF16,
+                   "fold_norm_weights: unsupported weight dtype");
+
+    const size_t qdim = c.nh * c.dh;
+    const size_t kvdim = c.nkvh * c.dh;
+    const size_t esize = utils::dsize(c.dtype);
+    auto create = [&](const std::vector<size_t>& shape) { return Tensor::create(shape, c.dtype, c.device_type, c.device_id); };
+
+    // 折叠后的 norm 权重全为 1，保存下来的模型仍可按未优化的路径计算
+    auto ones = create({c.hs});
+    for (size_t i = 0; i < c.hs; ++i) store(ones->data(), c.dtype, i, 1.0f);
+
+    // 先在当前线程上分配，再按层并行填充
+    std::vector<tensor_t> qkv_w(c.nlayer), qkv_b(c.nlayer), gate(c.nlayer), up(c.nlayer);
+    for (size_t l = 0; l < c.nlayer; ++l) {
+        qkv_w[l] = create({qdim + 2 * kvdim, c.hs});
+        qkv_b[l] = create({qdim + 2 * kvdim});
+        gate[l] = create({c.di, c.hs});
+        up[l] = create({c.di, c.hs});
+    }
+
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t l; (l = next.fetch_add(1)) < c.nlayer;) {
+            // rms_norm(x) * g 再乘 W，等于 rms_norm(x) 乘 W * diag(g)
+            auto g = to_float(attn_norm_w_[l]);
+            std::byte* w = qkv_w[l]->data();
+            scale_columns(w, q_proj_w_[l], g);
+            scale_columns(w + qdim * c.hs * esize, k_proj_w_[l], g);
+            scale_columns(w + (qdim + kvdim) * c.hs * esize, v_proj_w_[l], g);
+
+            // 偏置在归一化之后相加，只需拼接
+            std::byte* b = qkv_b[l]->data();
+            std::memcpy(b, q_proj_b_[l]->data(), qdim * esize);
+            std::memcpy(b + qdim * esize, k_proj_b_[l]->data(), kvdim * esize);
+            std::memcpy(b + (qdim + kvdim) * esize, v_proj_b_[l]->data(), kvdim * esize);
+
+            g = to_float(mlp_norm_w_[l]);
+            scale_columns(gate[l]->data(), gate_proj_w_[l], g);
+            scale_columns(up[l]->data(), up_proj_w_[l], g);
+        }
+    };
+    size_t nthreads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), c.nlayer));
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < nthreads; ++t) workers.emplace_back(work);
+    work();
+    for (auto& t : workers) t.join();
+
+    for (size_t l = 0; l < c.nlayer; ++l) {
+        const auto& w = qkv_w[l];
+        const auto& b = qkv_b[l];
+        q_proj_w_[l] = w->slice(0, 0, qdim);
+        k_proj_w_[l] = w->slice(0, qdim, qdim + kvdim);
+        v_proj_w_[l] = w->slice(0, qdim + kvdim, qdim + 2 * kvdim);
+        q_proj_b_[l] = b->slice(0, 0, qdim);
+        k_proj_b_[l] = b->slice(0, qdim, qdim + kvdim);
+        v_proj_b_[l] = b->slice(0, qdim + kvdim, qdim + 2 * kvdim);
+        gate_proj_w_[l] = gate[l];
+        up_proj_w_[l] = up[l];
+        attn_norm_w_[l] = ones;
+        mlp_norm_w_[l] = ones;
+    }
+    qkv_proj_w_ = std::move(qkv_w);
+    qkv_proj_b_ = std::move(qkv_b);
+
+    norm_folded_ = true;
+    // q/k/v 的激活布局随之改变，重新绑定视图
+    acts_.seq = 0;
+    weights_replaced();
+}
+
+} // namespace llaisys::models
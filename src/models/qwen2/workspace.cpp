@@ -0,0 +1,58 @@
+#include "workspace.hpp"
+#include "../../utils.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace llaisys::models {
+
+size_t Workspace::declare(size_t bytes, size_t first_step, size_t last_step) {
+    ASSERT(!_storage, "Workspace: cannot declare buffers after plan()");
+    ASSERT(first_step <= last_step, "Workspace: invalid live range");
+    size_t aligned = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    _buffers.push_back(Buffer{aligned, first_step, last_step, 0});
+    return _buffers.size() - 1;
+}
+
+void Workspace::plan(llaisysDeviceType_t device_type, int device_id) {
+    // 大缓冲区优先放置；每个缓冲区放在与已放置、且存活区间相交的缓冲区之间
+    // 第一个足够大的空隙里（贪心 first-fit）
+    std::vector<size_t> order(_buffers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return _buffers[a].bytes > _buffers[b].bytes;
+    });
+
+    std::vector<size_t> placed;
+    _total_bytes = 0;
+    for (size_t id : order) {
+        Buffer& buf = _buffers[id];
+        std::vector<const Buffer*> live;
+        for (size_t other : placed) {
+            const Buffer& o = _buffers[other];
+            if (o.first <= buf.last && buf.first <= o.last) live.push_back(&o);
+        }
+        std::sort(live.begin(), live.end(), [](const Buffer* a, const Buffer* b) { return a->offset < b->offset; });
+
+        size_t offset = 0;
+        for (const Buffer* o : live) {
+            if (offset + buf.bytes <= o->offset) break;
+            offset = std::max(offset, o->offset + o->bytes);
+        }
+        buf.offset = offset;
+        _total_bytes = std::max(_total_bytes, offset + buf.bytes);
+        placed.push_back(id);
+    }
+
+    core::context().setDevice(device_type, device_id);
+    _storage = core::context().runtime().allocateDeviceStorage(std::max(_total_bytes, ALIGNMENT));
+}
+
+tensor_t Workspace::tensor(size_t id, const std::vector<size_t>& shape, llaisysDataType_t dtype) const {
+    ASSERT(_storage, "Workspace: plan() has not been called");
+    ASSERT(id < _buffers.size(), "Workspace: invalid buffer id");
+    size_t numel = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+    ASSERT(numel * utils::dsize(dtype) <= _buffers[id].bytes, "Workspace: view exceeds buffer size");
+    return Tensor::createOnStorage(_storage, _buffers[id].offset, shape, dtype);
+}
+
+} // namespace llaisys::models
@@ -0,0 +1,38 @@
+#pragma once
+#include "../../tensor/tensor.hpp"
+#include <vector>
+
+namespace llaisys::models {
+
+// 激活工作区：前向用到的所有中间张量都从一块预先分配的内存中切出。
+// 每个缓冲区声明自己的存活区间（算子步编号，闭区间），plan() 按区间做静态
+// 规划，生命周期不重叠的缓冲区共享同一段内存。
+class Workspace {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    // 声明一个缓冲区，返回其 id；必须在 plan() 之前调用
+    size_t declare(size_t bytes, size_t first_step, size_t last_step);
+
+    // 计算各缓冲区偏移并一次性申请内存
+    void plan(llaisysDeviceType_t device_type, int device_id);
+
+    // 在缓冲区 id 的起始处创建张量视图（不分配内存）
+    tensor_t tensor(size_t id, const std::vector<size_t>& shape, llaisysDataType_t dtype) const;
+
+    size_t bytes() const { return _total_bytes; }
+
+private:
+    struct Buffer {
+        size_t bytes;
+        size_t first;
+        size_t last;
+        size_t offset;
+    };
+
+    std::vector<Buffer> _buffers;
+    size_t _total_bytes = 0;
+    core::storage_t _storage;
+};
+
+} // namespace llaisys::models
@@ -1,6 +1,7 @@
 #include "add_cpu.hpp"
 
 #include "../../../utils.hpp"
+#include "../../elementwise/cpu/elementwise_cpu.hpp"
 
 #include <cmath>
 
@@ -30,4 +31,21 @@ void add(std::byte *c, const std::byte *a, const std::byte *b, llaisysDataType_t
         EXCEPTION_UNSUPPORTED_DATATYPE(type);
     }
 }
+
+void add(std::byte *c, const std::byte *a, const std::byte *b, llaisysDataType_t type, const ElementwiseLoop<3> &loop) {
+    if (loop.contiguous()) {
+        return add(c, a, b, type, loop.numel);
+    }
+    auto f = [](float x, float y) { return x + y; };
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return elementwise_binary<float>(loop, c, a, b, f);
+    case LLAISYS_DTYPE_BF16:
+        return elementwise_binary<llaisys::bf16_t>(loop, c, a, b, f);
+    case LLAISYS_DTYPE_F16:
+        return elementwise_binary<llaisys::fp16_t>(loop, c, a, b, f);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
 } // namespace llaisys::ops::cpu
@@ -1,8 +1,12 @@
 #pragma once
 #include "llaisys.h"
 
+#include "../../elementwise/elementwise.hpp"
+
 #include <cstddef>
 
 namespace llaisys::ops::cpu {
 void add(std::byte *c, const std::byte *a, const std::byte *b, llaisysDataType_t type, size_t size);
-}
\ No newline at end of file
+// Strided / broadcast operands, see ElementwiseLoop
+void add(std::byte *c, const std::byte *a, const std::byte *b, llaisysDataType_t type, const ElementwiseLoop<3> &loop);
+}
@@ -8,21 +8,20 @@
 namespace llaisys::ops {
 void add(tensor_t c, tensor_t a, tensor_t b) {
     CHECK_SAME_DEVICE(c, a, b);
-    // Only support contiguous inputs with same shape for now.
-    CHECK_SAME_SHAPE(c->shape(), a->shape(), b->shape());
     CHECK_SAME_DTYPE(c->dtype(), a->dtype(), b->dtype());
-    ASSERT(c->isContiguous() && a->isContiguous() && b->isContiguous(), "Add: all tensors must be contiguous.");
+    // a and b may be any views broadcastable to c's shape
+    auto loop = elementwise_loop<3>(c, {a, b});
 
     // always support cpu calculation
     if (c->deviceType() == LLAISYS_DEVICE_CPU) {
-        return cpu::add(c->data(), a->data(), b->data(), c->dtype(), c->numel());
+        return cpu::add(c->data(), a->data(), b->data(), c->dtype(), loop);
     }
 
     llaisys::core::context().setDevice(c->deviceType(), c->deviceId());
 
     switch (c->deviceType()) {
     case LLAISYS_DEVICE_CPU:
-        return cpu::add(c->data(), a->data(), b->data(), c->dtype(), c->numel());
+        return cpu::add(c->data(), a->data(), b->data(), c->dtype(), loop);
 #ifdef ENABLE_NVIDIA_API
     case LLAISYS_DEVICE_NVIDIA:
         TO_BE_IMPLEMENTED();
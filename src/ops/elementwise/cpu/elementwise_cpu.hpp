@@ -0,0 +1,124 @@
+#pragma once
+#include "../elementwise.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace llaisys::ops::cpu {
+
+constexpr size_t ELEMENTWISE_CHUNK = 4096;           // elements per inner run
+constexpr size_t ELEMENTWISE_PARALLEL_NUMEL = 32768; // smaller loops stay on the calling thread
+
+// Calls body(offsets, n, inner_strides) for every run of the innermost dim, split into
+// chunks of at most ELEMENTWISE_CHUNK elements that are spread across OpenMP threads.
+// Offsets and strides are in elements, per operand.
+template <size_t N, typename F>
+void elementwise_for_each(const ElementwiseLoop<N> &loop, F &&body) {
+    if (loop.numel == 0) {
+        return;
+    }
+    std::array<ptrdiff_t, N> inner_strides;
+    inner_strides.fill(1);
+    size_t inner = 1;
+    std::vector<size_t> outer;
+    std::vector<std::array<ptrdiff_t, N>> outer_strides;
+    if (!loop.shape.empty()) {
+        inner = loop.shape.back();
+        inner_strides = loop.strides.back();
+        outer.assign(loop.shape.begin(), loop.shape.end() - 1);
+        outer_strides.assign(loop.strides.begin(), loop.strides.end() - 1);
+    }
+    const size_t nchunk = (inner + ELEMENTWISE_CHUNK - 1) / ELEMENTWISE_CHUNK;
+    std::array<ptrdiff_t, N> chunk_strides;
+    for (size_t k = 0; k < N; k++) {
+        chunk_strides[k] = inner_strides[k] * (ptrdiff_t)ELEMENTWISE_CHUNK;
+    }
+    outer.push_back(nchunk);
+    outer_strides.push_back(chunk_strides);
+
+    size_t count = 1;
+    for (auto n : outer) {
+        count *= n;
+    }
+
+    #pragma omp parallel if (loop.numel >= ELEMENTWISE_PARALLEL_NUMEL && count > 1)
+    {
+#ifdef _OPENMP
+        size_t nt = static_cast<size_t>(omp_get_num_threads());
+        size_t t = static_cast<size_t>(omp_get_thread_num());
+#else
+        size_t nt = 1;
+        size_t t = 0;
+#endif
+        size_t begin = count * t / nt;
+        size_t end = count * (t + 1) / nt;
+        if (begin < end) {
+            std::vector<size_t> idx(outer.size());
+            std::array<ptrdiff_t, N> off{};
+            size_t rem = begin;
+            for (size_t d = outer.size(); d-- > 0;) {
+                idx[d] = rem % outer[d];
+                rem /= outer[d];
+                for (size_t k = 0; k < N; k++) {
+                    off[k] += (ptrdiff_t)idx[d] * outer_strides[d][k];
+                }
+            }
+            for (size_t i = begin; i < end; i++) {
+                size_t c = i % nchunk;
+                body(off, std::min(ELEMENTWISE_CHUNK, inner - c * ELEMENTWISE_CHUNK), inner_strides);
+                for (size_t d = outer.size(); d-- > 0;) {
+                    for (size_t k = 0; k < N; k++) {
+                        off[k] += outer_strides[d][k];
+                    }
+                    if (++idx[d] < outer[d]) {
+                        break;
+                    }
+                    for (size_t k = 0; k < N; k++) {
+                        off[k] -= (ptrdiff_t)outer[d] * outer_strides[d][k];
+                    }
+                    idx[d] = 0;
+                }
+            }
+        }
+    }
+}
+
+// out = f(a, b) computed in float, over any strides / broadcast described by `loop`.
+// Dense runs and runs with one broadcast scalar input get their own vectorizable loops.
+template <typename T, typename F>
+void elementwise_binary(const ElementwiseLoop<3> &loop, std::byte *out, const std::byte *a, const std::byte *b, F f) {
+    T *o = reinterpret_cast<T *>(out);
+    const T *x = reinterpret_cast<const T *>(a);
+    const T *y = reinterpret_cast<const T *>(b);
+    elementwise_for_each(loop, [&](const std::array<ptrdiff_t, 3> &off, size_t n, const std::array<ptrdiff_t, 3> &s) {
+        T *po = o + off[0];
+        const T *pa = x + off[1];
+        const T *pb = y + off[2];
+        if (s[0] == 1 && s[1] == 1 && s[2] == 1) {
+            #pragma omp simd
+            for (size_t i = 0; i < n; i++) {
+                po[i] = utils::cast<T>(f(utils::cast<float>(pa[i]), utils::cast<float>(pb[i])));
+            }
+        } else if (s[0] == 1 && s[1] == 1 && s[2] == 0) {
+            const float vb = utils::cast<float>(*pb);
+            #pragma omp simd
+            for (size_t i = 0; i < n; i++) {
+                po[i] = utils::cast<T>(f(utils::cast<float>(pa[i]), vb));
+            }
+        } else if (s[0] == 1 && s[1] == 0 && s[2] == 1) {
+            const float va = utils::cast<float>(*pa);
+            #pragma omp simd
+            for (size_t i = 0; i < n; i++) {
+                po[i] = utils::cast<T>(f(va, utils::cast<float>(pb[i])));
+            }
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                ptrdiff_t j = (ptrdiff_t)i;
+                po[j * s[0]] = utils::cast<T>(f(utils::cast<float>(pa[j * s[1]]), utils::cast<float>(pb[j * s[2]])));
+            }
+        }
+    });
+}
+
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <vector>
+
+namespace llaisys::ops {
+
+// Iteration plan of an elementwise op over N operands, operand 0 being the output.
+// Inputs are broadcast to the output shape (trailing dims aligned, a broadcast dim gets
+// stride 0), size-1 dims are dropped and dims that are contiguous with each other in
+// every operand are merged, so dense operands end up as one dim of unit strides.
+template <size_t N>
+struct ElementwiseLoop {
+    std::vector<size_t> shape;                     // outermost first
+    std::vector<std::array<ptrdiff_t, N>> strides; // in elements, per dim and operand
+    size_t numel = 1;
+
+    // All operands dense with the same layout
+    bool contiguous() const {
+        if (shape.size() > 1) {
+            return false;
+        }
+        for (const auto &dim : strides) {
+            for (auto s : dim) {
+                if (s != 1) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+template <size_t N>
+ElementwiseLoop<N> elementwise_loop(const tensor_t &out, const std::array<tensor_t, N - 1> &ins) {
+    const auto &shape = out->shape();
+    const size_t ndim = shape.size();
+    for (const auto &in : ins) {
+        CHECK_ARGUMENT(in->ndim() <= ndim, "elementwise: input has more dims than the output");
+    }
+
+    ElementwiseLoop<N> loop;
+    std::vector<size_t> dims;
+    std::vector<std::array<ptrdiff_t, N>> strides;
+    for (size_t d = 0; d < ndim; d++) {
+        std::array<ptrdiff_t, N> st;
+        st[0] = out->strides()[d];
+        for (size_t k = 0; k + 1 < N; k++) {
+            const auto &in = ins[k];
+            size_t lead = ndim - in->ndim();
+            if (d < lead || in->shape()[d - lead] == 1) {
+                st[k + 1] = 0;
+            } else if (in->shape()[d - lead] == shape[d]) {
+                st[k + 1] = in->strides()[d - lead];
+            } else {
+                EXCEPTION_SHAPE_MISMATCH;
+            }
+        }
+        loop.numel *= shape[d];
+        if (shape[d] != 1) {
+            dims.push_back(shape[d]);
+            strides.push_back(st);
+        }
+    }
+
+    // Loop order follows the output so writes stream, whatever views the inputs are
+    std::vector<size_t> order(dims.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return std::abs(strides[a][0]) > std::abs(strides[b][0]); });
+
+    for (auto i : order) {
+        if (!loop.shape.empty()) {
+            auto &outer = loop.strides.back();
+            bool mergeable = true;
+            for (size_t k = 0; k < N; k++) {
+                mergeable = mergeable && outer[k] == strides[i][k] * (ptrdiff_t)dims[i];
+            }
+            if (mergeable) {
+                loop.shape.back() *= dims[i];
+                outer = strides[i];
+                continue;
+            }
+        }
+        loop.shape.push_back(dims[i]);
+        loop.strides.push_back(strides[i]);
+    }
+    return loop;
+}
+
+} // namespace llaisys::ops
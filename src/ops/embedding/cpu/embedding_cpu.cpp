@@ -1,37 +1,59 @@
 #include "embedding_cpu.hpp"
 #include "../../../utils.hpp"
 #include <cstring>
+#include <type_traits>
 
 namespace llaisys::ops::cpu {
 
-template <typename T>
-void embedding_impl(T* out, const int64_t* idx, const T* weight, size_t n, size_t dim) {
+template <typename T, typename W>
+void embedding_impl(T* out, const int64_t* idx, const W* weight, size_t n, size_t dim) {
     #pragma omp parallel for schedule(static)
     for (int64_t i = 0; i < static_cast<int64_t>(n); ++i) {
         int64_t row = idx[i];
-        std::memcpy(out + i * dim, weight + row * dim, dim * sizeof(T));
+        if constexpr (std::is_same_v<T, W>) {
+            std::memcpy(out + i * dim, weight + row * dim, dim * sizeof(T));
+        } else {
+            const W* src = weight + row * dim;
+            T* dst = out + i * dim;
+            for (size_t j = 0; j < dim; ++j) dst[j] = llaisys::utils::cast<T>(llaisys::utils::cast<float>(src[j]));
+        }
     }
 }
 
-void embedding(std::byte* out, const std::byte* index, const std::byte* weight, 
-               llaisysDataType_t dtype, size_t num_indices, size_t weight_dim) {
+template <typename T>
+void embedding_weight(T* out, const int64_t* idx, const std::byte* weight, llaisysDataType_t weight_dtype,
+                      size_t n, size_t dim) {
+    switch (weight_dtype) {
+    case LLAISYS_DTYPE_F32:
+        embedding_impl(out, idx, reinterpret_cast<const float*>(weight), n, dim);
+        break;
+    case LLAISYS_DTYPE_F16:
+        embedding_impl(out, idx, reinterpret_cast<const fp16_t*>(weight), n, dim);
+        break;
+    case LLAISYS_DTYPE_BF16:
+        embedding_impl(out, idx, reinterpret_cast<const bf16_t*>(weight), n, dim);
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(weight_dtype);
+    }
+}
+
+void embedding(std::byte* out, const std::byte* index, const std::byte* weight, llaisysDataType_t dtype,
+               llaisysDataType_t weight_dtype, size_t num_indices, size_t weight_dim) {
     const int64_t* idx = reinterpret_cast<const int64_t*>(index);
 
     switch (dtype) {
     case LLAISYS_DTYPE_F32:
-        embedding_impl<float>(reinterpret_cast<float*>(out), idx, 
-                              reinterpret_cast<const float*>(weight), num_indices, weight_dim);
+        embedding_weight(reinterpret_cast<float*>(out), idx, weight, weight_dtype, num_indices, weight_dim);
         break;
     case LLAISYS_DTYPE_F16:
-        embedding_impl<fp16_t>(reinterpret_cast<fp16_t*>(out), idx, 
-                               reinterpret_cast<const fp16_t*>(weight), num_indices, weight_dim);
+        embedding_weight(reinterpret_cast<fp16_t*>(out), idx, weight, weight_dtype, num_indices, weight_dim);
         break;
     case LLAISYS_DTYPE_BF16:
-        embedding_impl<bf16_t>(reinterpret_cast<bf16_t*>(out), idx, 
-                                reinterpret_cast<const bf16_t*>(weight), num_indices, weight_dim);
+        embedding_weight(reinterpret_cast<bf16_t*>(out), idx, weight, weight_dtype, num_indices, weight_dim);
         break;
     default:
-        break;
+        EXCEPTION_UNSUPPORTED_DATATYPE(dtype);
     }
 }
 
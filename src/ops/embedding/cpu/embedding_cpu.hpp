@@ -3,5 +3,7 @@
 #include <cstddef>
 
 namespace llaisys::ops::cpu {
-void embedding(std::byte* out, const std::byte* index, const std::byte* weight, llaisysDataType_t dtype, size_t num_indices, size_t weight_dim);
+// out uses `dtype`, weight uses `weight_dtype`; rows are copied as-is when they match, converted otherwise
+void embedding(std::byte* out, const std::byte* index, const std::byte* weight, llaisysDataType_t dtype,
+               llaisysDataType_t weight_dtype, size_t num_indices, size_t weight_dim);
 } // namespace llaisys::ops::cpu
@@ -1,52 +1,119 @@
 #include "linear_cpu.hpp"
 #include "../../../utils.hpp"
+#include <algorithm>
 #include <cstring>
+#include <type_traits>
+#include <vector>
 
 namespace llaisys::ops::cpu {
 
+namespace {
+// Widen n values to f32. bf16 is the upper half of an f32, so it widens with a
+// shift instead of a call per element.
 template <typename T>
-void linear_impl(T* out, const T* in, const T* weight, const T* bias,
+inline void widen(float* dst, const T* src, size_t n) {
+    if constexpr (std::is_same_v<T, bf16_t>) {
+        for (size_t k = 0; k < n; ++k) {
+            uint32_t bits = static_cast<uint32_t>(src[k]._v) << 16;
+            std::memcpy(dst + k, &bits, sizeof(float));
+        }
+    } else {
+        for (size_t k = 0; k < n; ++k) dst[k] = llaisys::utils::cast<float>(src[k]);
+    }
+}
+} // namespace
+
+template <typename T, typename W>
+void linear_impl(T* out, const T* in, const W* weight, const W* bias,
                  size_t batch, size_t in_features, size_t out_features) {
-    int64_t total = static_cast<int64_t>(batch * out_features);
-    
+    // Parallel over blocks of output features. Each block of weight rows stays in
+    // cache while every input row is applied to it, so a batch of B rows reads the
+    // weights once instead of B times.
+    const size_t block = batch > 1 ? 16 : 1;
+    int64_t nblock = static_cast<int64_t>((out_features + block - 1) / block);
+
+    // Half-precision operands are widened once up front (inputs) or once per block
+    // (weights) rather than inside the dot product; widening is exact, so results
+    // are unchanged.
+    thread_local std::vector<float> xbuf;
+    const float* xs = nullptr;
+    if constexpr (std::is_same_v<T, float>) {
+        xs = in;
+    } else {
+        xbuf.resize(batch * in_features);
+        widen(xbuf.data(), in, batch * in_features);
+        xs = xbuf.data();
+    }
+
     #pragma omp parallel for schedule(static)
-    for (int64_t idx = 0; idx < total; ++idx) {
-        size_t i = idx / out_features;
-        size_t j = idx % out_features;
-        
-        const T* x = in + i * in_features;
-        const T* w = weight + j * in_features;
-        
-        float sum = 0.0f;
-        for (size_t k = 0; k < in_features; ++k) {
-            sum += llaisys::utils::cast<float>(x[k]) * llaisys::utils::cast<float>(w[k]);
+    for (int64_t b = 0; b < nblock; ++b) {
+        size_t j0 = b * block;
+        size_t j1 = std::min(j0 + block, out_features);
+
+        const float* ws = nullptr;
+        if constexpr (std::is_same_v<W, float>) {
+            ws = weight + j0 * in_features;
+        } else {
+            thread_local std::vector<float> wbuf;
+            wbuf.resize(block * in_features);
+            widen(wbuf.data(), weight + j0 * in_features, (j1 - j0) * in_features);
+            ws = wbuf.data();
+        }
+
+        for (size_t i = 0; i < batch; ++i) {
+            const float* x = xs + i * in_features;
+            for (size_t j = j0; j < j1; ++j) {
+                const float* w = ws + (j - j0) * in_features;
+
+                float sum = 0.0f;
+                for (size_t k = 0; k < in_features; ++k) sum += x[k] * w[k];
+                if (bias) sum += llaisys::utils::cast<float>(bias[j]);
+
+                out[i * out_features + j] = llaisys::utils::cast<T>(sum);
+            }
         }
-        if (bias) sum += llaisys::utils::cast<float>(bias[j]);
-        
-        out[i * out_features + j] = llaisys::utils::cast<T>(sum);
+    }
+}
+
+template <typename T>
+void linear_weight(T* out, const T* in, const std::byte* weight, const std::byte* bias, llaisysDataType_t weight_dtype,
+                   size_t batch, size_t in_features, size_t out_features) {
+    switch (weight_dtype) {
+    case LLAISYS_DTYPE_F32:
+        linear_impl(out, in, reinterpret_cast<const float*>(weight), reinterpret_cast<const float*>(bias),
+                    batch, in_features, out_features);
+        break;
+    case LLAISYS_DTYPE_F16:
+        linear_impl(out, in, reinterpret_cast<const fp16_t*>(weight), reinterpret_cast<const fp16_t*>(bias),
+                    batch, in_features, out_features);
+        break;
+    case LLAISYS_DTYPE_BF16:
+        linear_impl(out, in, reinterpret_cast<const bf16_t*>(weight), reinterpret_cast<const bf16_t*>(bias),
+                    batch, in_features, out_features);
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(weight_dtype);
     }
 }
 
 void linear(std::byte* out, const std::byte* in, const std::byte* weight, const std::byte* bias,
-            llaisysDataType_t dtype, size_t batch, size_t in_features, size_t out_features) {
+            llaisysDataType_t dtype, llaisysDataType_t weight_dtype,
+            size_t batch, size_t in_features, size_t out_features) {
     switch (dtype) {
     case LLAISYS_DTYPE_F32:
-        linear_impl<float>(reinterpret_cast<float*>(out), reinterpret_cast<const float*>(in), 
-                           reinterpret_cast<const float*>(weight), reinterpret_cast<const float*>(bias), 
-                           batch, in_features, out_features);
+        linear_weight(reinterpret_cast<float*>(out), reinterpret_cast<const float*>(in), weight, bias, weight_dtype,
+                      batch, in_features, out_features);
         break;
     case LLAISYS_DTYPE_F16:
-        linear_impl<fp16_t>(reinterpret_cast<fp16_t*>(out), reinterpret_cast<const fp16_t*>(in), 
-                            reinterpret_cast<const fp16_t*>(weight), reinterpret_cast<const fp16_t*>(bias), 
-                            batch, in_features, out_features);
+        linear_weight(reinterpret_cast<fp16_t*>(out), reinterpret_cast<const fp16_t*>(in), weight, bias, weight_dtype,
+                      batch, in_features, out_features);
         break;
     case LLAISYS_DTYPE_BF16:
-        linear_impl<bf16_t>(reinterpret_cast<bf16_t*>(out), reinterpret_cast<const bf16_t*>(in), 
-                             reinterpret_cast<const bf16_t*>(weight), reinterpret_cast<const bf16_t*>(bias), 
-                             batch, in_features, out_features);
+        linear_weight(reinterpret_cast<bf16_t*>(out), reinterpret_cast<const bf16_t*>(in), weight, bias, weight_dtype,
+                      batch, in_features, out_features);
         break;
     default:
-        break;
+        EXCEPTION_UNSUPPORTED_DATATYPE(dtype);
     }
 }
 
@@ -3,6 +3,9 @@
 #include <cstddef>
 
 namespace llaisys::ops::cpu {
+// in / out use `dtype`, weight and bias use `weight_dtype`; the two may differ
+// (e.g. bf16 weights applied to f32 activations), accumulation is always f32.
 void linear(std::byte* out, const std::byte* in, const std::byte* weight, const std::byte* bias,
-            llaisysDataType_t dtype, size_t batch, size_t in_features, size_t out_features);
+            llaisysDataType_t dtype, llaisysDataType_t weight_dtype,
+            size_t batch, size_t in_features, size_t out_features);
 } // namespace llaisys::ops::cpu
@@ -12,7 +12,7 @@ void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias) {
         const std::byte* bias_data = bias ? bias->data() : nullptr;
         
         return cpu::linear(out->data(), in->data(), weight->data(), bias_data,
-                           out->dtype(), batch, in_features, out_features);
+                           out->dtype(), weight->dtype(), batch, in_features, out_features);
     }
 
     core::context().setDevice(out->deviceType(), out->deviceId());
@@ -0,0 +1,159 @@
+#include "lm_head_topk_cpu.hpp"
+#include "../../../utils.hpp"
+#include <cmath>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace llaisys::ops::cpu {
+
+namespace {
+struct Candidate {
+    float score;
+    int64_t idx;
+};
+
+// Higher score first; on ties the smaller index wins, same as argmax.
+inline bool better(const Candidate& a, const Candidate& b) {
+    return a.score > b.score || (a.score == b.score && a.idx < b.idx);
+}
+
+// Insert into a best-first list holding at most k candidates.
+inline void push_topk(Candidate* list, size_t& n, size_t k, const Candidate& c) {
+    if (n == k && !better(c, list[k - 1])) return;
+    size_t pos = (n < k) ? n++ : k - 1;
+    while (pos > 0 && better(c, list[pos - 1])) {
+        list[pos] = list[pos - 1];
+        --pos;
+    }
+    list[pos] = c;
+}
+} // namespace
+
+template <typename T, typename W>
+void lm_head_topk_impl(int64_t* idx_out, T* val_out, const T* hidden, const W* norm_w, const W* weight,
+                       size_t nrow, size_t hs, size_t voc, size_t k, float eps) {
+    // scratch buffers are thread_local and only grow, so repeated decode steps do not hit the heap
+    thread_local std::vector<float> x;
+    thread_local std::vector<Candidate> partial;
+    thread_local std::vector<size_t> counts;
+    thread_local std::vector<Candidate> merged;
+
+    // normalized rows, rounded through T exactly like a standalone rms_norm output
+    x.resize(nrow * hs);
+    for (size_t r = 0; r < nrow; ++r) {
+        const T* row = hidden + r * hs;
+        float ss = 0.0f;
+        for (size_t j = 0; j < hs; ++j) {
+            float v = llaisys::utils::cast<float>(row[j]);
+            ss += v * v;
+        }
+        float rms = 1.0f / std::sqrt(ss / hs + eps);
+        for (size_t j = 0; j < hs; ++j) {
+            float v = llaisys::utils::cast<float>(row[j]) * rms * llaisys::utils::cast<float>(norm_w[j]);
+            x[r * hs + j] = llaisys::utils::cast<float>(llaisys::utils::cast<T>(v));
+        }
+    }
+
+#ifdef _OPENMP
+    int nthreads = omp_get_max_threads();
+#else
+    int nthreads = 1;
+#endif
+    partial.resize(static_cast<size_t>(nthreads) * nrow * k);
+    counts.assign(static_cast<size_t>(nthreads) * nrow, 0);
+    // the thread_local names resolve per thread, so hand the workers plain pointers
+    const float* xs = x.data();
+    Candidate* partial_p = partial.data();
+    size_t* counts_p = counts.data();
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+#ifdef _OPENMP
+        size_t tid = static_cast<size_t>(omp_get_thread_num());
+#else
+        size_t tid = 0;
+#endif
+        Candidate* mine = partial_p + tid * nrow * k;
+        size_t* mine_n = counts_p + tid * nrow;
+        // one vocabulary row converted to float, reused by every hidden row
+        thread_local std::vector<float> w;
+        w.resize(hs);
+
+        #pragma omp for schedule(static)
+        for (int64_t j = 0; j < static_cast<int64_t>(voc); ++j) {
+            const W* wj = weight + j * hs;
+            for (size_t c = 0; c < hs; ++c) w[c] = llaisys::utils::cast<float>(wj[c]);
+
+            for (size_t r = 0; r < nrow; ++r) {
+                const float* xr = xs + r * hs;
+                float sum = 0.0f;
+                for (size_t c = 0; c < hs; ++c) sum += xr[c] * w[c];
+                // compare on the rounded logit so the result matches linear + argmax
+                float score = llaisys::utils::cast<float>(llaisys::utils::cast<T>(sum));
+                push_topk(mine + r * k, mine_n[r], k, Candidate{score, j});
+            }
+        }
+    }
+
+    merged.resize(k);
+    for (size_t r = 0; r < nrow; ++r) {
+        size_t n = 0;
+        for (size_t t = 0; t < static_cast<size_t>(nthreads); ++t) {
+            const Candidate* list = partial.data() + (t * nrow + r) * k;
+            for (size_t i = 0; i < counts[t * nrow + r]; ++i) push_topk(merged.data(), n, k, list[i]);
+        }
+        for (size_t i = 0; i < k; ++i) {
+            idx_out[r * k + i] = merged[i].idx;
+            val_out[r * k + i] = llaisys::utils::cast<T>(merged[i].score);
+        }
+    }
+}
+
+template <typename T>
+void lm_head_topk_weight(int64_t* idx, T* val, const T* hidden, const std::byte* norm_w, const std::byte* weight,
+                         llaisysDataType_t weight_dtype, size_t nrow, size_t hs, size_t voc, size_t k, float eps) {
+    switch (weight_dtype) {
+    case LLAISYS_DTYPE_F32:
+        lm_head_topk_impl(idx, val, hidden, reinterpret_cast<const float*>(norm_w), reinterpret_cast<const float*>(weight),
+                          nrow, hs, voc, k, eps);
+        break;
+    case LLAISYS_DTYPE_F16:
+        lm_head_topk_impl(idx, val, hidden, reinterpret_cast<const fp16_t*>(norm_w), reinterpret_cast<const fp16_t*>(weight),
+                          nrow, hs, voc, k, eps);
+        break;
+    case LLAISYS_DTYPE_BF16:
+        lm_head_topk_impl(idx, val, hidden, reinterpret_cast<const bf16_t*>(norm_w), reinterpret_cast<const bf16_t*>(weight),
+                          nrow, hs, voc, k, eps);
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(weight_dtype);
+    }
+}
+
+void lm_head_topk(std::byte* topk_idx, std::byte* topk_val, const std::byte* hidden, const std::byte* norm_w,
+                  const std::byte* weight, llaisysDataType_t dtype, llaisysDataType_t weight_dtype,
+                  size_t nrow, size_t hs, size_t voc, size_t k, float eps) {
+    int64_t* idx = reinterpret_cast<int64_t*>(topk_idx);
+
+    switch (dtype) {
+    case LLAISYS_DTYPE_F32:
+        lm_head_topk_weight(idx, reinterpret_cast<float*>(topk_val), reinterpret_cast<const float*>(hidden),
+                            norm_w, weight, weight_dtype, nrow, hs, voc, k, eps);
+        break;
+    case LLAISYS_DTYPE_F16:
+        lm_head_topk_weight(idx, reinterpret_cast<fp16_t*>(topk_val), reinterpret_cast<const fp16_t*>(hidden),
+                            norm_w, weight, weight_dtype, nrow, hs, voc, k, eps);
+        break;
+    case LLAISYS_DTYPE_BF16:
+        lm_head_topk_weight(idx, reinterpret_cast<bf16_t*>(topk_val), reinterpret_cast<const bf16_t*>(hidden),
+                            norm_w, weight, weight_dtype, nrow, hs, voc, k, eps);
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(dtype);
+    }
+}
+
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,10 @@
+#pragma once
+#include "llaisys.h"
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// hidden / topk_val use `dtype`, norm_w / weight use `weight_dtype`
+void lm_head_topk(std::byte* topk_idx, std::byte* topk_val, const std::byte* hidden, const std::byte* norm_w,
+                  const std::byte* weight, llaisysDataType_t dtype, llaisysDataType_t weight_dtype,
+                  size_t nrow, size_t hs, size_t voc, size_t k, float eps);
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,37 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "cpu/lm_head_topk_cpu.hpp"
+
+namespace llaisys::ops {
+void lm_head_topk(tensor_t topk_idx, tensor_t topk_val, tensor_t hidden, tensor_t norm_w, tensor_t weight, float eps) {
+    CHECK_SAME_DEVICE(topk_idx, topk_val, hidden, norm_w, weight);
+    // activations and weights may differ in dtype (e.g. f32 hidden with bf16 weights)
+    CHECK_SAME_DTYPE(hidden->dtype(), topk_val->dtype());
+    CHECK_SAME_DTYPE(norm_w->dtype(), weight->dtype());
+    ASSERT(topk_idx->dtype() == LLAISYS_DTYPE_I64, "LmHeadTopK: index tensor must be int64.");
+    ASSERT(weight->ndim() == 2, "LmHeadTopK: weight must be 2D [voc, hs].");
+    ASSERT(hidden->isContiguous() && norm_w->isContiguous() && weight->isContiguous()
+               && topk_idx->isContiguous() && topk_val->isContiguous(),
+           "LmHeadTopK: all tensors must be contiguous.");
+
+    size_t hs = weight->shape()[1];
+    size_t voc = weight->shape()[0];
+    ASSERT(hidden->shape().back() == hs && norm_w->numel() == hs, "LmHeadTopK: hidden size mismatch.");
+    size_t nrow = hidden->numel() / hs;
+    size_t k = topk_idx->shape().back();
+    CHECK_SAME_SHAPE(topk_idx->shape(), topk_val->shape());
+    ASSERT(k > 0 && k <= voc && topk_idx->numel() == nrow * k, "LmHeadTopK: output must be [nrow, k] with 0 < k <= voc.");
+
+    if (hidden->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::lm_head_topk(topk_idx->data(), topk_val->data(), hidden->data(), norm_w->data(), weight->data(),
+                                 hidden->dtype(), weight->dtype(), nrow, hs, voc, k, eps);
+    }
+
+    core::context().setDevice(hidden->deviceType(), hidden->deviceId());
+    // TODO: Support GPU
+    TO_BE_IMPLEMENTED();
+}
+} // namespace llaisys::ops
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// Fused final rms_norm + lm_head linear + top-k. Only the k best (index, logit)
+// pairs of each row are written, the full logits are never materialized.
+void lm_head_topk(tensor_t topk_idx, tensor_t topk_val, tensor_t hidden, tensor_t norm_w, tensor_t weight, float eps);
+}
@@ -5,10 +5,9 @@
 #include "argmax/op.hpp"
 #include "embedding/op.hpp"
 #include "linear/op.hpp"
+#include "lm_head_topk/op.hpp"
+#include "rearrange/op.hpp"
 #include "rms_norm/op.hpp"
 #include "rope/op.hpp"
 #include "self_attention/op.hpp"
 #include "swiglu/op.hpp"
-
-// 可选
-// #include "rearrange/op.hpp"
@@ -0,0 +1,211 @@
+#include "rearrange_cpu.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace llaisys::ops::cpu {
+
+namespace {
+
+// one loop of the copy, strides in bytes
+struct Dim {
+    size_t n;
+    ptrdiff_t ds;
+    ptrdiff_t ss;
+};
+
+constexpr size_t TILE = 32;                   // transpose tile edge, in elements
+constexpr size_t ROW_CHUNK = 64 * 1024;       // contiguous runs are split so large copies still parallelize
+constexpr size_t STRIDED_CHUNK = 4096;        // elements per strided inner run
+constexpr size_t PARALLEL_BYTES = 256 * 1024; // smaller copies stay on the calling thread
+
+// Calls body(dst_off, src_off, i) for every flat index i of `outer` (outermost first),
+// splitting the index range evenly across threads
+template <typename F>
+void for_each_outer(const std::vector<Dim>& outer, bool parallel, F&& body) {
+    size_t count = 1;
+    for (const auto& d : outer) count *= d.n;
+
+    #pragma omp parallel if (parallel && count > 1)
+    {
+#ifdef _OPENMP
+        size_t nt = static_cast<size_t>(omp_get_num_threads());
+        size_t t = static_cast<size_t>(omp_get_thread_num());
+#else
+        size_t nt = 1;
+        size_t t = 0;
+#endif
+        size_t begin = count * t / nt;
+        size_t end = count * (t + 1) / nt;
+        if (begin < end) {
+            std::vector<size_t> idx(outer.size());
+            ptrdiff_t doff = 0, soff = 0;
+            size_t rem = begin;
+            for (size_t d = outer.size(); d-- > 0;) {
+                idx[d] = rem % outer[d].n;
+                rem /= outer[d].n;
+                doff += static_cast<ptrdiff_t>(idx[d]) * outer[d].ds;
+                soff += static_cast<ptrdiff_t>(idx[d]) * outer[d].ss;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                body(doff, soff, i);
+                for (size_t d = outer.size(); d-- > 0;) {
+                    doff += outer[d].ds;
+                    soff += outer[d].ss;
+                    if (++idx[d] < outer[d].n) break;
+                    doff -= static_cast<ptrdiff_t>(outer[d].n) * outer[d].ds;
+                    soff -= static_cast<ptrdiff_t>(outer[d].n) * outer[d].ss;
+                    idx[d] = 0;
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void copy_strided(std::byte* dst, ptrdiff_t ds, const std::byte* src, ptrdiff_t ss, size_t n) {
+    T* d = reinterpret_cast<T*>(dst);
+    const T* s = reinterpret_cast<const T*>(src);
+    ptrdiff_t dstep = ds / static_cast<ptrdiff_t>(sizeof(T));
+    ptrdiff_t sstep = ss / static_cast<ptrdiff_t>(sizeof(T));
+    #pragma omp simd
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(n); ++i) d[i * dstep] = s[i * sstep];
+}
+
+// dst is contiguous along the tile rows, src along the tile columns
+template <typename T>
+void copy_tile(std::byte* dst, ptrdiff_t dst_col, const std::byte* src, ptrdiff_t src_row, size_t rows, size_t cols) {
+    T* d = reinterpret_cast<T*>(dst);
+    const T* s = reinterpret_cast<const T*>(src);
+    ptrdiff_t dstep = dst_col / static_cast<ptrdiff_t>(sizeof(T));
+    ptrdiff_t sstep = src_row / static_cast<ptrdiff_t>(sizeof(T));
+    for (ptrdiff_t c = 0; c < static_cast<ptrdiff_t>(cols); ++c) {
+        #pragma omp simd
+        for (ptrdiff_t r = 0; r < static_cast<ptrdiff_t>(rows); ++r) d[c * dstep + r] = s[r * sstep + c];
+    }
+}
+
+void copy_strided_any(std::byte* dst, ptrdiff_t ds, const std::byte* src, ptrdiff_t ss, size_t n, size_t esize) {
+    switch (esize) {
+    case 1:
+        return copy_strided<uint8_t>(dst, ds, src, ss, n);
+    case 2:
+        return copy_strided<uint16_t>(dst, ds, src, ss, n);
+    case 4:
+        return copy_strided<uint32_t>(dst, ds, src, ss, n);
+    case 8:
+        return copy_strided<uint64_t>(dst, ds, src, ss, n);
+    default:
+        for (size_t i = 0; i < n; ++i) std::memcpy(dst + i * ds, src + i * ss, esize);
+    }
+}
+
+void copy_tile_any(std::byte* dst, ptrdiff_t dst_col, const std::byte* src, ptrdiff_t src_row, size_t rows,
+                   size_t cols, size_t esize) {
+    switch (esize) {
+    case 1:
+        return copy_tile<uint8_t>(dst, dst_col, src, src_row, rows, cols);
+    case 2:
+        return copy_tile<uint16_t>(dst, dst_col, src, src_row, rows, cols);
+    case 4:
+        return copy_tile<uint32_t>(dst, dst_col, src, src_row, rows, cols);
+    case 8:
+        return copy_tile<uint64_t>(dst, dst_col, src, src_row, rows, cols);
+    default:
+        for (size_t c = 0; c < cols; ++c) {
+            copy_strided_any(dst + c * dst_col, static_cast<ptrdiff_t>(esize), src + c * esize, src_row, rows, esize);
+        }
+    }
+}
+
+size_t blocks(size_t n, size_t b) {
+    return (n + b - 1) / b;
+}
+
+} // namespace
+
+void rearrange(std::byte* dst, const std::byte* src, size_t esize, size_t ndim, const size_t* shape,
+               const ptrdiff_t* dst_strides, const ptrdiff_t* src_strides) {
+    const ptrdiff_t es = static_cast<ptrdiff_t>(esize);
+    size_t numel = 1;
+    std::vector<Dim> dims;
+    for (size_t i = 0; i < ndim; ++i) {
+        numel *= shape[i];
+        if (shape[i] != 1) dims.push_back({shape[i], dst_strides[i] * es, src_strides[i] * es});
+    }
+    if (numel == 0) return;
+
+    // Loop order follows dst: the smallest dst stride goes innermost so writes stream
+    std::stable_sort(dims.begin(), dims.end(),
+                     [](const Dim& a, const Dim& b) { return std::abs(a.ds) > std::abs(b.ds); });
+    // Coalesce neighbours that are contiguous with each other in both tensors
+    std::vector<Dim> merged;
+    for (const auto& d : dims) {
+        if (!merged.empty()) {
+            auto& outer = merged.back();
+            if (outer.ds == d.ds * static_cast<ptrdiff_t>(d.n) && outer.ss == d.ss * static_cast<ptrdiff_t>(d.n)) {
+                outer = {outer.n * d.n, d.ds, d.ss};
+                continue;
+            }
+        }
+        merged.push_back(d);
+    }
+    if (merged.empty()) {
+        std::memcpy(dst, src, esize);
+        return;
+    }
+
+    const bool parallel = numel * esize >= PARALLEL_BYTES;
+    const Dim inner = merged.back();
+    merged.pop_back();
+
+    // Both sides contiguous along the inner dim: plain memcpy of (chunks of) each run
+    if (inner.ds == es && inner.ss == es) {
+        const size_t row = inner.n * esize;
+        const size_t nchunk = blocks(row, ROW_CHUNK);
+        merged.push_back({nchunk, static_cast<ptrdiff_t>(ROW_CHUNK), static_cast<ptrdiff_t>(ROW_CHUNK)});
+        for_each_outer(merged, parallel, [&](ptrdiff_t doff, ptrdiff_t soff, size_t i) {
+            size_t c = i % nchunk;
+            std::memcpy(dst + doff, src + soff, std::min(ROW_CHUNK, row - c * ROW_CHUNK));
+        });
+        return;
+    }
+
+    // src is contiguous along some outer dim: a transpose, copied in cache-sized tiles
+    auto col_it = std::find_if(merged.begin(), merged.end(), [&](const Dim& d) { return d.ss == es; });
+    if (inner.ds == es && col_it != merged.end()) {
+        const Dim col = *col_it;
+        merged.erase(col_it);
+        const size_t nrb = blocks(inner.n, TILE);
+        const size_t ncb = blocks(col.n, TILE);
+        const ptrdiff_t tile = static_cast<ptrdiff_t>(TILE);
+        merged.push_back({ncb, tile * col.ds, tile * col.ss});
+        merged.push_back({nrb, tile * inner.ds, tile * inner.ss});
+        for_each_outer(merged, parallel, [&](ptrdiff_t doff, ptrdiff_t soff, size_t i) {
+            size_t rb = i % nrb;
+            size_t cb = (i / nrb) % ncb;
+            size_t rows = std::min(TILE, inner.n - rb * TILE);
+            size_t cols = std::min(TILE, col.n - cb * TILE);
+            copy_tile_any(dst + doff, col.ds, src + soff, inner.ss, rows, cols, esize);
+        });
+        return;
+    }
+
+    // General case: element-wise strided inner loop
+    const size_t nchunk = blocks(inner.n, STRIDED_CHUNK);
+    const ptrdiff_t chunk = static_cast<ptrdiff_t>(STRIDED_CHUNK);
+    merged.push_back({nchunk, chunk * inner.ds, chunk * inner.ss});
+    for_each_outer(merged, parallel, [&](ptrdiff_t doff, ptrdiff_t soff, size_t i) {
+        size_t c = i % nchunk;
+        copy_strided_any(dst + doff, inner.ds, src + soff, inner.ss, std::min(STRIDED_CHUNK, inner.n - c * STRIDED_CHUNK),
+                         esize);
+    });
+}
+
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,10 @@
+#pragma once
+#include "llaisys.h"
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// Strided copy of `esize`-byte elements: dst[idx] = src[idx] for every index of `shape`.
+// Strides are in elements and may describe any view (permuted, sliced, broadcast source).
+void rearrange(std::byte* dst, const std::byte* src, size_t esize, size_t ndim, const size_t* shape,
+               const ptrdiff_t* dst_strides, const ptrdiff_t* src_strides);
+} // namespace llaisys::ops::cpu
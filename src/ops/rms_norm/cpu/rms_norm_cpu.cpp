@@ -4,8 +4,8 @@
 
 namespace llaisys::ops::cpu {
 
-template <typename T>
-void rms_norm_impl(T* out, const T* in, const T* weight, size_t nrows, size_t dim, float eps) {
+template <typename T, typename W>
+void rms_norm_impl(T* out, const T* in, const W* weight, size_t nrows, size_t dim, float eps) {
     #pragma omp parallel for schedule(static)
     for (int64_t i = 0; i < static_cast<int64_t>(nrows); ++i) {
         const T* row_in = in + i * dim;
@@ -20,32 +20,57 @@ void rms_norm_impl(T* out, const T* in, const T* weight, size_t nrows, size_t di
         
         float rms = 1.0f / std::sqrt(ss / dim + eps);
         
-        // normalize
-        for (size_t j = 0; j < dim; ++j) {
-            float x = llaisys::utils::cast<float>(row_in[j]);
-            float w = llaisys::utils::cast<float>(weight[j]);
-            row_out[j] = llaisys::utils::cast<T>(x * rms * w);
+        // normalize, then scale unless the weight has been folded into the next projection
+        if (weight) {
+            for (size_t j = 0; j < dim; ++j) {
+                float x = llaisys::utils::cast<float>(row_in[j]);
+                float w = llaisys::utils::cast<float>(weight[j]);
+                row_out[j] = llaisys::utils::cast<T>(x * rms * w);
+            }
+        } else {
+            for (size_t j = 0; j < dim; ++j) {
+                row_out[j] = llaisys::utils::cast<T>(llaisys::utils::cast<float>(row_in[j]) * rms);
+            }
         }
     }
 }
 
+template <typename T>
+void rms_norm_weight(T* out, const T* in, const std::byte* weight, llaisysDataType_t weight_dtype,
+                     size_t num_rows, size_t dim, float eps) {
+    if (!weight) return rms_norm_impl(out, in, static_cast<const T*>(nullptr), num_rows, dim, eps);
+    switch (weight_dtype) {
+    case LLAISYS_DTYPE_F32:
+        rms_norm_impl(out, in, reinterpret_cast<const float*>(weight), num_rows, dim, eps);
+        break;
+    case LLAISYS_DTYPE_F16:
+        rms_norm_impl(out, in, reinterpret_cast<const fp16_t*>(weight), num_rows, dim, eps);
+        break;
+    case LLAISYS_DTYPE_BF16:
+        rms_norm_impl(out, in, reinterpret_cast<const bf16_t*>(weight), num_rows, dim, eps);
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(weight_dtype);
+    }
+}
+
 void rms_norm(std::byte* out, const std::byte* in, const std::byte* weight,
-              llaisysDataType_t dtype, size_t num_rows, size_t dim, float eps) {
+              llaisysDataType_t dtype, llaisysDataType_t weight_dtype, size_t num_rows, size_t dim, float eps) {
     switch (dtype) {
     case LLAISYS_DTYPE_F32:
-        rms_norm_impl<float>(reinterpret_cast<float*>(out), reinterpret_cast<const float*>(in), 
-                             reinterpret_cast<const float*>(weight), num_rows, dim, eps);
+        rms_norm_weight(reinterpret_cast<float*>(out), reinterpret_cast<const float*>(in), weight, weight_dtype,
+                        num_rows, dim, eps);
         break;
     case LLAISYS_DTYPE_F16:
-        rms_norm_impl<fp16_t>(reinterpret_cast<fp16_t*>(out), reinterpret_cast<const fp16_t*>(in), 
-                              reinterpret_cast<const fp16_t*>(weight), num_rows, dim, eps);
+        rms_norm_weight(reinterpret_cast<fp16_t*>(out), reinterpret_cast<const fp16_t*>(in), weight, weight_dtype,
+                        num_rows, dim, eps);
         break;
     case LLAISYS_DTYPE_BF16:
-        rms_norm_impl<bf16_t>(reinterpret_cast<bf16_t*>(out), reinterpret_cast<const bf16_t*>(in), 
-                               reinterpret_cast<const bf16_t*>(weight), num_rows, dim, eps);
+        rms_norm_weight(reinterpret_cast<bf16_t*>(out), reinterpret_cast<const bf16_t*>(in), weight, weight_dtype,
+                        num_rows, dim, eps);
         break;
     default:
-        break;
+        EXCEPTION_UNSUPPORTED_DATATYPE(dtype);
     }
 }
 
@@ -3,6 +3,7 @@
 #include <cstddef>
 
 namespace llaisys::ops::cpu {
+// in / out use `dtype`, weight uses `weight_dtype`; a null weight normalizes without scaling
 void rms_norm(std::byte* out, const std::byte* in, const std::byte* weight,
-              llaisysDataType_t dtype, size_t num_rows, size_t dim, float eps);
+              llaisysDataType_t dtype, llaisysDataType_t weight_dtype, size_t num_rows, size_t dim, float eps);
 } // namespace llaisys::ops::cpu
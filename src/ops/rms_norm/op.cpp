@@ -7,7 +7,9 @@ void rms_norm(tensor_t out, tensor_t in, tensor_t weight, float eps) {
     if (out->deviceType() == LLAISYS_DEVICE_CPU) {
         size_t dim = in->shape().back();
         size_t num_rows = in->numel() / dim;
-        return cpu::rms_norm(out->data(), in->data(), weight->data(), out->dtype(), num_rows, dim, eps);
+        // a null weight normalizes only (the scale has been folded into the following projection)
+        return cpu::rms_norm(out->data(), in->data(), weight ? weight->data() : nullptr, out->dtype(),
+                             weight ? weight->dtype() : out->dtype(), num_rows, dim, eps);
     }
 
     core::context().setDevice(out->deviceType(), out->deviceId());
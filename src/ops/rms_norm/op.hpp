@@ -3,5 +3,6 @@
 #include "../../tensor/tensor.hpp"
 
 namespace llaisys::ops {
+// weight may be null: normalize without scaling
 void rms_norm(tensor_t out, tensor_t in, tensor_t weight, float eps);
 }
@@ -5,7 +5,8 @@
 namespace llaisys::ops::cpu {
 
 template <typename T>
-void rope_impl(T* out, const T* in, const int64_t* pos, size_t seqlen, size_t nhead, size_t d, float theta) {
+void rope_impl(T* out, const T* in, const int64_t* pos, size_t seqlen, size_t nhead, size_t d, size_t in_stride,
+               float theta) {
     size_t half_d = d / 2;
     
     for (size_t i = 0; i < seqlen; ++i) {
@@ -17,8 +18,9 @@ void rope_impl(T* out, const T* in, const int64_t* pos, size_t seqlen, size_t nh
                 float s = std::sin(freq);
                 
                 size_t base = i * nhead * d + h * d;
-                float a = llaisys::utils::cast<float>(in[base + j]);
-                float b = llaisys::utils::cast<float>(in[base + j + half_d]);
+                size_t in_base = i * in_stride + h * d;
+                float a = llaisys::utils::cast<float>(in[in_base + j]);
+                float b = llaisys::utils::cast<float>(in[in_base + j + half_d]);
                 
                 out[base + j] = llaisys::utils::cast<T>(a * c - b * s);
                 out[base + j + half_d] = llaisys::utils::cast<T>(b * c + a * s);
@@ -28,21 +30,21 @@ void rope_impl(T* out, const T* in, const int64_t* pos, size_t seqlen, size_t nh
 }
 
 void rope(std::byte* out, const std::byte* in, const std::byte* pos_ids,
-          llaisysDataType_t dtype, size_t seqlen, size_t nhead, size_t d, float theta) {
+          llaisysDataType_t dtype, size_t seqlen, size_t nhead, size_t d, size_t in_stride, float theta) {
     const int64_t* pos = reinterpret_cast<const int64_t*>(pos_ids);
     
     switch (dtype) {
     case LLAISYS_DTYPE_F32:
         rope_impl<float>(reinterpret_cast<float*>(out), reinterpret_cast<const float*>(in), 
-                         pos, seqlen, nhead, d, theta);
+                         pos, seqlen, nhead, d, in_stride, theta);
         break;
     case LLAISYS_DTYPE_F16:
         rope_impl<fp16_t>(reinterpret_cast<fp16_t*>(out), reinterpret_cast<const fp16_t*>(in), 
-                          pos, seqlen, nhead, d, theta);
+                          pos, seqlen, nhead, d, in_stride, theta);
         break;
     case LLAISYS_DTYPE_BF16:
         rope_impl<bf16_t>(reinterpret_cast<bf16_t*>(out), reinterpret_cast<const bf16_t*>(in), 
-                          pos, seqlen, nhead, d, theta);
+                          pos, seqlen, nhead, d, in_stride, theta);
         break;
     default:
         break;
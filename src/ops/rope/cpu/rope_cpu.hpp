@@ -3,6 +3,8 @@
 #include <cstddef>
 
 namespace llaisys::ops::cpu {
+// in_stride is the distance in elements between consecutive tokens of `in` (nhead * d when
+// contiguous, larger when q/k are views into a fused qkv projection); out is contiguous.
 void rope(std::byte* out, const std::byte* in, const std::byte* pos_ids,
-          llaisysDataType_t dtype, size_t seqlen, size_t nhead, size_t d, float theta);
+          llaisysDataType_t dtype, size_t seqlen, size_t nhead, size_t d, size_t in_stride, float theta);
 } // namespace llaisys::ops::cpu
@@ -8,7 +8,11 @@ void rope(tensor_t out, tensor_t in, tensor_t pos_ids, float theta) {
         size_t seqlen = in->shape()[0];
         size_t nhead = in->shape()[1];
         size_t d = in->shape()[2];
-        return cpu::rope(out->data(), in->data(), pos_ids->data(), out->dtype(), seqlen, nhead, d, theta);
+        // tokens of `in` may be strided (a slice of a fused qkv buffer), the heads of one token may not
+        ASSERT(in->strides()[2] == 1 && in->strides()[1] == static_cast<ptrdiff_t>(d) && out->isContiguous(),
+               "RoPE: heads of each token must be contiguous");
+        return cpu::rope(out->data(), in->data(), pos_ids->data(), out->dtype(), seqlen, nhead, d,
+                         static_cast<size_t>(in->strides()[0]), theta);
     }
 
     core::context().setDevice(out->deviceType(), out->deviceId());
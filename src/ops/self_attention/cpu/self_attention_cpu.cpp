@@ -6,6 +6,46 @@
 
 namespace llaisys::ops::cpu {
 
+// One query row of one head attending to the first `valid` rows of k/v.
+template <typename T>
+static void attend_row(T* op, const T* qp, const T* k, const T* v, size_t valid,
+                       size_t nkvhead, size_t kv_h, size_t d, size_t dv, float scale) {
+    // per-thread scratch, only grows, so steady-state decode does not hit the heap
+    thread_local std::vector<float> scores;
+    if (scores.size() < valid) scores.resize(valid);
+    float max_s = -1e9f;
+    
+    // compute QK^T
+    for (size_t t = 0; t < valid; ++t) {
+        const T* kp = k + t * nkvhead * d + kv_h * d;
+        float s = 0.0f;
+        for (size_t x = 0; x < d; ++x) {
+            s += llaisys::utils::cast<float>(qp[x]) * llaisys::utils::cast<float>(kp[x]);
+        }
+        scores[t] = s * scale;
+        max_s = std::max(max_s, scores[t]);
+    }
+    
+    // softmax
+    float sum = 0.0f;
+    for (size_t t = 0; t < valid; ++t) {
+        scores[t] = std::exp(scores[t] - max_s);
+        sum += scores[t];
+    }
+    for (size_t t = 0; t < valid; ++t) {
+        scores[t] /= sum;
+    }
+    
+    // weighted sum
+    for (size_t x = 0; x < dv; ++x) {
+        float acc = 0.0f;
+        for (size_t t = 0; t < valid; ++t) {
+            acc += scores[t] * llaisys::utils::cast<float>(v[t * nkvhead * dv + kv_h * dv + x]);
+        }
+        op[x] = llaisys::utils::cast<T>(acc);
+    }
+}
+
 template <typename T>
 void self_attention_impl(T* out, const T* q, const T* k, const T* v,
                         size_t seqlen, size_t total_len, size_t nhead, size_t nkvhead, 
@@ -17,46 +57,35 @@ void self_attention_impl(T* out, const T* q, const T* k, const T* v,
     for (int64_t idx = 0; idx < n; ++idx) {
         size_t h = idx / seqlen;
         size_t i = idx % seqlen;
-        size_t kv_h = h / gsize;
-        
-        std::vector<float> scores(total_len);
-        float max_s = -1e9f;
         
         // causal mask
         size_t valid = total_len - seqlen + i + 1;
+        attend_row(out + i * nhead * dv + h * dv, q + i * nhead * d + h * d, k, v,
+                   valid, nkvhead, h / gsize, d, dv, scale);
+    }
+}
+
+template <typename T>
+void self_attention_varlen_impl(T* out, const T* q, const std::byte* const* k, const std::byte* const* v,
+                                const size_t* q_start, const size_t* kv_len, size_t nseq,
+                                size_t nhead, size_t nkvhead, size_t d, size_t dv, float scale) {
+    size_t gsize = nhead / nkvhead;
+    int64_t n = static_cast<int64_t>(q_start[nseq] * nhead);
+    
+    // all (row, head) pairs of all sequences in one parallel loop
+    #pragma omp parallel for schedule(dynamic)
+    for (int64_t idx = 0; idx < n; ++idx) {
+        size_t row = idx / nhead;
+        size_t h = idx % nhead;
+        size_t s = std::upper_bound(q_start, q_start + nseq + 1, row) - q_start - 1;
+        size_t seqlen = q_start[s + 1] - q_start[s];
+        size_t i = row - q_start[s];
         
-        const T* qp = q + i * nhead * d + h * d;
-        
-        // compute QK^T
-        for (size_t t = 0; t < valid; ++t) {
-            const T* kp = k + t * nkvhead * d + kv_h * d;
-            float s = 0.0f;
-            for (size_t x = 0; x < d; ++x) {
-                s += llaisys::utils::cast<float>(qp[x]) * llaisys::utils::cast<float>(kp[x]);
-            }
-            scores[t] = s * scale;
-            max_s = std::max(max_s, scores[t]);
-        }
-        
-        // softmax
-        float sum = 0.0f;
-        for (size_t t = 0; t < valid; ++t) {
-            scores[t] = std::exp(scores[t] - max_s);
-            sum += scores[t];
-        }
-        for (size_t t = 0; t < valid; ++t) {
-            scores[t] /= sum;
-        }
-        
-        // weighted sum
-        T* op = out + i * nhead * dv + h * dv;
-        for (size_t x = 0; x < dv; ++x) {
-            float acc = 0.0f;
-            for (size_t t = 0; t < valid; ++t) {
-                acc += scores[t] * llaisys::utils::cast<float>(v[t * nkvhead * dv + kv_h * dv + x]);
-            }
-            op[x] = llaisys::utils::cast<T>(acc);
-        }
+        // causal mask
+        size_t valid = kv_len[s] - seqlen + i + 1;
+        attend_row(out + row * nhead * dv + h * dv, q + row * nhead * d + h * d,
+                   reinterpret_cast<const T*>(k[s]), reinterpret_cast<const T*>(v[s]),
+                   valid, nkvhead, h / gsize, d, dv, scale);
     }
 }
 
@@ -90,4 +119,25 @@ void self_attention(std::byte* attn_val, const std::byte* q, const std::byte* k,
     }
 }
 
+void self_attention_varlen(std::byte* attn_val, const std::byte* q, const std::byte* const* k, const std::byte* const* v,
+                           const size_t* q_start, const size_t* kv_len, llaisysDataType_t dtype, size_t nseq,
+                           size_t nhead, size_t nkvhead, size_t d, size_t dv, float scale) {
+    switch (dtype) {
+    case LLAISYS_DTYPE_F32:
+        self_attention_varlen_impl<float>(reinterpret_cast<float*>(attn_val), reinterpret_cast<const float*>(q),
+                                          k, v, q_start, kv_len, nseq, nhead, nkvhead, d, dv, scale);
+        break;
+    case LLAISYS_DTYPE_F16:
+        self_attention_varlen_impl<fp16_t>(reinterpret_cast<fp16_t*>(attn_val), reinterpret_cast<const fp16_t*>(q),
+                                           k, v, q_start, kv_len, nseq, nhead, nkvhead, d, dv, scale);
+        break;
+    case LLAISYS_DTYPE_BF16:
+        self_attention_varlen_impl<bf16_t>(reinterpret_cast<bf16_t*>(attn_val), reinterpret_cast<const bf16_t*>(q),
+                                           k, v, q_start, kv_len, nseq, nhead, nkvhead, d, dv, scale);
+        break;
+    default:
+        break;
+    }
+}
+
 } // namespace llaisys::ops::cpu
@@ -5,4 +5,10 @@
 namespace llaisys::ops::cpu {
 void self_attention(std::byte* attn_val, const std::byte* q, const std::byte* k, const std::byte* v,
                    llaisysDataType_t dtype, size_t seqlen, size_t total_len, size_t nhead, size_t nkvhead, size_t d, size_t dv, float scale);
+
+// Sequence s owns q/attn_val rows [q_start[s], q_start[s + 1]) and attends causally to the
+// first kv_len[s] rows of its own k[s]/v[s]. q_start has nseq + 1 entries.
+void self_attention_varlen(std::byte* attn_val, const std::byte* q, const std::byte* const* k, const std::byte* const* v,
+                           const size_t* q_start, const size_t* kv_len, llaisysDataType_t dtype, size_t nseq,
+                           size_t nhead, size_t nkvhead, size_t d, size_t dv, float scale);
 } // namespace llaisys::ops::cpu
@@ -22,4 +22,48 @@ void self_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float
     // TODO: Support GPU
     TO_BE_IMPLEMENTED();
 }
+
+void self_attention_varlen(tensor_t attn_val, tensor_t q, const std::vector<tensor_t> &k,
+                           const std::vector<tensor_t> &v, const std::vector<size_t> &q_lens, float scale) {
+    size_t nseq = q_lens.size();
+    CHECK_ARGUMENT(nseq > 0 && k.size() == nseq && v.size() == nseq, "SelfAttentionVarlen: one k/v per sequence");
+    CHECK_ARGUMENT(q->ndim() == 3 && attn_val->ndim() == 3, "SelfAttentionVarlen: q and attn_val must be 3D");
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype());
+    ASSERT(attn_val->isContiguous() && q->isContiguous(), "SelfAttentionVarlen: q and attn_val must be contiguous");
+    
+    size_t nhead = q->shape()[1];
+    size_t d = q->shape()[2];
+    size_t nkvhead = k[0]->shape()[1];
+    size_t dv = v[0]->shape()[2];
+    
+    std::vector<size_t> q_start(nseq + 1, 0), kv_len(nseq);
+    std::vector<const std::byte *> k_data(nseq), v_data(nseq);
+    for (size_t s = 0; s < nseq; ++s) {
+        CHECK_SAME_DEVICE(attn_val, k[s], v[s]);
+        CHECK_SAME_DTYPE(q->dtype(), k[s]->dtype(), v[s]->dtype());
+        CHECK_ARGUMENT(k[s]->ndim() == 3 && k[s]->shape()[1] == nkvhead && k[s]->shape()[2] == d,
+                       "SelfAttentionVarlen: k shape mismatch");
+        CHECK_ARGUMENT(v[s]->ndim() == 3 && v[s]->shape()[0] == k[s]->shape()[0] && v[s]->shape()[1] == nkvhead
+                           && v[s]->shape()[2] == dv,
+                       "SelfAttentionVarlen: v shape mismatch");
+        CHECK_ARGUMENT(k[s]->shape()[0] >= q_lens[s], "SelfAttentionVarlen: kv shorter than query");
+        ASSERT(k[s]->isContiguous() && v[s]->isContiguous(), "SelfAttentionVarlen: k and v must be contiguous");
+        q_start[s + 1] = q_start[s] + q_lens[s];
+        kv_len[s] = k[s]->shape()[0];
+        k_data[s] = k[s]->data();
+        v_data[s] = v[s]->data();
+    }
+    CHECK_ARGUMENT(q_start[nseq] == q->shape()[0], "SelfAttentionVarlen: q_lens must sum to the rows of q");
+    CHECK_ARGUMENT(attn_val->shape()[0] == q->shape()[0] && attn_val->shape()[1] == nhead && attn_val->shape()[2] == dv,
+                   "SelfAttentionVarlen: attn_val shape mismatch");
+    
+    if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::self_attention_varlen(attn_val->data(), q->data(), k_data.data(), v_data.data(), q_start.data(),
+                                          kv_len.data(), attn_val->dtype(), nseq, nhead, nkvhead, d, dv, scale);
+    }
+
+    core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
+    // TODO: Support GPU
+    TO_BE_IMPLEMENTED();
+}
 } // namespace llaisys::ops
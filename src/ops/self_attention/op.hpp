@@ -2,6 +2,13 @@
 
 #include "../../tensor/tensor.hpp"
 
+#include <vector>
+
 namespace llaisys::ops {
 void self_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float scale);
+
+// Several sequences packed along the rows of q/attn_val: sequence s owns the next q_lens[s]
+// rows and attends causally to its own k[s]/v[s] ([kv_len, nkvhead, d], kv_len >= q_lens[s]).
+void self_attention_varlen(tensor_t attn_val, tensor_t q, const std::vector<tensor_t> &k,
+                           const std::vector<tensor_t> &v, const std::vector<size_t> &q_lens, float scale);
 }
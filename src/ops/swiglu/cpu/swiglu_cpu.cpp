@@ -1,5 +1,6 @@
 #include "swiglu_cpu.hpp"
 #include "../../../utils.hpp"
+#include "../../elementwise/cpu/elementwise_cpu.hpp"
 #include <cmath>
 
 namespace llaisys::ops::cpu {
@@ -38,4 +39,22 @@ void swiglu(std::byte* out, const std::byte* gate, const std::byte* up,
     }
 }
 
+void swiglu(std::byte* out, const std::byte* gate, const std::byte* up,
+            llaisysDataType_t dtype, const ElementwiseLoop<3>& loop) {
+    if (loop.contiguous()) {
+        return swiglu(out, gate, up, dtype, loop.numel);
+    }
+    auto f = [](float g, float u) { return g / (1.0f + std::exp(-g)) * u; };
+    switch (dtype) {
+    case LLAISYS_DTYPE_F32:
+        return elementwise_binary<float>(loop, out, gate, up, f);
+    case LLAISYS_DTYPE_F16:
+        return elementwise_binary<fp16_t>(loop, out, gate, up, f);
+    case LLAISYS_DTYPE_BF16:
+        return elementwise_binary<bf16_t>(loop, out, gate, up, f);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(dtype);
+    }
+}
+
 } // namespace llaisys::ops::cpu
@@ -1,8 +1,12 @@
 #pragma once
 #include "llaisys.h"
+#include "../../elementwise/elementwise.hpp"
 #include <cstddef>
 
 namespace llaisys::ops::cpu {
 void swiglu(std::byte* out, const std::byte* gate, const std::byte* up,
             llaisysDataType_t dtype, size_t numel);
+// Strided / broadcast operands, see ElementwiseLoop
+void swiglu(std::byte* out, const std::byte* gate, const std::byte* up,
+            llaisysDataType_t dtype, const ElementwiseLoop<3>& loop);
 } // namespace llaisys::ops::cpu
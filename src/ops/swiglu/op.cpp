@@ -1,11 +1,17 @@
 #include "op.hpp"
 #include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
 #include "cpu/swiglu_cpu.hpp"
 
 namespace llaisys::ops {
 void swiglu(tensor_t out, tensor_t gate, tensor_t up) {
+    CHECK_SAME_DEVICE(out, gate, up);
+    CHECK_SAME_DTYPE(out->dtype(), gate->dtype(), up->dtype());
+    // gate and up may be any views broadcastable to out's shape
+    auto loop = elementwise_loop<3>(out, {gate, up});
+
     if (out->deviceType() == LLAISYS_DEVICE_CPU) {
-        return cpu::swiglu(out->data(), gate->data(), up->data(), out->dtype(), out->numel());
+        return cpu::swiglu(out->data(), gate->data(), up->data(), out->dtype(), loop);
     }
 
     core::context().setDevice(out->deviceType(), out->deviceId());
@@ -0,0 +1,76 @@
+#pragma once
+#include "../utils/check.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace llaisys {
+
+// Vector with a fixed inline capacity of N elements, never touches the heap.
+// Converts from and to std::vector so call sites that build shapes dynamically keep working.
+template <typename T, size_t N>
+class SmallVector {
+private:
+    T _data[N]{};
+    size_t _size = 0;
+
+    template <typename It>
+    void assign(It first, It last) {
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        ASSERT(n <= N, "SmallVector: too many elements");
+        std::copy(first, last, _data);
+        _size = n;
+    }
+
+public:
+    SmallVector() = default;
+    explicit SmallVector(size_t size, const T &value = T()) {
+        ASSERT(size <= N, "SmallVector: too many elements");
+        std::fill(_data, _data + size, value);
+        _size = size;
+    }
+    SmallVector(std::initializer_list<T> init) { assign(init.begin(), init.end()); }
+    SmallVector(const std::vector<T> &v) { assign(v.begin(), v.end()); }
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    SmallVector(It first, It last) { assign(first, last); }
+
+    operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+    static constexpr size_t capacity() { return N; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    T &operator[](size_t i) { return _data[i]; }
+    const T &operator[](size_t i) const { return _data[i]; }
+    T &back() { return _data[_size - 1]; }
+    const T &back() const { return _data[_size - 1]; }
+    T *data() { return _data; }
+    const T *data() const { return _data; }
+
+    T *begin() { return _data; }
+    T *end() { return _data + _size; }
+    const T *begin() const { return _data; }
+    const T *end() const { return _data + _size; }
+
+    void push_back(const T &value) {
+        ASSERT(_size < N, "SmallVector: too many elements");
+        _data[_size++] = value;
+    }
+
+    friend bool operator==(const SmallVector &a, const SmallVector &b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+    friend bool operator!=(const SmallVector &a, const SmallVector &b) { return !(a == b); }
+    friend bool operator==(const SmallVector &a, const std::vector<T> &b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+    friend bool operator==(const std::vector<T> &a, const SmallVector &b) { return b == a; }
+    friend bool operator!=(const SmallVector &a, const std::vector<T> &b) { return !(a == b); }
+    friend bool operator!=(const std::vector<T> &a, const SmallVector &b) { return !(b == a); }
+};
+
+} // namespace llaisys
@@ -1,22 +1,146 @@
 #include "tensor.hpp"
 
 #include "../utils.hpp"
+#include "../ops/rearrange/cpu/rearrange_cpu.hpp"
 
 #include <cstring>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 
 namespace llaisys {
 
-Tensor::Tensor(TensorMeta meta, core::storage_t storage, size_t offset)
-    : _meta(std::move(meta)), _storage(std::move(storage)), _offset(offset) {}
+namespace {
 
-tensor_t Tensor::create(const std::vector<size_t> &shape,
+// Free list of fixed-size blocks for tensor headers. Each thread keeps a short local list,
+// blocks beyond that go through a shared list; blocks are reused, never returned to the system.
+template <size_t Size>
+class HeaderPool {
+    struct Block {
+        Block *next;
+    };
+    struct Shared {
+        std::mutex mutex;
+        Block *head = nullptr;
+    };
+    struct Local {
+        Block *head;
+        size_t count;
+        bool exited;
+    };
+    static constexpr size_t LOCAL_MAX = 256;
+
+    static Shared &shared() {
+        // never destroyed: headers may still be released during static destruction
+        static Shared *s = new Shared;
+        return *s;
+    }
+    // trivially destructible, so it stays usable while the thread exits
+    static Local &local() {
+        thread_local Local l{nullptr, 0, false};
+        return l;
+    }
+    // hands the local list over to the shared one when the thread exits
+    struct Flush {
+        ~Flush() {
+            Local &l = local();
+            if (l.head) {
+                Block *tail = l.head;
+                while (tail->next) {
+                    tail = tail->next;
+                }
+                std::lock_guard<std::mutex> lock(shared().mutex);
+                tail->next = shared().head;
+                shared().head = l.head;
+            }
+            l = Local{nullptr, 0, true};
+        }
+    };
+
+public:
+    static void *allocate() {
+        Local &l = local();
+        if (l.head) {
+            Block *b = l.head;
+            l.head = b->next;
+            l.count--;
+            return b;
+        }
+        {
+            std::lock_guard<std::mutex> lock(shared().mutex);
+            if (Block *b = shared().head) {
+                shared().head = b->next;
+                return b;
+            }
+        }
+        return ::operator new(Size);
+    }
+
+    static void deallocate(void *p) {
+        Block *b = static_cast<Block *>(p);
+        Local &l = local();
+        if (!l.exited && l.count < LOCAL_MAX) {
+            if (!l.head) {
+                thread_local Flush flush;
+                (void)flush;
+            }
+            b->next = l.head;
+            l.head = b;
+            l.count++;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(shared().mutex);
+        b->next = shared().head;
+        shared().head = b;
+    }
+};
+
+// Allocator for std::allocate_shared: the header and its control block share one pooled block
+template <typename T>
+struct HeaderAllocator {
+    using value_type = T;
+    static constexpr size_t BLOCK_SIZE
+        = (std::max(sizeof(T), sizeof(void *)) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned tensor header");
+
+    HeaderAllocator() = default;
+    template <typename U>
+    HeaderAllocator(const HeaderAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        if (n != 1) {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T *>(HeaderPool<BLOCK_SIZE>::allocate());
+    }
+    void deallocate(T *p, size_t n) {
+        if (n != 1) {
+            return ::operator delete(p);
+        }
+        HeaderPool<BLOCK_SIZE>::deallocate(p);
+    }
+
+    template <typename U>
+    bool operator==(const HeaderAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const HeaderAllocator<U> &) const { return false; }
+};
+
+} // namespace
+
+Tensor::Tensor(Key, const TensorMeta &meta, core::storage_t storage, size_t offset)
+    : _meta(meta), _storage(std::move(storage)), _offset(offset) {}
+
+tensor_t Tensor::make(const TensorMeta &meta, core::storage_t storage, size_t offset) {
+    return std::allocate_shared<Tensor>(HeaderAllocator<Tensor>(), Key(), meta, std::move(storage), offset);
+}
+
+tensor_t Tensor::create(const shape_t &shape,
                         llaisysDataType_t dtype,
                         llaisysDeviceType_t device_type,
                         int device) {
     size_t ndim_ = shape.size();
-    std::vector<ptrdiff_t> strides(ndim_);
+    strides_t strides(ndim_);
     size_t stride = 1;
     for (size_t i = 1; i <= ndim_; i++) {
         strides[ndim_ - i] = stride;
@@ -28,14 +152,30 @@ tensor_t Tensor::create(const std::vector<size_t> &shape,
 
     if (device_type == LLAISYS_DEVICE_CPU && core::context().runtime().deviceType() != LLAISYS_DEVICE_CPU) {
         auto storage = core::context().runtime().allocateHostStorage(total_elems * dtype_size);
-        return std::shared_ptr<Tensor>(new Tensor(meta, storage));
+        return make(meta, storage);
     } else {
         core::context().setDevice(device_type, device);
         auto storage = core::context().runtime().allocateDeviceStorage(total_elems * dtype_size);
-        return std::shared_ptr<Tensor>(new Tensor(meta, storage));
+        return make(meta, storage);
     }
 }
 
+tensor_t Tensor::createOnStorage(core::storage_t storage,
+                                 size_t offset,
+                                 const shape_t &shape,
+                                 llaisysDataType_t dtype) {
+    size_t ndim_ = shape.size();
+    strides_t strides(ndim_);
+    size_t stride = 1;
+    for (size_t i = 1; i <= ndim_; i++) {
+        strides[ndim_ - i] = stride;
+        stride *= shape[ndim_ - i];
+    }
+    CHECK_ARGUMENT(offset + stride * utils::dsize(dtype) <= storage->size(), "tensor exceeds storage size");
+    TensorMeta meta{dtype, shape, strides};
+    return make(meta, std::move(storage), offset);
+}
+
 std::byte *Tensor::data() {
     return _storage->memory() + _offset;
 }
@@ -48,11 +188,11 @@ size_t Tensor::ndim() const {
     return _meta.shape.size();
 }
 
-const std::vector<size_t> &Tensor::shape() const {
+const shape_t &Tensor::shape() const {
     return _meta.shape;
 }
 
-const std::vector<ptrdiff_t> &Tensor::strides() const {
+const strides_t &Tensor::strides() const {
     return _meta.strides;
 }
 
@@ -94,7 +234,7 @@ std::string Tensor::info() const {
 }
 
 template <typename T>
-void print_data(const T *data, const std::vector<size_t> &shape, const std::vector<ptrdiff_t> &strides, size_t dim) {
+void print_data(const T *data, const shape_t &shape, const strides_t &strides, size_t dim) {
     if (dim == shape.size() - 1) {
         for (size_t i = 0; i < shape[dim]; i++) {
             if constexpr (std::is_same_v<T, bf16_t> || std::is_same_v<T, fp16_t>) {
@@ -111,7 +251,7 @@ void print_data(const T *data, const std::vector<size_t> &shape, const std::vect
     }
 }
 
-void debug_print(const std::byte *data, const std::vector<size_t> &shape, const std::vector<ptrdiff_t> &strides, llaisysDataType_t dtype) {
+void debug_print(const std::byte *data, const shape_t &shape, const strides_t &strides, llaisysDataType_t dtype) {
     switch (dtype) {
     case LLAISYS_DTYPE_BYTE:
         return print_data(reinterpret_cast<const char *>(data), shape, strides, 0);
@@ -163,6 +303,10 @@ void Tensor::debug() const {
     }
 }
 
+bool Tensor::isExternal() const {
+    return _storage->isExternal();
+}
+
 bool Tensor::isContiguous() const {
     const auto& shape = this->shape();
     const auto& strides = this->strides();
@@ -180,13 +324,13 @@ bool Tensor::isContiguous() const {
     return true;
 }
 
-tensor_t Tensor::permute(const std::vector<size_t> &order) const {
+tensor_t Tensor::permute(const shape_t &order) const {
     size_t dims = this->ndim();
     
     ASSERT(order.size() == dims, 
            "permute: order size must match number of dimensions");
     
-    std::vector<bool> seen(dims, false);
+    bool seen[TENSOR_MAX_NDIM] = {};
     for (size_t i = 0; i < dims; i++) {
         ASSERT(order[i] < dims, "permute: order value out of range");
         ASSERT(!seen[order[i]], "permute: duplicate dimension in order");
@@ -196,8 +340,8 @@ tensor_t Tensor::permute(const std::vector<size_t> &order) const {
     const auto& old_shape = this->shape();
     const auto& old_strides = this->strides();
     
-    std::vector<size_t> new_shape(dims);
-    std::vector<ptrdiff_t> new_strides(dims);
+    shape_t new_shape(dims);
+    strides_t new_strides(dims);
     
     for (size_t i = 0; i < dims; i++) {
         new_shape[i] = old_shape[order[i]];
@@ -205,10 +349,10 @@ tensor_t Tensor::permute(const std::vector<size_t> &order) const {
     }
     
     TensorMeta new_meta{this->dtype(), new_shape, new_strides};
-    return std::shared_ptr<Tensor>(new Tensor(new_meta, _storage, _offset));
+    return make(new_meta, _storage, _offset);
 }
 
-tensor_t Tensor::view(const std::vector<size_t> &new_shape) const {
+tensor_t Tensor::view(const shape_t &new_shape) const {
     size_t new_numel = 1;
     for (auto dim : new_shape) {
         new_numel *= dim;
@@ -220,7 +364,7 @@ tensor_t Tensor::view(const std::vector<size_t> &new_shape) const {
     ASSERT(this->isContiguous(), 
            "view: tensor must be contiguous");
     
-    std::vector<ptrdiff_t> new_strides(new_shape.size());
+    strides_t new_strides(new_shape.size());
     ptrdiff_t stride = 1;
     for (intptr_t i = (intptr_t)new_shape.size() - 1; i >= 0; i--) {
         new_strides[i] = stride;
@@ -228,7 +372,7 @@ tensor_t Tensor::view(const std::vector<size_t> &new_shape) const {
     }
     
     TensorMeta new_meta{this->dtype(), new_shape, new_strides};
-    return std::shared_ptr<Tensor>(new Tensor(new_meta, _storage, _offset));
+    return make(new_meta, _storage, _offset);
 }
 
 tensor_t Tensor::slice(size_t dim, size_t start, size_t end) const {
@@ -236,15 +380,15 @@ tensor_t Tensor::slice(size_t dim, size_t start, size_t end) const {
     ASSERT(start < end, "slice: start must be less than end");
     ASSERT(end <= this->shape()[dim], "slice: end out of range");
     
-    std::vector<size_t> new_shape = this->shape();
-    std::vector<ptrdiff_t> new_strides = this->strides();
+    shape_t new_shape = this->shape();
+    strides_t new_strides = this->strides();
     
     new_shape[dim] = end - start;
     
     size_t new_offset = _offset + start * this->strides()[dim] * this->elementSize();
     
     TensorMeta new_meta{this->dtype(), new_shape, new_strides};
-    return std::shared_ptr<Tensor>(new Tensor(new_meta, _storage, new_offset));
+    return make(new_meta, _storage, new_offset);
 }
 
 void Tensor::load(const void *src) {
@@ -256,18 +400,93 @@ void Tensor::load(const void *src) {
 }
 
 tensor_t Tensor::contiguous() const {
-    TO_BE_IMPLEMENTED();
-    return std::shared_ptr<Tensor>(new Tensor(_meta, _storage));
+    if (this->isContiguous()) {
+        return make(_meta, _storage, _offset);
+    }
+    auto out = create(this->shape(), this->dtype(), this->deviceType(), this->deviceId());
+    switch (this->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        ops::cpu::rearrange(out->data(), this->data(), this->elementSize(), this->ndim(), this->shape().data(),
+                            out->strides().data(), this->strides().data());
+        return out;
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
 }
 
-tensor_t Tensor::reshape(const std::vector<size_t> &shape) const {
-    TO_BE_IMPLEMENTED();
-    return std::shared_ptr<Tensor>(new Tensor(_meta, _storage));
+// Compute strides that let `new_shape` alias the existing memory; false if a copy is needed.
+// Each run of dims that is contiguous in memory may be regrouped freely.
+static bool view_strides(const shape_t &old_shape, const strides_t &old_strides,
+                         const shape_t &new_shape, strides_t &new_strides) {
+    new_strides = strides_t(new_shape.size());
+    intptr_t view_d = (intptr_t)new_shape.size() - 1;
+    ptrdiff_t chunk_base_stride = old_strides.back();
+    size_t tensor_numel = 1;
+    size_t view_numel = 1;
+    for (intptr_t tensor_d = (intptr_t)old_shape.size() - 1; tensor_d >= 0; tensor_d--) {
+        tensor_numel *= old_shape[tensor_d];
+        // end of a contiguous run
+        if (tensor_d == 0
+            || (old_shape[tensor_d - 1] != 1 && old_strides[tensor_d - 1] != (ptrdiff_t)tensor_numel * chunk_base_stride)) {
+            while (view_d >= 0 && (view_numel < tensor_numel || new_shape[view_d] == 1)) {
+                new_strides[view_d] = (ptrdiff_t)view_numel * chunk_base_stride;
+                view_numel *= new_shape[view_d];
+                view_d--;
+            }
+            if (view_numel != tensor_numel) {
+                return false;
+            }
+            if (tensor_d > 0) {
+                chunk_base_stride = old_strides[tensor_d - 1];
+                tensor_numel = 1;
+                view_numel = 1;
+            }
+        }
+    }
+    return view_d == -1;
+}
+
+tensor_t Tensor::reshape(const shape_t &shape) const {
+    size_t new_numel = 1;
+    for (auto dim : shape) {
+        new_numel *= dim;
+    }
+    ASSERT(new_numel == this->numel(), "reshape: new shape must have same number of elements");
+
+    if (this->isContiguous()) {
+        return this->view(shape);
+    }
+    strides_t new_strides;
+    if (new_numel > 0 && view_strides(this->shape(), this->strides(), shape, new_strides)) {
+        TensorMeta new_meta{this->dtype(), shape, new_strides};
+        return make(new_meta, _storage, _offset);
+    }
+    return this->contiguous()->view(shape);
 }
 
 tensor_t Tensor::to(llaisysDeviceType_t device_type, int device) const {
-    TO_BE_IMPLEMENTED();
-    return std::shared_ptr<Tensor>(new Tensor(_meta, _storage));
+    if (device < 0) {
+        device = device_type == this->deviceType() ? this->deviceId() : 0;
+    }
+    if (device_type == this->deviceType() && (device_type == LLAISYS_DEVICE_CPU || device == this->deviceId())) {
+        return make(_meta, _storage, _offset);
+    }
+
+    auto src = this->contiguous();
+    auto out = create(this->shape(), this->dtype(), device_type, device);
+    llaisysMemcpyKind_t kind;
+    if (this->deviceType() == LLAISYS_DEVICE_CPU) {
+        kind = LLAISYS_MEMCPY_H2D;
+        core::context().setDevice(device_type, device);
+    } else if (device_type == LLAISYS_DEVICE_CPU) {
+        kind = LLAISYS_MEMCPY_D2H;
+        core::context().setDevice(this->deviceType(), this->deviceId());
+    } else {
+        kind = LLAISYS_MEMCPY_D2D;
+        core::context().setDevice(device_type, device);
+    }
+    core::context().runtime().api()->memcpy_sync(out->data(), src->data(), this->numel() * this->elementSize(), kind);
+    return out;
 }
 
 } // namespace llaisys
@@ -1,15 +1,21 @@
 #pragma once
 #include "../core/llaisys_core.hpp"
+#include "small_vector.hpp"
 
 #include <vector>
 namespace llaisys {
 class Tensor;
 using tensor_t = std::shared_ptr<Tensor>;
 
+// Shape and strides are stored inline in the tensor header, so tensors have at most this many dims
+constexpr size_t TENSOR_MAX_NDIM = 6;
+using shape_t = SmallVector<size_t, TENSOR_MAX_NDIM>;
+using strides_t = SmallVector<ptrdiff_t, TENSOR_MAX_NDIM>;
+
 struct TensorMeta {
     llaisysDataType_t dtype;
-    std::vector<size_t> shape;
-    std::vector<ptrdiff_t> strides;
+    shape_t shape;
+    strides_t strides;
 };
 
 class Tensor {
@@ -17,21 +23,35 @@ private:
     TensorMeta _meta;
     core::storage_t _storage;
     size_t _offset;
-    Tensor(TensorMeta meta, core::storage_t storage, size_t offset = 0);
+
+    // Only Tensor can name the key, so headers are created through make() alone
+    struct Key {
+        explicit Key() = default;
+    };
+    // Header and shared_ptr control block come from one pooled allocation
+    static tensor_t make(const TensorMeta &meta, core::storage_t storage, size_t offset = 0);
 
 public:
+    Tensor(Key, const TensorMeta &meta, core::storage_t storage, size_t offset);
+
     static tensor_t create(
-        const std::vector<size_t> &shape,
+        const shape_t &shape,
         llaisysDataType_t dtype,
         llaisysDeviceType_t device_type = LLAISYS_DEVICE_CPU,
         int device = 0);
+    // Create a tensor on an existing storage, no memory is allocated
+    static tensor_t createOnStorage(
+        core::storage_t storage,
+        size_t offset,
+        const shape_t &shape,
+        llaisysDataType_t dtype);
     ~Tensor() = default;
     // Info
     std::byte *data();
     const std::byte *data() const;
     size_t ndim() const;
-    const std::vector<size_t> &shape() const;
-    const std::vector<ptrdiff_t> &strides() const;
+    const shape_t &shape() const;
+    const strides_t &strides() const;
     llaisysDataType_t dtype() const;
     llaisysDeviceType_t deviceType() const;
     int deviceId() const;
@@ -42,17 +62,20 @@ public:
     void debug() const;
 
     bool isContiguous() const;
+    // Memory is owned outside the runtime (e.g. a mapped weight file)
+    bool isExternal() const;
 
     // Meta Transform
-    tensor_t permute(const std::vector<size_t> &order) const;
+    // Views share the storage and do not allocate
+    tensor_t permute(const shape_t &order) const;
     tensor_t slice(size_t dim, size_t start, size_t end) const;
-    tensor_t view(const std::vector<size_t> &shape) const;
+    tensor_t view(const shape_t &shape) const;
 
     // Load data from host memory
     void load(const void *src);
     // Challenging features
     tensor_t contiguous() const;
-    tensor_t reshape(const std::vector<size_t> &shape) const;
+    tensor_t reshape(const shape_t &shape) const;
     tensor_t to(llaisysDeviceType_t device_type, int device = -1) const;
 };
 
@@ -30,6 +30,15 @@ def test_op_add(
 
     assert check_equal(c_, c, atol=atol, rtol=rtol)
 
+    # transposed a, b broadcast along the rows
+    sa, sa_ = random_tensor(shape[::-1], dtype_name, device_name)
+    sa, sa_ = sa.permute(1, 0), sa_.permute(1, 0)
+    sb, sb_ = random_tensor(shape[-1:], dtype_name, device_name)
+    torch_add(c, sa, sb)
+    llaisys.Ops.add(c_, sa_, sb_)
+
+    assert check_equal(c_, c, atol=atol, rtol=rtol)
+
     if profile:
         benchmark(
             lambda: torch_add(c, a, b),
@@ -8,7 +8,7 @@ from test_utils import random_int_tensor, random_tensor, check_equal, benchmark
 
 
 def torch_embedding(out, idx, embd):
-    out[:] = embd[idx]
+    out[:] = embd[idx].to(out.dtype)
 
 
 def test_op_embedding(
@@ -17,9 +17,11 @@ def test_op_embedding(
     dtype_name="f32",
     device_name="cpu",
     profile=False,
+    weight_dtype_name=None,
 ):
-    print(f"   idx_shape {idx_shape} embd_shape {embd_shape} dtype <{dtype_name}>")
-    embd, embd_ = random_tensor(embd_shape, dtype_name, device_name)
+    weight_dtype_name = weight_dtype_name or dtype_name
+    print(f"   idx_shape {idx_shape} embd_shape {embd_shape} dtype <{dtype_name}>, weight <{weight_dtype_name}>")
+    embd, embd_ = random_tensor(embd_shape, weight_dtype_name, device_name)
     idx, idx_ = random_int_tensor(idx_shape, device_name, high=embd_shape[0])
     out, out_ = random_tensor((idx_shape[0], embd_shape[1]), dtype_name, device_name)
     torch_embedding(out, idx, embd)
@@ -58,5 +60,10 @@ if __name__ == "__main__":
             test_op_embedding(
                 idx_shape, embd_shape, dtype_name, args.device, args.profile
             )
+        # f32 activations with half-precision weights
+        for weight_dtype_name in ["f16", "bf16"]:
+            test_op_embedding(
+                idx_shape, embd_shape, "f32", args.device, args.profile, weight_dtype_name
+            )
 
     print("\033[92mTest passed!\033[0m\n")
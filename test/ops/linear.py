@@ -22,16 +22,20 @@ def test_op_linear(
     rtol=1e-5,
     device_name="cpu",
     profile=False,
+    weight_dtype_name=None,
 ):
-    print(f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, dtype <{dtype_name}>")
+    weight_dtype_name = weight_dtype_name or dtype_name
+    print(f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, dtype <{dtype_name}>, weight <{weight_dtype_name}>")
     x, x_ = random_tensor(x_shape, dtype_name, device_name, scale=0.1)
-    w, w_ = random_tensor(w_shape, dtype_name, device_name, scale=0.01)
+    w, w_ = random_tensor(w_shape, weight_dtype_name, device_name, scale=0.01)
 
     bias, bias_ = None, None
     if use_bias:
-        bias, bias_ = random_tensor((w_shape[0],), dtype_name, device_name)
+        bias, bias_ = random_tensor((w_shape[0],), weight_dtype_name, device_name)
 
     out, out_ = random_tensor(out_shape, dtype_name, device_name)
+    # mixed precision: the reference upcasts the weights, llaisys reads them as stored
+    w, bias = w.to(x.dtype), bias.to(x.dtype) if bias is not None else None
     torch_linear(out, x, w, bias)
     llaisys.Ops.linear(out_, x_, w_, bias_)
 
@@ -66,5 +70,8 @@ if __name__ == "__main__":
     for shapes in testShapes:
         for dtype_name, atol, rtol in testDtypePrec:
             test_op_linear(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+        # f32 activations with half-precision weights
+        for weight_dtype_name in ["f16", "bf16"]:
+            test_op_linear(*shapes, "f32", 1e-5, 1e-5, args.device, args.profile, weight_dtype_name)
 
     print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,85 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, check_equal, benchmark, zero_tensor
+
+
+def torch_lm_head_topk(hidden, norm_w, weight, eps, k):
+    normed = (hidden.float() * torch.rsqrt(hidden.float().pow(2).mean(-1, keepdim=True) + eps) * norm_w.float()).to(hidden.dtype)
+    logits = torch.nn.functional.linear(normed, weight)
+    return logits, torch.topk(logits.float(), k, dim=-1)
+
+
+def test_op_lm_head_topk(
+    nrow,
+    hs,
+    voc,
+    k,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+    weight_dtype_name=None,
+):
+    weight_dtype_name = weight_dtype_name or dtype_name
+    print(f"   nrow {nrow} hs {hs} voc {voc} k {k} dtype <{dtype_name}>, weight <{weight_dtype_name}>")
+    hidden, hidden_ = random_tensor((nrow, hs), dtype_name, device_name)
+    norm_w, norm_w_ = random_tensor((hs,), weight_dtype_name, device_name)
+    weight, weight_ = random_tensor((voc, hs), weight_dtype_name, device_name, scale=0.1)
+    eps = 1e-6
+    # mixed precision: the reference upcasts the weights, llaisys reads them as stored
+    norm_w, weight = norm_w.to(hidden.dtype), weight.to(hidden.dtype)
+
+    logits, (topk_val, _) = torch_lm_head_topk(hidden, norm_w, weight, eps, k)
+    idx, idx_ = zero_tensor((nrow, k), "i64", device_name)
+    val, val_ = zero_tensor((nrow, k), dtype_name, device_name)
+    llaisys.Ops.lm_head_topk(idx_, val_, hidden_, norm_w_, weight_, eps)
+
+    # ties may be ordered differently, so compare scores and check the indices point at them
+    assert check_equal(val_, topk_val.to(logits.dtype), atol=atol, rtol=rtol)
+    tmp = torch.zeros((nrow, k), dtype=torch.int64)
+    api = llaisys.RuntimeAPI(llaisys.DeviceType.CPU)
+    api.memcpy_sync(tmp.data_ptr(), idx_.data_ptr(), tmp.numel() * tmp.element_size(), llaisys.MemcpyKind.D2H)
+    assert check_equal(val_, torch.gather(logits, -1, tmp), atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_lm_head_topk(hidden, norm_w, weight, eps, k),
+            lambda: llaisys.Ops.lm_head_topk(idx_, val_, hidden_, norm_w_, weight_, eps),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # nrow, hs, voc, k
+        (1, 16, 100, 1),
+        (1, 1536, 151936, 1),
+        (4, 256, 4096, 8),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-4, 1e-4),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.lm_head_topk on {args.device}")
+    for shapes in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_lm_head_topk(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+        # f32 activations with half-precision weights
+        for weight_dtype_name in ["f16", "bf16"]:
+            test_op_lm_head_topk(*shapes, "f32", 1e-4, 1e-4, args.device, args.profile, weight_dtype_name)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,61 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, check_equal, benchmark
+
+
+def torch_rearrange(out, inp):
+    out.copy_(inp)
+
+
+def test_op_rearrange(
+    shape,
+    perm,
+    dtype_name="f32",
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   shape {shape} perm {perm} dtype <{dtype_name}>")
+    inp, inp_ = random_tensor(shape, dtype_name, device_name)
+    inp, inp_ = inp.permute(*perm), inp_.permute(*perm)
+
+    out, out_ = random_tensor(inp.shape, dtype_name, device_name)
+    torch_rearrange(out, inp)
+    llaisys.Ops.rearrange(out_, inp_)
+
+    assert check_equal(out_, out, atol=0, rtol=0)
+
+    if profile:
+        benchmark(
+            lambda: torch_rearrange(out, inp),
+            lambda: llaisys.Ops.rearrange(out_, inp_),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testCases = [
+        # shape, perm
+        ((2, 3), (1, 0)),
+        ((512, 4096), (1, 0)),
+        ((4, 5, 6), (0, 1, 2)),
+        ((16, 32, 64), (1, 0, 2)),
+        ((8, 16, 32, 64), (0, 2, 3, 1)),
+    ]
+    testDtypes = ["f32", "f16", "bf16"]
+    print(f"Testing Ops.rearrange on {args.device}")
+    for shape, perm in testCases:
+        for dtype_name in testDtypes:
+            test_op_rearrange(shape, perm, dtype_name, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
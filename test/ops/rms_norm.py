@@ -24,11 +24,15 @@ def test_op_rms_norm(
     rtol=1e-5,
     device_name="cpu",
     profile=False,
+    weight_dtype_name=None,
 ):
-    print(f"   shape {shape} dtype <{dtype_name}>")
+    weight_dtype_name = weight_dtype_name or dtype_name
+    print(f"   shape {shape} dtype <{dtype_name}>, weight <{weight_dtype_name}>")
     x, x_ = random_tensor(shape, dtype_name, device_name)
-    w, w_ = random_tensor((shape[1], ), dtype_name, device_name)
+    w, w_ = random_tensor((shape[1], ), weight_dtype_name, device_name)
     eps = 1e-5
+    # mixed precision: the reference upcasts the weight, llaisys reads it as stored
+    w = w.to(x.dtype)
 
     c, c_ = random_tensor(shape, dtype_name, device_name)
     torch_rms_norm(c, x, w, eps)
@@ -62,5 +66,8 @@ if __name__ == "__main__":
     for shape in testShapes:
         for dtype_name, atol, rtol in testDtypePrec:
             test_op_rms_norm(shape, dtype_name, atol, rtol, args.device, args.profile)
+        # f32 activations with half-precision weights
+        for weight_dtype_name in ["f16", "bf16"]:
+            test_op_rms_norm(shape, "f32", 1e-5, 1e-5, args.device, args.profile, weight_dtype_name)
 
     print("\033[92mTest passed!\033[0m\n")
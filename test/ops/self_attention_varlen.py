@@ -0,0 +1,83 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, check_equal, benchmark
+from self_attention import torch_self_attention
+
+
+def torch_self_attention_varlen(attn_val, query, keys, values, q_lens, scale):
+    start = 0
+    for key, value, qlen in zip(keys, values, q_lens):
+        torch_self_attention(
+            attn_val[start : start + qlen], query[start : start + qlen], key, value, scale
+        )
+        start += qlen
+
+
+def test_op_self_attention_varlen(
+    q_lens,
+    kv_lens,
+    nh,
+    nkvh,
+    hd,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(
+        f"   q_lens={q_lens} kv_lens={kv_lens} nh={nh} nkvh={nkvh} hd={hd} dtype <{dtype_name}>"
+    )
+    total = sum(q_lens)
+    q, q_ = random_tensor((total, nh, hd), dtype_name, device_name)
+    kvs = [random_tensor((kvlen, nkvh, hd), dtype_name, device_name) for kvlen in kv_lens]
+    vvs = [random_tensor((kvlen, nkvh, hd), dtype_name, device_name) for kvlen in kv_lens]
+    k, k_ = [t for t, _ in kvs], [t for _, t in kvs]
+    v, v_ = [t for t, _ in vvs], [t for _, t in vvs]
+    scale = 1.0 / (hd**0.5)
+
+    attn_val, attn_val_ = random_tensor((total, nh, hd), dtype_name, device_name)
+    torch_self_attention_varlen(attn_val, q, k, v, q_lens, scale)
+    llaisys.Ops.self_attention_varlen(attn_val_, q_, k_, v_, q_lens, scale)
+    assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_self_attention_varlen(attn_val, q, k, v, q_lens, scale),
+            lambda: llaisys.Ops.self_attention_varlen(attn_val_, q_, k_, v_, q_lens, scale),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # q_lens, kv_lens, nh, nkvh, hd
+        ((1,), (3,), 1, 1, 4),
+        ((1, 1, 1), (5, 9, 1), 4, 2, 8),
+        ((1, 6, 1), (12, 6, 20), 4, 2, 8),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.self_attention_varlen on {args.device}")
+    for shape in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_self_attention_varlen(
+                *shape, dtype_name, atol, rtol, args.device, args.profile
+            )
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -30,6 +30,15 @@ def test_op_swiglu(
 
     assert check_equal(out_, out, atol=atol, rtol=rtol)
 
+    # gate and up as column halves of one [rows, 2 * cols] tensor
+    gate_up, gate_up_ = random_tensor((shape[0], 2 * shape[1]), dtype_name, device_name)
+    sgate, sup = gate_up[:, : shape[1]], gate_up[:, shape[1] :]
+    sgate_, sup_ = gate_up_.slice(1, 0, shape[1]), gate_up_.slice(1, shape[1], 2 * shape[1])
+    torch_swiglu(out, sgate, sup)
+    llaisys.Ops.swiglu(out_, sgate_, sup_)
+
+    assert check_equal(out_, out, atol=atol, rtol=rtol)
+
     if profile:
         benchmark(
             lambda: torch_swiglu(out, gate, up),
@@ -146,4 +146,74 @@ if __name__ == "__main__":
 
     if args.test:
         assert llaisys_tokens == tokens
+
+        # Batched decode alongside a shorter prompt must match the single-sequence result
+        inputs = tokenizer.encode(
+            tokenizer.apply_chat_template(
+                conversation=[{"role": "user", "content": args.prompt}],
+                add_generation_prompt=True,
+                tokenize=False,
+            )
+        )
+        batch_tokens = model.generate_batch(
+            [inputs, inputs[: len(inputs) // 2]], max_new_tokens=args.max_steps
+        )
+        assert batch_tokens[0] == tokens
+
+        # Same requests through the continuous-batching scheduler
+        scheduler = llaisys.models.Qwen2Scheduler(model, max_batch=2, token_budget=32)
+        sched_tokens = scheduler.run(
+            [inputs[: len(inputs) // 2], inputs], max_new_tokens=args.max_steps
+        )
+        assert sched_tokens[1] == tokens
+
+        # Prompt-lookup speculation in the scheduler must not change greedy output
+        scheduler = llaisys.models.Qwen2Scheduler(model, max_batch=2, token_budget=32)
+        lookup_tokens = scheduler.run(
+            [inputs[: len(inputs) // 2], inputs], max_new_tokens=args.max_steps, lookup_draft=4
+        )
+        assert lookup_tokens[1] == tokens
+        print(f"Prompt lookup acceptance rate: {scheduler.lookup_stats()['acceptance_rate']:.2f}")
+
+        # The asynchronous engine runs the same scheduler on its own worker thread
+        engine = llaisys.models.Qwen2Engine(model, max_batch=2, token_budget=32)
+        engine_tokens = engine.run([inputs[: len(inputs) // 2], inputs], max_new_tokens=args.max_steps)
+        assert engine_tokens[1] == tokens
+        del engine
+
+        # Two sessions sharing the model's weights keep separate conversations.
+        # With a tiny KV budget the idle one is evicted and transparently re-prefilled.
+        model.set_kv_budget(1)
+        first, second = llaisys.models.Qwen2Session(model), llaisys.models.Qwen2Session(model)
+        half = first.generate(inputs[: len(inputs) // 2], max_new_tokens=args.max_steps)
+        full = second.generate(inputs, max_new_tokens=args.max_steps)
+        assert full == tokens[len(inputs) :]
+        assert batch_tokens[1] == inputs[: len(inputs) // 2] + half
+        assert model.kv_stats()["evictions"] > 0
+        model.set_kv_budget(0)
+
+        # Greedy speculative decoding (the model drafting for itself) must match as well
+        spec_tokens, stats = model.generate_speculative(
+            inputs, model, max_new_tokens=args.max_steps, num_draft=4
+        )
+        assert spec_tokens == tokens
+        print(f"Speculative acceptance rate: {stats['acceptance_rate']:.2f}")
+
+        # A follow-up turn reuses the cached conversation and prefills only the new tokens
+        model.generate(inputs, max_new_tokens=args.max_steps)
+        follow_up = tokens + inputs
+        reused = model.generate(follow_up, max_new_tokens=args.max_steps)
+        assert model.last_reused_tokens == len(tokens) - 1
+        assert reused == model.generate(follow_up, max_new_tokens=args.max_steps, reuse_kv=False)
+
+        # The native decode loop streams tokens and stops before a matched stop sequence
+        generated = tokens[len(inputs) :]
+        streamed = []
+        assert model.generate(inputs, max_new_tokens=args.max_steps, on_token=streamed.append) == tokens
+        assert streamed == generated
+        if len(generated) > 6:
+            stop = generated[4:6]
+            first = next(i for i in range(len(generated)) if generated[i : i + 2] == stop)
+            stopped = model.generate(inputs, max_new_tokens=args.max_steps, stop_sequences=[stop])
+            assert stopped == inputs + generated[:first]
         print("\033[92mTest passed!\033[0m\n")
@@ -18,6 +18,13 @@ def test_basic_runtime_api(device_name: str = "cpu"):
         print("Testing device {i}...")
         api.set_device(i)
         test_memcpy(api, 1024 * 1024)
+        if device_name == "cpu":
+            # Large blocks are mapped with huge pages, small ones come from the heap.
+            for mode in llaisys.HugePageMode:
+                llaisys.RuntimeAPI.set_cpu_memory_policy(mode)
+                test_memcpy(api, 4 * 1024 * 1024 + 3)
+                test_memcpy(api, 1000)
+            llaisys.RuntimeAPI.set_cpu_memory_policy(llaisys.HugePageMode.TRANSPARENT)
 
         print("     Passed")
 
@@ -53,10 +60,47 @@ def test_memcpy(api, size_bytes: int):
     torch.testing.assert_close(a, b)
 
 
+def test_caching_allocator(device_name: str = "cpu"):
+    api = llaisys.RuntimeAPI(llaisys_device(device_name))
+    if api.get_device_count() == 0:
+        return
+    device = llaisys_device(device_name)
+    api.set_allocator(0, llaisys.AllocatorType.CACHING, 64 * 1024 * 1024)
+
+    shapes = [(7,), (128, 64), (1024, 1024), (3, 333, 517)]
+    tensors = [
+        llaisys.Tensor(shape, dtype=llaisys.DataType.F32, device=device)
+        for shape in shapes
+    ]
+    del tensors
+    before = api.memory_stats(0)
+    assert before["allocated_bytes"] == 0
+    assert before["cached_bytes"] > 0
+
+    # Same shapes again must be served from the cache.
+    tensors = [
+        llaisys.Tensor(shape, dtype=llaisys.DataType.F32, device=device)
+        for shape in shapes
+    ]
+    after = api.memory_stats(0)
+    assert after["num_cache_hits"] >= before["num_cache_hits"] + len(shapes)
+    assert after["num_device_mallocs"] == before["num_device_mallocs"]
+    assert after["allocated_bytes"] > 0
+    del tensors
+
+    api.trim_allocator(0)
+    trimmed = api.memory_stats(0)
+    assert trimmed["cached_bytes"] == 0
+    assert trimmed["reserved_bytes"] == 0
+
+    print("     Caching allocator passed")
+
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
     args = parser.parse_args()
     test_basic_runtime_api(args.device)
+    test_caching_allocator(args.device)
     
     print("\033[92mTest passed!\033[0m\n")
@@ -48,6 +48,30 @@ def test_tensor():
     assert llaisys_tensor.is_contiguous() == torch_tensor.is_contiguous()
     assert check_equal(llaisys_tensor_slice, torch_tensor_slice)
 
+    # Test contiguous
+    print("===Test contiguous===")
+    torch_tensor_cont = torch_tensor_perm.contiguous()
+    llaisys_tensor_cont = llaisys_tensor_perm.contiguous()
+    assert llaisys_tensor_cont.shape() == torch_tensor_cont.shape
+    assert llaisys_tensor_cont.strides() == torch_tensor_cont.stride()
+    assert llaisys_tensor_cont.is_contiguous()
+    assert check_equal(llaisys_tensor_cont, torch_tensor_cont)
+
+    # Test reshape
+    print("===Test reshape===")
+    # merges the two dims that stay adjacent in memory, no copy
+    torch_tensor_reshape = torch_tensor_slice.permute(2, 0, 1).reshape(3, 12)
+    llaisys_tensor_reshape = llaisys_tensor_slice.permute(2, 0, 1).reshape(3, 12)
+    assert llaisys_tensor_reshape.shape() == torch_tensor_reshape.shape
+    assert llaisys_tensor_reshape.strides() == torch_tensor_reshape.stride()
+    assert check_equal(llaisys_tensor_reshape, torch_tensor_reshape)
+    # needs a copy
+    torch_tensor_reshape = torch_tensor_perm.reshape(10, 6)
+    llaisys_tensor_reshape = llaisys_tensor_perm.reshape(10, 6)
+    assert llaisys_tensor_reshape.shape() == torch_tensor_reshape.shape
+    assert llaisys_tensor_reshape.strides() == torch_tensor_reshape.stride()
+    assert check_equal(llaisys_tensor_reshape, torch_tensor_reshape)
+
 
 if __name__ == "__main__":
     test_tensor()
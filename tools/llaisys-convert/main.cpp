@@ -0,0 +1,53 @@
+// Offline converter: HuggingFace Qwen2 checkpoint (config.json + *.safetensors) -> .llaisys file.
+// Usage: llaisys-convert <model_dir> <output.llaisys> [--dtype bf16|f16|f32] [--maxseq N]
+#include "../../src/models/qwen2/llaisys_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+
+using namespace llaisys::models;
+
+static int usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s <model_dir> <output.llaisys> [--dtype bf16|f16|f32] [--maxseq N]\n", argv0);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage(argv[0]);
+    std::string model_dir = argv[1];
+    std::string output = argv[2];
+    llaisysDataType_t dtype = LLAISYS_DTYPE_BF16;
+    size_t maxseq = 4096;
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--dtype") == 0 && i + 1 < argc) {
+            std::string d = argv[++i];
+            if (d == "bf16") {
+                dtype = LLAISYS_DTYPE_BF16;
+            } else if (d == "f16") {
+                dtype = LLAISYS_DTYPE_F16;
+            } else if (d == "f32") {
+                dtype = LLAISYS_DTYPE_F32;
+            } else {
+                return usage(argv[0]);
+            }
+        } else if (std::strcmp(argv[i], "--maxseq") == 0 && i + 1 < argc) {
+            maxseq = std::stoul(argv[++i]);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    try {
+        Qwen2Model model(read_hf_config(model_dir, dtype, maxseq));
+        auto stats = load_safetensors(model, model_dir);
+        save_llaisys(model, output);
+        std::printf("converted %zu tensors from %zu files in %.0f ms -> %s\n", stats.mapped + stats.converted,
+                    stats.files, stats.total_ms, output.c_str());
+        return 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "llaisys-convert: %s\n", e.what());
+        return 1;
+    }
+}
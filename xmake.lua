@@ -81,13 +81,16 @@ target("llaisys-tensor")
     set_languages("cxx17")
     if is_plat("windows") then
         set_warnings("all")
-        add_cxflags("/wd4819", "/wd4996", "/wd4267", "/wd4244")
+        add_cxflags("/wd4819", "/wd4996", "/wd4267", "/wd4244", "/openmp")
     else
         set_warnings("all", "error")
-        add_cxflags("-fPIC", "-Wno-unknown-pragmas")
+        add_cxflags("-fPIC", "-Wno-unknown-pragmas", "-fopenmp")
+        add_ldflags("-fopenmp")
     end
 
     add_files("src/tensor/*.cpp")
+    -- Tensor::contiguous 使用 CPU 上的 rearrange 内核；llaisys-ops-cpu 依赖本目标，所以该内核编译在这里
+    add_files("src/ops/rearrange/cpu/*.cpp")
 
     on_install(function (target) end)
 target_end()
@@ -162,4 +165,28 @@ target("llaisys")
             os.cp("lib/*.so", "python/llaisys/libllaisys/")
         end
     end)
-target_end()
\ No newline at end of file
+target_end()
+-- 离线转换工具：HuggingFace safetensors -> .llaisys
+target("llaisys-convert")
+    set_kind("binary")
+    add_deps("llaisys-utils")
+    add_deps("llaisys-device")
+    add_deps("llaisys-core")
+    add_deps("llaisys-tensor")
+    add_deps("llaisys-ops")
+    add_deps("llaisys-models")
+
+    set_languages("cxx17")
+    if is_plat("windows") then
+        set_warnings("all")
+        add_cxflags("/wd4819", "/wd4996", "/wd4267", "/wd4244", "/openmp")
+        add_ldflags("/openmp")
+    else
+        set_warnings("all", "error")
+        add_ldflags("-fopenmp")
+    end
+    add_files("tools/llaisys-convert/main.cpp")
+    -- llaisys-core 通过 llaisysGetRuntimeAPI 取得设备接口，它定义在 C API 的 runtime.cc 中
+    add_files("src/llaisys/runtime.cc")
+    set_installdir(".")
+target_end()
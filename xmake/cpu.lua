@@ -27,7 +27,8 @@ target("llaisys-ops-cpu")
         add_ldflags("-fopenmp")
     end
 
-    add_files("../src/ops/*/cpu/*.cpp")
+    -- rearrange 内核编译在 llaisys-tensor 中
+    add_files("../src/ops/*/cpu/*.cpp|rearrange/cpu/*.cpp")
 
     on_install(function (target) end)
 target_end()